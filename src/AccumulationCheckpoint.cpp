@@ -0,0 +1,125 @@
+#include "AccumulationCheckpoint.h"
+
+#include <cstring>
+#include <print>
+
+#include "AtomicFile.h"
+#include "MappedFile.h"
+
+std::optional<AccumulationCheckpoint> AccumulationCheckpoint::Read(const std::filesystem::path& path)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+		return std::nullopt;
+
+	// Copied out of the mapping, the renderer keeps writing new checkpoints over the file
+	return Deserialize(file.GetData(), path.string());
+}
+
+bool AccumulationCheckpoint::Write(const std::filesystem::path& path) const
+{
+	const std::vector<std::byte> data = Serialize();
+
+	// A crash while writing leaves the previous checkpoint in place
+	return WriteFileAtomically(path, [&data](std::ofstream& stream) -> void
+		{
+			stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		}, true);
+}
+
+std::optional<AccumulationCheckpoint> AccumulationCheckpoint::Deserialize(std::span<const std::byte> data, std::string_view source)
+{
+	if (data.size() < sizeof(AccumulationCheckpointHeader))
+	{
+		std::println("Accumulation checkpoint is truncated: {}", source);
+		return std::nullopt;
+	}
+
+	AccumulationCheckpointHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (header.Magic != s_Magic || header.Version != s_Version)
+	{
+		std::println("Unsupported accumulation checkpoint (version {}): {}", header.Version, source);
+		return std::nullopt;
+	}
+
+	const uint64_t pixelCount = static_cast<uint64_t>(header.Width) * header.Height;
+
+	if (pixelCount * sizeof(glm::vec4) != data.size() - sizeof(AccumulationCheckpointHeader))
+	{
+		std::println("Accumulation checkpoint doesn't match its {}x{} extent: {}", header.Width, header.Height, source);
+		return std::nullopt;
+	}
+
+	AccumulationCheckpoint checkpoint;
+	checkpoint.SceneHash = header.SceneHash;
+	checkpoint.CameraHash = header.CameraHash;
+	checkpoint.SampleCount = header.SampleCount;
+	checkpoint.Seed = header.Seed;
+	checkpoint.Accumulation.Extent = { header.Width, header.Height };
+	checkpoint.Accumulation.Sums.resize(pixelCount);
+	std::memcpy(checkpoint.Accumulation.Sums.data(), data.data() + sizeof(header), pixelCount * sizeof(glm::vec4));
+
+	return checkpoint;
+}
+
+std::vector<std::byte> AccumulationCheckpoint::Serialize() const
+{
+	AccumulationCheckpointHeader header = {};
+	header.Magic = s_Magic;
+	header.Version = s_Version;
+	header.SceneHash = SceneHash;
+	header.CameraHash = CameraHash;
+	header.Width = Accumulation.Extent.x;
+	header.Height = Accumulation.Extent.y;
+	header.SampleCount = SampleCount;
+	header.Seed = Seed;
+
+	const std::span<const std::byte> sums = std::as_bytes(std::span(Accumulation.Sums));
+
+	std::vector<std::byte> data(sizeof(header) + sums.size());
+	std::memcpy(data.data(), &header, sizeof(header));
+	std::memcpy(data.data() + sizeof(header), sums.data(), sums.size());
+
+	return data;
+}
+
+bool AccumulationCheckpoint::Merge(const AccumulationCheckpoint& other)
+{
+	if (other.SceneHash != SceneHash || other.CameraHash != CameraHash || other.Accumulation.Extent != Accumulation.Extent)
+	{
+		std::println("Accumulation checkpoints of different scenes, cameras or extents can't be merged");
+		return false;
+	}
+
+	// The same seed traces the same rays, the sums would count every sample twice
+	if (other.Seed == Seed)
+	{
+		std::println("Accumulation checkpoints share the seed {}, their samples are duplicates", Seed);
+		return false;
+	}
+
+	for (size_t i = 0; i < Accumulation.Sums.size(); i++)
+		Accumulation.Sums[i] += other.Accumulation.Sums[i];
+
+	SampleCount += other.SampleCount;
+
+	// Resuming the merged render continues with a sequence neither of the two used
+	const std::array<uint32_t, 2> seeds = { Seed, other.Seed };
+	Seed = static_cast<uint32_t>(Hash(std::as_bytes(std::span(seeds))));
+
+	return true;
+}
+
+uint64_t AccumulationCheckpoint::Hash(std::span<const std::byte> bytes, uint64_t hash)
+{
+	for (const std::byte byte : bytes)
+	{
+		hash ^= static_cast<uint64_t>(byte);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
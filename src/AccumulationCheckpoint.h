@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "VulkanTypes.h"
+
+/*
+ * Accumulation checkpoint layout (little endian):
+ *   AccumulationCheckpointHeader
+ *   glm::vec4 Sums[Width * Height], rows of the render extent, alpha is the sample count of the pixel
+ */
+struct AccumulationCheckpointHeader
+{
+	std::array<char, 4> Magic;
+	uint32_t Version;
+	uint64_t SceneHash;
+	uint64_t CameraHash;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t SampleCount;
+	uint32_t Seed;
+};
+
+static_assert(sizeof(AccumulationCheckpointHeader) == 40 && std::is_trivially_copyable_v<AccumulationCheckpointHeader>);
+
+// Progress of a long accumulation on disk. The sums only resume a render with the same scene and camera hashes,
+// checkpoints of the same image rendered with different seeds add up to one with the samples of both.
+struct AccumulationCheckpoint
+{
+	static constexpr std::array<char, 4> s_Magic = { 'R', 'T', 'A', 'C' };
+	static constexpr uint32_t s_Version = 1;
+	static constexpr std::string_view s_Extension = ".rtacc";
+	static constexpr uint64_t s_HashBasis = 14695981039346656037ull;
+
+	uint64_t SceneHash = 0;
+	uint64_t CameraHash = 0;
+	// Completed samples of the whole image, pixels of a partly traced sample have one more in their alpha
+	uint32_t SampleCount = 0;
+	uint32_t Seed = 0;
+	AccumulationData Accumulation;
+
+	[[nodiscard]] static std::optional<AccumulationCheckpoint> Read(const std::filesystem::path& path);
+	bool Write(const std::filesystem::path& path) const;
+
+	// The file contents, also what render farm workers send back. The source only names the data in messages.
+	[[nodiscard]] static std::optional<AccumulationCheckpoint> Deserialize(std::span<const std::byte> data, std::string_view source);
+	[[nodiscard]] std::vector<std::byte> Serialize() const;
+
+	// Adds the samples of another render of the same image, fails if the hashes, extents or seeds don't allow it
+	bool Merge(const AccumulationCheckpoint& other);
+
+	// FNV-1a, passing the previous hash folds several fields into one
+	[[nodiscard]] static uint64_t Hash(std::span<const std::byte> bytes, uint64_t hash = s_HashBasis);
+};
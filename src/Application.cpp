@@ -6,50 +6,37 @@ namespace
 	{
 		std::println("Error: {}\n", description);
 	}
-
-	LUTType StringToLutType(const std::string& string)
-	{
-		if (string == "CINEMATIC")
-			return LUTType::CINEMATIC;
-		if (string == "DAY - NIGHT")
-			return LUTType::DAY_NIGHT;
-		if (string == "CINEDRAMA")
-			return LUTType::CINEDRAMA;
-
-		return LUTType::NONE;
-	}
 }
 
 namespace ImGui
 {
-	bool Combo(const char* label, int* current_item, const std::vector<std::string>& items, int height_in_items = -1)
+	bool Combo(const char* label, int* current_item, std::span<const std::string> items, int height_in_items = -1)
 	{
 		return Combo(label, current_item, [](void* data, int idx, const char** out_text) {
-			const auto& vec = *static_cast<const std::vector<std::string>*>(data);
-			*out_text = vec[idx].c_str();
+			const auto& span = *static_cast<const std::span<const std::string>*>(data);
+			*out_text = span[idx].c_str();
 			return true;
-		}, (void*)&items, items.size(), height_in_items);
+		}, (void*)&items, static_cast<int>(items.size()), height_in_items);
 	}
 }
-Application::Application(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized, const std::string& defaultScene) :
+Application::Application(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized, const std::string& defaultScene,
+	bool visible) :
 	m_Window(nullptr, glfwDestroyWindow)
 {
 
 	std::filesystem::current_path(PROJECT_SOURCE_DIR);
 
-	Init(width, height, title, resizable, maximized);
-	LoadJSONScenes();
-
-	if (!defaultScene.empty())
-	{
-		const auto& it = m_Scenes.find(defaultScene);
+	Init(width, height, title, resizable, maximized, visible);
+	DiscoverScenes();
 
-		if (it != m_Scenes.end() && it->second != nullptr)
+	m_SceneWatcher = std::make_unique<FileWatcher>(m_PathToScenes, std::chrono::milliseconds(1500));
+	m_SceneWatcherFuture = std::async(std::launch::async, [this]() -> void
 		{
-			m_CurrentScene = it->second;
-			m_Renderer->SetScene(it->second);
-		}
-	}
+			m_SceneWatcher->Start();
+		});
+
+	if (m_Scenes.contains(defaultScene))
+		SelectScene(defaultScene);
 }
 
 void Application::Run()
@@ -63,6 +50,8 @@ void Application::Run()
 
 		glfwPollEvents();
 
+		MonitorScenes();
+		UpdateSceneSaves();
 		HandleCursorInput();
 
 		if (m_CurrentScene)
@@ -83,6 +72,213 @@ void Application::Run()
 	}
 }
 
+bool Application::RunHeadless(int argc, char** argv, int& outExitCode)
+{
+	if (argc >= 2 && std::string_view(argv[1]) == "--worker")
+	{
+		const std::string_view portArgument = argc == 4 ? argv[3] : "";
+		uint16_t port = 0;
+
+		if (std::from_chars(portArgument.data(), portArgument.data() + portArgument.size(), port).ec != std::errc())
+		{
+			std::println("Usage: {} --worker <host> <port>", argv[0]);
+			outExitCode = 1;
+			return true;
+		}
+
+		outExitCode = RunWorker(argv[2], port);
+		return true;
+	}
+
+	if (argc < 2 || std::string_view(argv[1]) != "--render")
+		return false;
+
+	outExitCode = 1;
+
+	if (argc < 3)
+	{
+		std::println("Usage: {} --render <scene> [samples] [--max-throughput] [--multi-gpu [--split-bands] [--software-devices]]", argv[0]);
+		return true;
+	}
+
+	uint32_t samples = 1000;
+	bool maxThroughput = false;
+	bool multiDevice = false;
+	bool includeSoftware = false;
+	MultiDeviceSplit split = MultiDeviceSplit::SAMPLES;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const std::string_view argument = argv[i];
+
+		if (argument == "--max-throughput")
+		{
+			maxThroughput = true;
+			continue;
+		}
+
+		if (argument == "--multi-gpu")
+		{
+			multiDevice = true;
+			continue;
+		}
+
+		if (argument == "--split-bands")
+		{
+			split = MultiDeviceSplit::BANDS;
+			continue;
+		}
+
+		// Lavapipe and other CPU implementations, e.g. to try several devices on a machine with a single GPU
+		if (argument == "--software-devices")
+		{
+			includeSoftware = true;
+			continue;
+		}
+
+		if (std::from_chars(argument.data(), argument.data() + argument.size(), samples).ec != std::errc() || samples == 0)
+		{
+			std::println("Invalid sample count: {}", argument);
+			return true;
+		}
+	}
+
+	Application app(1920, 1080, "Ray Tracer", false, false, argv[2], false);
+
+	if (multiDevice)
+		app.m_Renderer->SetMultiDevice(true, split, includeSoftware);
+
+	outExitCode = app.RenderHeadless(samples, maxThroughput);
+	return true;
+}
+
+bool Application::PrepareHeadless(bool maxThroughput)
+{
+	if (m_CurrentSceneName.empty())
+	{
+		std::println("Unknown scene, scenes are looked up by name in {}", m_PathToScenes.string());
+		return false;
+	}
+
+	// Loads on a worker like in the editor
+	while (!m_CurrentScene)
+	{
+		if (!m_Scenes.at(m_CurrentSceneName).Loading)
+		{
+			std::println("Couldn't load {}", m_CurrentSceneName);
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		MonitorScenes();
+	}
+
+	// No ImGui windows are drawn, the viewport covers the whole window
+	m_Renderer->ResizeViewport(m_Width, m_Height);
+	m_Renderer->SetAccumulation(true);
+	m_Renderer->SetSampleBudget(s_HeadlessSampleBudget);
+	m_Renderer->SetMaxThroughput(maxThroughput);
+	// Only samples traced by this run count, none resumed from a checkpoint
+	m_Renderer->SetCheckpointPath({});
+
+	return true;
+}
+
+void Application::RenderHeadlessFrame()
+{
+	glfwPollEvents();
+
+	// Presented frames still record the UI pass, it just has nothing to draw
+	ImGui_ImplVulkan_NewFrame();
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+	ImGui::Render();
+
+	m_Renderer->Render();
+}
+
+int Application::RenderHeadless(uint32_t samples, bool maxThroughput)
+{
+	if (!PrepareHeadless(maxThroughput))
+		return 1;
+
+	m_Renderer->SetMaxSamples(samples + 1);
+	m_Renderer->ResetAccumulation();
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t lastSampleCount = 0;
+
+	// Samples still tracing on other GPUs are waited for, they are part of the requested count
+	while (m_IsRunning && !m_Renderer->IsFinished())
+	{
+		RenderHeadlessFrame();
+
+		// Targets that grow to the window size restart the accumulation, so does the clock
+		if (m_Renderer->GetSampleCount() < lastSampleCount)
+			start = std::chrono::steady_clock::now();
+
+		lastSampleCount = m_Renderer->GetSampleCount();
+	}
+
+	m_Renderer->WaitForFrames();
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const uint32_t traced = m_Renderer->GetSampleCount() - 1;
+	const glm::uvec2 extent = m_Renderer->GetRenderExtent();
+
+	std::println("Traced {} samples at {}x{} in {:.2f}s: {:.1f} samples/s on {} GPUs{}", traced, extent.x, extent.y, elapsed.count(),
+		static_cast<double>(traced) / elapsed.count(), m_Renderer->GetTraceDeviceCount() + 1, maxThroughput ? " (max throughput)" : "");
+
+	return m_IsRunning ? 0 : 1;
+}
+
+int Application::RunWorker(const std::string& host, uint16_t port)
+{
+	RenderFarm::WorkerConnection connection;
+
+	if (!connection.Connect(host, port))
+		return 1;
+
+	std::optional<RenderFarm::RenderJob> job = connection.ReceiveJob();
+
+	if (!job)
+		return 0;
+
+	// The window is the render target, every job of the coordinator shares its scene and extent
+	const RenderFarm::RenderJob firstJob = *job;
+	Application app(firstJob.Extent.x, firstJob.Extent.y, "Ray Tracer", false, false, firstJob.SceneName, false);
+
+	if (!app.PrepareHeadless(true))
+		return 1;
+
+	for (; job; job = connection.ReceiveJob())
+	{
+		if (job->SceneName != firstJob.SceneName || job->Extent != firstJob.Extent)
+		{
+			std::println("Worker jobs must all render {} at {}x{}", firstJob.SceneName, firstJob.Extent.x, firstJob.Extent.y);
+			return 1;
+		}
+
+		// Every job is a separate accumulation, its seed keeps the samples apart from those of the other jobs
+		app.m_Renderer->SetMaxSamples(job->Samples + 1);
+		app.m_Renderer->SetAccumulationSeed(job->Seed);
+		app.m_Renderer->ResetAccumulation();
+
+		while (app.m_IsRunning && !app.m_Renderer->IsFinished())
+			app.RenderHeadlessFrame();
+
+		if (!app.m_IsRunning)
+			return 1;
+
+		const std::optional<AccumulationCheckpoint> result = app.m_Renderer->ReadCheckpoint();
+
+		if (!result || !connection.SendResult(*result))
+			return 1;
+	}
+
+	return 0;
+}
+
 void Application::DrawImGui()
 {
 	if (!m_Scenes.empty())
@@ -99,16 +295,21 @@ void Application::DrawImGui()
 		ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.25f, 0.30f, 0.35f, 1.0f));
 		ImGui::PushStyleColor(ImGuiCol_HeaderActive, ImVec4(0.30f, 0.35f, 0.40f, 1.0f));
 
-		for (const auto& [name, scenePtr] : m_Scenes)
+		for (const auto& [name, entry] : m_Scenes)
 		{
 			bool isCurrent = (name == m_CurrentSceneName);
 			if (ImGui::Selectable(name.c_str(), isCurrent, ImGuiSelectableFlags_SpanAllColumns))
 			{
-				m_CurrentSceneName = name;
-				m_CurrentScene = scenePtr;
-				m_Renderer->SetScene(scenePtr);
-				m_Renderer->SetBgColor(scenePtr->GetBgColor());
-				m_Renderer->ResetAccumulation();
+				SelectScene(name);
+			}
+
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("%s (%.1f KB)", entry.Path.filename().string().c_str(), static_cast<double>(entry.FileSize) / 1024.0);
+
+			if (entry.Loading)
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled("loading...");
 			}
 		}
 
@@ -152,64 +353,80 @@ void Application::DrawImGui()
 			}
 		}
 
+		// The targets are pooled, only the top left part holds the viewport (clamped while larger targets are pending)
 		if (renderTexture)
-			ImGui::Image(renderTexture, viewportSize);
+		{
+			ImGui::Image(renderTexture, viewportSize, ImVec2(0, 0), m_Renderer->GetRenderTextureUV());
+
+			// The image covers the render extent, so its normalized coordinates are the tile origin
+			if (ImGui::IsItemHovered())
+			{
+				const ImVec2 imageMin = ImGui::GetItemRectMin();
+				const ImVec2 imageSize = ImGui::GetItemRectSize();
+				const ImVec2 mouse = ImGui::GetMousePos();
+				m_CursorTileOrigin = { (mouse.x - imageMin.x) / imageSize.x, (mouse.y - imageMin.y) / imageSize.y };
+			}
+		}
 
 		ImGui::End();
 		ImGui::PopStyleVar(2);
 
 		ImGui::Begin("Scene objects");
 		
-		for (size_t i = 0; i < m_CurrentScene->GetSpheres().size(); i++)
+		// Only the visible rows touch the name table, so large scenes don't stall the editor
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(m_CurrentScene->GetSphereCount()));
+		while (clipper.Step())
 		{
-			Sphere& sphere = m_CurrentScene->GetSpheres()[i];
-
-			if(ImGui::Selectable(sphere.GetName().c_str(), false))
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 			{
-				m_SelectedSphereIndex = static_cast<int>(i);
+				ImGui::PushID(i);
+				if (ImGui::Selectable(m_CurrentScene->GetSphereName(i).c_str(), i == m_SelectedSphereIndex))
+				{
+					m_SelectedSphereIndex = i;
+				}
+				ImGui::PopID();
 			}
-
 		}
 		ImGui::End();
 
 		ImGui::Begin("Object details");
 
-		if (m_SelectedSphereIndex != -1 && !m_CurrentScene->GetSpheres().empty())
+		if (m_SelectedSphereIndex != -1 && m_SelectedSphereIndex < static_cast<int>(m_CurrentScene->GetSphereCount()))
 		{
-			Sphere& sphere = m_CurrentScene->GetSpheres()[m_SelectedSphereIndex];
-			const auto& material = m_CurrentScene->GetMaterials().at(sphere.GetMaterialIndex()).MaterialPtr;
-
-			const std::vector<MaterialInfo>& materials = m_CurrentScene->GetMaterials();
-			std::vector<std::string> materialNames;
-			materialNames.reserve(materials.size());
+			const uint32_t sphereIndex = static_cast<uint32_t>(m_SelectedSphereIndex);
+			uint32_t& materialIndex = m_CurrentScene->GetSphereMaterialIndices()[sphereIndex];
 
-			for (const auto& [name, materialPtr] : materials)
-				materialNames.emplace_back(name);
-
-			if (ImGui::DragFloat3("Position", glm::value_ptr(sphere.GetPosition()), 0.1f))
+			if (ImGui::DragFloat3("Position", glm::value_ptr(m_CurrentScene->GetSpherePositions()[sphereIndex]), 0.1f))
 				sceneChanged = true;
-			if (ImGui::DragFloat("Radius", &sphere.GetRadius(), 0.1f))
+			if (ImGui::DragFloat("Radius", &m_CurrentScene->GetSphereRadii()[sphereIndex], 0.1f))
 				sceneChanged = true;
 
 			ImGui::Separator();
 
-			int idx = static_cast<int>(sphere.GetMaterialIndex());
-			if (ImGui::Combo("Current material", &idx, materialNames))
+			// Loaders reject indices out of range, a scene without materials still has none to edit
+			if (materialIndex < m_CurrentScene->GetMaterialCount())
 			{
-				sphere.GetMaterialIndex() = static_cast<uint32_t>(idx);
-				sceneChanged = true;
-			}
+				Material& material = m_CurrentScene->GetMaterials()[materialIndex];
 
-			if (ImGui::ColorEdit3("Color", glm::value_ptr(material->Color)))
-				sceneChanged = true;
-			if (ImGui::DragFloat("Roughness", &material->Roughness, 0.01f, 0.0f, 1.0f))
-				sceneChanged = true;
-			if(ImGui::DragFloat("Metallic", &material->Metallic, 0.01f, 0.0f, 1.0f))
-				sceneChanged = true;
-			if (ImGui::DragFloat("Specular", &material->Specular, 0.01f, 0.0f, 1.0f))
-				sceneChanged = true;
-			if (ImGui::DragFloat("Emission Power", &material->EmissionPower, 0.05f, 0.0f, std::numeric_limits<float>::max()))
-				sceneChanged = true;
+				int idx = static_cast<int>(materialIndex);
+				if (ImGui::Combo("Current material", &idx, m_CurrentScene->GetMaterialNames()))
+				{
+					materialIndex = static_cast<uint32_t>(idx);
+					sceneChanged = true;
+				}
+
+				if (ImGui::ColorEdit3("Color", glm::value_ptr(material.Color)))
+					sceneChanged = true;
+				if (ImGui::DragFloat("Roughness", &material.Roughness, 0.01f, 0.0f, 1.0f))
+					sceneChanged = true;
+				if(ImGui::DragFloat("Metallic", &material.Metallic, 0.01f, 0.0f, 1.0f))
+					sceneChanged = true;
+				if (ImGui::DragFloat("Specular", &material.Specular, 0.01f, 0.0f, 1.0f))
+					sceneChanged = true;
+				if (ImGui::DragFloat("Emission Power", &material.EmissionPower, 0.05f, 0.0f, std::numeric_limits<float>::max()))
+					sceneChanged = true;
+			}
 		}
 
 		ImGui::End();
@@ -218,6 +435,15 @@ void Application::DrawImGui()
 		ImGui::Begin("Information");
 		ImGui::Text("Rendering the frame took: %.3fms", m_Renderer->GetRenderTime());
 
+		const PassTimings& passTimings = m_Renderer->GetPassTimings();
+		ImGui::Text("  Ray tracing: %.3fms", passTimings.RayTracing);
+		ImGui::Text("  Bloom: %.3fms", passTimings.Bloom);
+		ImGui::Text("  Post process: %.3fms", passTimings.PostProcess);
+		ImGui::Text("  Upscale: %.3fms", passTimings.Upscale);
+
+		const glm::uvec2 renderExtent = m_Renderer->GetRenderExtent();
+		ImGui::Text("Render resolution: %ux%u (%.0f%%)", renderExtent.x, renderExtent.y, m_Renderer->GetRenderScale() * 100.f);
+
 		ImGui::Separator();
 		ImGui::Text("Render Settings");
 
@@ -237,11 +463,50 @@ void Application::DrawImGui()
 			}
 		}
 
+		if (ImGui::Checkbox("Dynamic resolution", &m_DynamicResolution))
+		{
+			m_Renderer->SetDynamicResolution(m_DynamicResolution);
+		}
+
+		if (m_DynamicResolution)
+		{
+			if (ImGui::SliderFloat("Target GPU time (ms)", &m_TargetFrameTime, 2.0f, 33.3f))
+			{
+				m_Renderer->SetTargetFrameTime(m_TargetFrameTime);
+			}
+		}
+
+		// Fixed scale, with dynamic resolution on it only applies while accumulating
+		if (ImGui::SliderFloat("Render scale", &m_RenderScale, 0.5f, 1.0f))
+		{
+			m_Renderer->SetRenderScale(m_RenderScale);
+		}
+
+		if (ImGui::SliderFloat("Exposure", &m_Exposure, 0.1f, 5.0f))
+		{
+			m_Renderer->SetExposure(m_Exposure);
+		}
+
 		if (ImGui::Checkbox("Bloom enabled", &m_BloomEnabled))
 		{
 			m_Renderer->SetBloomEnabled(m_BloomEnabled);
 		}
 
+		if (m_BloomEnabled)
+		{
+			// Changing the depth rebuilds the pyramid, so it is applied once the slider is released
+			ImGui::SliderInt("Bloom depth", &m_BloomDepth, 1, 12);
+			if (ImGui::IsItemDeactivatedAfterEdit())
+			{
+				m_Renderer->SetBloomMaxDepth(static_cast<uint32_t>(m_BloomDepth));
+			}
+
+			if (ImGui::SliderFloat("Bloom radius", &m_BloomRadius, 0.5f, 3.0f))
+			{
+				m_Renderer->SetBloomRadius(m_BloomRadius);
+			}
+		}
+
 		if (ImGui::Checkbox("Color grading enabled", &m_ColorGradingEnabled))
 		{
 			m_Renderer->SetColorGradingEnabled(m_ColorGradingEnabled);
@@ -249,20 +514,39 @@ void Application::DrawImGui()
 
 		if (m_ColorGradingEnabled)
 		{
-			const char* lutOptions[] = { "NONE", "CINEMATIC", "DAY - NIGHT", "CINEDRAMA" };
-			static int currentLutIndex = 1;
-			if (ImGui::Combo("LUTs", &currentLutIndex, lutOptions, IM_ARRAYSIZE(lutOptions)))
+			const std::span<const std::string> lutNames = m_Renderer->GetLutNames();
+			const char* preview = m_LutGradingOff || lutNames.empty() ? "NONE" : lutNames[m_Renderer->GetSelectedLut()].c_str();
+
+			if (ImGui::BeginCombo("LUTs", preview))
 			{
-				std::string selectedLut = lutOptions[currentLutIndex];
-				if (selectedLut == "NONE")
+				if (ImGui::Selectable("NONE", m_LutGradingOff))
 				{
+					m_LutGradingOff = true;
 					m_Renderer->SetColorGradingEnabled(false);
 				}
-				else
+
+				for (uint32_t i = 0; i < lutNames.size(); i++)
 				{
-					m_Renderer->SwitchLuts(StringToLutType(lutOptions[currentLutIndex]));
-					m_Renderer->SetColorGradingEnabled(true);
+					if (ImGui::Selectable(lutNames[i].c_str(), !m_LutGradingOff && i == m_Renderer->GetSelectedLut()))
+					{
+						m_LutGradingOff = false;
+						m_Renderer->SwitchLuts(i);
+						m_Renderer->SetColorGradingEnabled(true);
+					}
 				}
+
+				ImGui::EndCombo();
+			}
+
+			if (!m_LutGradingOff && m_Renderer->IsLutStreaming())
+			{
+				ImGui::SameLine();
+				ImGui::TextDisabled("Loading...");
+			}
+
+			if (ImGui::SliderFloat("LUT transition (s)", &m_LutTransitionSeconds, 0.0f, 5.0f))
+			{
+				m_Renderer->SetLutTransitionTime(m_LutTransitionSeconds);
 			}
 		}
 
@@ -271,6 +555,34 @@ void Application::DrawImGui()
 
 		if (accumulationEnabled)
 		{
+			if (ImGui::SliderFloat("Sample budget (ms)", &m_SampleBudget, 1.0f, 100.0f))
+			{
+				m_Renderer->SetSampleBudget(m_SampleBudget);
+			}
+
+			if (ImGui::Combo("Tile size", &m_TileSizeIndex, s_TileSizeNames.data(), static_cast<int>(s_TileSizeNames.size())))
+			{
+				m_Renderer->SetTileSize(s_TileSizes[m_TileSizeIndex]);
+			}
+
+			ImGui::Checkbox("Spiral from cursor", &m_SpiralFromCursor);
+			m_Renderer->SetTileOrigin(m_SpiralFromCursor ? m_CursorTileOrigin : glm::vec2(0.5f));
+
+			bool multiDeviceChanged = ImGui::Checkbox("Trace on all GPUs", &m_MultiDevice);
+
+			if (m_MultiDevice)
+			{
+				multiDeviceChanged |= ImGui::Combo("Split", &m_MultiDeviceSplitIndex, s_MultiDeviceSplitNames.data(), static_cast<int>(s_MultiDeviceSplitNames.size()));
+				ImGui::Text("Trace devices: %zu", m_Renderer->GetTraceDeviceCount());
+			}
+
+			if (multiDeviceChanged)
+			{
+				m_Renderer->SetMultiDevice(m_MultiDevice, static_cast<MultiDeviceSplit>(m_MultiDeviceSplitIndex));
+			}
+
+			ImGui::Text("Samples: %u (next %.0f%%)", m_Renderer->GetSampleCount() - 1, m_Renderer->GetSampleProgress() * 100.f);
+
 			if (ImGui::Button("Reset Accumulation"))
 			{
 				m_Renderer->ResetAccumulation();
@@ -288,11 +600,19 @@ void Application::DrawImGui()
 
 		ImGui::End();
 
-		if (sceneChanged && m_Renderer->IsAccumulationEnabled())
+		if (sceneChanged)
 		{
-			m_Renderer->ResetAccumulation();
+			m_CurrentScene->MarkChanged();
+			MarkCurrentSceneDirty();
+
+			if (m_Renderer->IsAccumulationEnabled())
+				m_Renderer->ResetAccumulation();
 		}
 	}
+	else if (!m_CurrentSceneName.empty())
+	{
+		DrawLoadingPlaceholder();
+	}
 }
 
 void Application::HandleKeyboardInput(Camera& camera)
@@ -303,6 +623,7 @@ void Application::HandleKeyboardInput(Camera& camera)
 	if (glfwGetKey(m_Window.get(), GLFW_KEY_Q) == GLFW_PRESS && !m_QPressed)
 	{
 		m_CurrentScene->SwitchCamera(-1);
+		MarkCurrentSceneDirty();
 		m_QPressed = true;
 		if (m_Renderer->IsAccumulationEnabled())
 			m_Renderer->ResetAccumulation();
@@ -315,6 +636,7 @@ void Application::HandleKeyboardInput(Camera& camera)
 	if (glfwGetKey(m_Window.get(), GLFW_KEY_E) == GLFW_PRESS && !m_EPressed)
 	{
 		m_CurrentScene->SwitchCamera(1);
+		MarkCurrentSceneDirty();
 		m_EPressed = true;
 		if (m_Renderer->IsAccumulationEnabled())
 			m_Renderer->ResetAccumulation();
@@ -325,9 +647,14 @@ void Application::HandleKeyboardInput(Camera& camera)
 	}
 
 	if (glfwGetKey(m_Window.get(), GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS &&
-		glfwGetKey(m_Window.get(), GLFW_KEY_R) == GLFW_PRESS)
+		glfwGetKey(m_Window.get(), GLFW_KEY_R) == GLFW_PRESS && !m_RPressed)
 	{
 		m_Renderer->ReloadShaders();
+		m_RPressed = true;
+	}
+	else if (glfwGetKey(m_Window.get(), GLFW_KEY_R) == GLFW_RELEASE)
+	{
+		m_RPressed = false;
 	}
 
 	glm::vec3 movement(0.0f);
@@ -344,6 +671,7 @@ void Application::HandleKeyboardInput(Camera& camera)
 	{
 		movement = glm::normalize(movement);
 		camera.Move(movement, m_DeltaTime);
+		MarkCurrentSceneDirty();
 
 		if (m_Renderer->IsAccumulationEnabled())
 			m_Renderer->ResetAccumulation();
@@ -375,6 +703,7 @@ void Application::HandleCameraRotate(Camera& camera)
 		m_LastMouseY = ypos;
 
 		camera.Rotate(xOffset, yOffset);
+		MarkCurrentSceneDirty();
 
 		if (m_Renderer->IsAccumulationEnabled())
 			m_Renderer->ResetAccumulation();
@@ -414,7 +743,7 @@ void Application::HandleCursorInput()
 	viewportHovered = m_ViewportHovered;
 }
 
-void Application::Init(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized)
+void Application::Init(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized, bool visible)
 {
 	glfwSetErrorCallback(ErrorCallback);
 
@@ -426,6 +755,7 @@ void Application::Init(uint32_t width, uint32_t height, const char* title, bool
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, resizable);
 	glfwWindowHint(GLFW_MAXIMIZED, maximized);
+	glfwWindowHint(GLFW_VISIBLE, visible);
 
 	m_Window = std::shared_ptr<GLFWwindow>(glfwCreateWindow(width, height, title, nullptr, nullptr), glfwDestroyWindow);
 	m_Width = width;
@@ -456,197 +786,268 @@ void Application::Init(uint32_t width, uint32_t height, const char* title, bool
 	glfwGetCursorPos(m_Window.get(), &m_LastMouseX, &m_LastMouseY);
 }
 
-void Application::LoadJSONScenes()
+void Application::DiscoverScenes()
 {
-	using json = nlohmann::json;
+	for (const auto& file : std::filesystem::directory_iterator(m_PathToScenes))
+	{
+		if (!SceneSerializer::IsSceneFile(file.path()))
+			continue;
+
+		const auto [it, inserted] = m_Scenes.try_emplace(SceneSerializer::SceneNameFromPath(file.path()));
+
+		// A binary conversion of a scene takes precedence over its JSON source
+		if (!inserted && it->second.Path.extension() == SceneSerializer::s_BinaryExtension)
+			continue;
+
+		std::error_code error;
+		it->second.Path = file.path();
+		it->second.FileSize = file.file_size(error);
+	}
+}
 
-	std::filesystem::path path = std::filesystem::current_path().parent_path() / "scenes";
+void Application::MarkCurrentSceneDirty()
+{
+	if (const auto sceneIt = m_Scenes.find(m_CurrentSceneName); sceneIt != m_Scenes.end())
+		sceneIt->second.Dirty = true;
+}
 
-	for (const auto& file : std::filesystem::directory_iterator(path))
+void Application::SaveDirtyScenes()
+{
+	for (auto& [sceneName, entry] : m_Scenes)
 	{
-		if (file.path().extension().string() == ".json")
-		{
-			std::ifstream stream(file.path());
-			std::string fileName = file.path().filename().string();
+		if (!entry.Dirty || !entry.Live || entry.PendingSave.valid())
+			continue;
 
-			std::string sceneName = fileName.substr(0, fileName.find('.'));
+		// The saved copy becomes the on-disk snapshot, so the watcher event caused by this save diffs to nothing
+		auto savedScene = std::make_shared<Scene>(*entry.Live);
+		entry.Snapshot = savedScene;
+		entry.Dirty = false;
 
-			if (stream.is_open())
+		entry.PendingSave = std::async(std::launch::async, [savedScene, path = entry.Path]() -> bool
 			{
-				json fileContents = json::parse(stream);
-				Scene scene;
-				const auto& camerasJson = fileContents["Cameras"];
+				return SceneSerializer::Save(*savedScene, path);
+			});
+	}
+}
 
+void Application::UpdateSceneSaves()
+{
+	for (auto& [sceneName, entry] : m_Scenes)
+	{
+		if (!entry.PendingSave.valid() || entry.PendingSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
 
-				if (camerasJson.type() == json::value_t::array)
-				{
-					scene.GetCameras().reserve(camerasJson.size());
-					for (const auto& cameraJson : camerasJson)
-					{
-						glm::vec3 position;
-						float yaw, pitch;
-						float fov;
-
-						if (cameraJson.contains("Position"))
-						{
-							glm::vec3 cameraPosition = {
-								cameraJson["Position"][0],
-								cameraJson["Position"][1],
-								cameraJson["Position"][2]
-							};
-
-							position = cameraPosition;
-						}
-
-						if (cameraJson.contains("Rotation"))
-						{
-							yaw = cameraJson["Rotation"][0];
-							pitch = cameraJson["Rotation"][1];
-						}
-
-						if (cameraJson.contains("FieldOfView"))
-						{
-							fov = cameraJson["FieldOfView"];
-						}
-						scene.GetCameras().emplace_back(position, yaw, pitch, fov);
-					}
-				}
+		if (entry.PendingSave.get())
+		{
+			std::error_code error;
+			entry.SavedWriteTime = std::filesystem::last_write_time(entry.Path, error);
+		}
+		else
+		{
+			entry.Dirty = true;
+		}
+	}
 
-				if (fileContents.contains("ActiveCameraIndex"))
-				{
-					scene.SetActiveCameraIndex(fileContents["ActiveCameraIndex"]);
-				}
-				else
-				{
-					scene.SetActiveCameraIndex(0);
-				}
+	const auto now = std::chrono::steady_clock::now();
+
+	if (now - m_LastAutoSave < s_AutoSaveInterval)
+		return;
 
-				const auto& spheresJson = fileContents["Spheres"];
-				const auto& materialsJson = fileContents["Materials"];
+	m_LastAutoSave = now;
+	SaveDirtyScenes();
+}
 
-				if (materialsJson.type() == json::value_t::array)
-				{
-					auto& materials = scene.GetMaterials();
+void Application::WaitForSceneSaves()
+{
+	for (auto& [sceneName, entry] : m_Scenes)
+	{
+		if (entry.PendingSave.valid() && !entry.PendingSave.get())
+			entry.Dirty = true;
+	}
+}
 
-					for (const auto& jsonMaterial : materialsJson)
-					{
-						const glm::vec3 color = { jsonMaterial["Color"][0], jsonMaterial["Color"][1],
-							jsonMaterial["Color"][2]};
+void Application::SelectScene(const std::string& sceneName)
+{
+	m_CurrentSceneName = sceneName;
 
-						const float roughness = jsonMaterial["Roughness"];
-						const float metallic = jsonMaterial["Metallic"];
-						const float specular = jsonMaterial["Specular"];
-						const float emissionPower = jsonMaterial["EmissionPower"];
-						const std::string& name = jsonMaterial["Name"];
+	SceneEntry& entry = m_Scenes.at(sceneName);
 
-						materials.emplace_back(name, std::make_unique<Material>(color, roughness, metallic, specular, emissionPower));
-					}
-				}
+	if (entry.Live)
+	{
+		ActivateScene(sceneName);
+		return;
+	}
 
-				if (spheresJson.type() == json::value_t::array)
-				{
-					scene.GetSpheres().reserve(spheresJson.size());
-					for (const auto& jsonSphere : spheresJson)
-					{
-						const std::string& name = jsonSphere["Name"];
-						const glm::vec3 position = { jsonSphere["Position"][0], jsonSphere["Position"][1], jsonSphere["Position"][2]};
-						const float radius = jsonSphere["Radius"];
-						const uint32_t materialIndex = jsonSphere["MaterialIndex"];
+	m_CurrentScene = nullptr;
+	m_SelectedSphereIndex = -1;
+	m_Renderer->SetScene(nullptr);
 
-						scene.GetSpheres().emplace_back(name, position, radius, materialIndex);
-					}
-				}
-				const glm::vec3 bgColor = 
-				{
-					fileContents["BackgroundColor"][0],
-					fileContents["BackgroundColor"][1],
-					fileContents["BackgroundColor"][2]
-				};
+	if (!entry.Loading)
+		RequestSceneLoad(sceneName, entry.Path);
+}
 
-				scene.SetBgColor(bgColor);
-				m_Scenes[sceneName] = std::make_shared<Scene>(scene);
-				m_SceneFilePaths[sceneName] = file.path().string();
+void Application::ActivateScene(const std::string& sceneName)
+{
+	const std::shared_ptr<Scene>& scene = m_Scenes.at(sceneName).Live;
 
-				stream.close();
-			}
-		}
-	}
+	m_CurrentScene = scene;
+	m_SelectedSphereIndex = -1;
+	m_Renderer->SetScene(scene);
+	m_Renderer->SetBgColor(scene->GetBgColor());
+
+	// The reset still checkpoints the accumulation of the previous scene to its own path
+	m_Renderer->ResetAccumulation();
+	m_Renderer->SetCheckpointPath(m_PathToCheckpoints / (sceneName + std::string(AccumulationCheckpoint::s_Extension)));
 }
 
-void Application::SaveJSONScenes()
+void Application::RequestSceneLoad(const std::string& sceneName, const std::filesystem::path& path)
 {
-	using json = nlohmann::json;
+	SceneEntry& entry = m_Scenes[sceneName];
+	entry.Loading = true;
+	entry.LatestLoad = ++m_SceneLoadCount;
+
+	m_PendingSceneLoads.push_back({
+		sceneName,
+		path,
+		entry.LatestLoad,
+		std::async(std::launch::async, [path]() -> std::shared_ptr<Scene>
+		{
+			return SceneSerializer::Load(path);
+		})
+	});
+}
 
-	for (const auto& [sceneName, scenePtr] : m_Scenes)
-	{
-		auto pathIt = m_SceneFilePaths.find(sceneName);
-		if (pathIt == m_SceneFilePaths.end())
+void Application::MonitorScenes()
+{
+	m_SceneWatcher->PollEvents([this](const std::string& path, FileStatus status) -> void
 		{
-			std::println("Warning: Could not find file path for scene '{}'", sceneName);
-			continue;
-		}
+			const std::filesystem::path scenePath(path);
 
-		const std::string& filePath = pathIt->second;
+			if (!SceneSerializer::IsSceneFile(scenePath))
+				return;
 
-		json sceneJson;
-		json materialsJson = json::array();
+			const std::string sceneName = SceneSerializer::SceneNameFromPath(scenePath);
+			const auto sceneIt = m_Scenes.find(sceneName);
 
-		for (const auto& materialInfo : scenePtr->GetMaterials())
-		{
-			json materialJson;
-			const auto& material = materialInfo.MaterialPtr;
+			// Ignore the other format of a scene that was discovered through a different file
+			if (sceneIt != m_Scenes.end() && sceneIt->second.Path != scenePath)
+				return;
 
-			materialJson["Name"] = materialInfo.Name;
-			materialJson["Color"] = { material->Color.r, material->Color.g, material->Color.b };
-			materialJson["Roughness"] = material->Roughness;
-			materialJson["Metallic"] = material->Metallic;
-			materialJson["Specular"] = material->Specular;
-			materialJson["EmissionPower"] = material->EmissionPower;
+			if (status == FileStatus::ERASED)
+			{
+				std::println("Scene file erased: {}", scenePath.filename().string());
 
-			materialsJson.push_back(materialJson);
-		}
-		sceneJson["Materials"] = materialsJson;
+				if (sceneIt != m_Scenes.end() && !sceneIt->second.Live && !sceneIt->second.Loading && sceneName != m_CurrentSceneName)
+					m_Scenes.erase(sceneIt);
 
-		json spheresJson = json::array();
-		for (const auto& sphere : scenePtr->GetSpheres())
-		{
-			json sphereJson;
-			glm::vec3 pos = sphere.GetPosition();
+				return;
+			}
 
-			sphereJson["Name"] = sphere.GetName();
-			sphereJson["Position"] = { pos.x, pos.y, pos.z };
-			sphereJson["Radius"] = sphere.GetRadius();
-			sphereJson["MaterialIndex"] = sphere.GetMaterialIndex();
+			SceneEntry& entry = m_Scenes[sceneName];
+			std::error_code error;
+			entry.Path = scenePath;
+			entry.FileSize = std::filesystem::file_size(scenePath, error);
 
-			spheresJson.push_back(sphereJson);
-		}
-		sceneJson["Spheres"] = spheresJson;
+			// Our own saves come back as modifications, their contents already match the snapshot
+			if (entry.Live && std::filesystem::last_write_time(scenePath, error) == entry.SavedWriteTime)
+				return;
 
-		for (const Camera& camera: scenePtr->GetCameras())
+			// Unopened scenes only need their metadata refreshed, they are read when selected
+			if (entry.Live || (sceneName == m_CurrentSceneName && !entry.Loading))
+				RequestSceneLoad(sceneName, scenePath);
+		});
+
+	auto it = m_PendingSceneLoads.begin();
+	while (it != m_PendingSceneLoads.end())
+	{
+		if (it->Future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
 		{
-			json cameraJson;
-			cameraJson["Position"] = { camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z };
-			cameraJson["Rotation"] = { camera.GetPitch(), camera.GetYaw() };
-			cameraJson["FieldOfView"] = camera.GetFieldOfView();
-			sceneJson["Cameras"].push_back(cameraJson);
+			++it;
+			continue;
 		}
 
-		sceneJson["ActiveCameraIndex"] = scenePtr->GetActiveCameraIndex();
+		OnSceneLoaded(it->SceneName, it->Path, it->Request, it->Future.get());
+		it = m_PendingSceneLoads.erase(it);
+	}
+}
 
-		glm::vec3& bgColor = scenePtr->GetBgColor();
-		sceneJson["BackgroundColor"] = { bgColor.x, bgColor.y, bgColor.z };
+void Application::OnSceneLoaded(const std::string& sceneName, const std::filesystem::path& path, const uint64_t request, const std::shared_ptr<Scene>& incoming)
+{
+	const auto entryIt = m_Scenes.find(sceneName);
 
-		if (std::ofstream outFile(filePath); outFile.is_open())
-		{
-			outFile << sceneJson.dump(4);
-			outFile.close();
-		}
+	// A slower earlier load finishing last would undo the newer one, and a scene erased meanwhile stays erased
+	if (entryIt == m_Scenes.end() || entryIt->second.LatestLoad != request)
+		return;
+
+	SceneEntry& entry = entryIt->second;
+	entry.Loading = false;
+
+	if (!incoming)
+		return;
+
+	if (!entry.Live)
+	{
+		entry.Path = path;
+		entry.Live = std::make_shared<Scene>(*incoming);
+		entry.Snapshot = incoming;
+
+		if (sceneName == m_CurrentSceneName)
+			ActivateScene(sceneName);
+
+		return;
 	}
+
+	const std::shared_ptr<Scene>& scene = entry.Live;
+	const SceneChanges changes = scene->ApplyChanges(*entry.Snapshot, *incoming);
+	entry.Snapshot = incoming;
+
+	if (!changes.Any() || scene != m_CurrentScene)
+		return;
+
+	if (m_SelectedSphereIndex >= static_cast<int>(scene->GetSphereCount()))
+		m_SelectedSphereIndex = -1;
+
+	if (changes.Background)
+		m_Renderer->SetBgColor(scene->GetBgColor());
+
+	if (m_Renderer->IsAccumulationEnabled())
+		m_Renderer->ResetAccumulation();
+}
+
+void Application::DrawLoadingPlaceholder() const
+{
+	const SceneEntry& entry = m_Scenes.at(m_CurrentSceneName);
+	const std::string text = entry.Loading ?
+		std::format("Loading {}...", m_CurrentSceneName) :
+		std::format("Couldn't load {}", entry.Path.filename().string());
+
+	ImGui::Begin("Viewport", nullptr, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
+
+	const ImVec2 available = ImGui::GetContentRegionAvail();
+	const ImVec2 textSize = ImGui::CalcTextSize(text.c_str());
+	ImGui::SetCursorPos(ImVec2((available.x - textSize.x) * 0.5f, (available.y - textSize.y) * 0.5f));
+	ImGui::TextDisabled("%s", text.c_str());
+
+	ImGui::End();
 }
 
 Application::~Application()
 {
-	SaveJSONScenes();
+	if (m_SceneWatcher)
+	{
+		m_SceneWatcher->Stop();
+		m_SceneWatcherFuture.wait();
+	}
+
+	for (auto& pendingLoad : m_PendingSceneLoads)
+	{
+		pendingLoad.Future.wait();
+	}
+
+	// Scenes edited while their last save was still running are picked up by the second pass
+	WaitForSceneSaves();
+	SaveDirtyScenes();
+	WaitForSceneSaves();
 
 	m_Window.reset();
 	m_Renderer.reset();
@@ -3,6 +3,8 @@
 
 #include <print>
 #include <memory>
+#include <charconv>
+#include <string_view>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -12,27 +14,56 @@
 #include <filesystem>
 #include <fstream>
 #include <unordered_map>
+#include <future>
 
 #include "VulkanEngine.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "SceneSerializer.h"
+#include "FileWatcher.h"
+#include "RenderFarm.h"
 
 class Application
 {
 public:
-	Application(uint32_t width, uint32_t height, const char* title, bool resizable = true, bool maximized = false, const std::string& defaultScene = "");
+	Application(uint32_t width, uint32_t height, const char* title, bool resizable = true, bool maximized = false, const std::string& defaultScene = "",
+		bool visible = true);
 	~Application();
 
 	void Run();
+
+	// Handles "--render <scene> [samples] [--max-throughput] [--multi-gpu [--split-bands] [--software-devices]]" and
+	// "--worker <host> <port>", returns false if neither was given. Accumulates the scene in a hidden window and reports
+	// the sample rate, or renders render farm jobs of a coordinator.
+	static bool RunHeadless(int argc, char** argv, int& outExitCode);
 private:
-	void Init(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized);
+	void Init(uint32_t width, uint32_t height, const char* title, bool resizable, bool maximized, bool visible);
+
+	[[nodiscard]] int RenderHeadless(uint32_t samples, bool maxThroughput);
+	[[nodiscard]] static int RunWorker(const std::string& host, uint16_t port);
+	// Waits for the scene given on the command line and sets the renderer up to accumulate in the whole window
+	[[nodiscard]] bool PrepareHeadless(bool maxThroughput);
+	void RenderHeadlessFrame();
 
 	void HandleCameraRotate(Camera& camera);
 	void HandleKeyboardInput(Camera& camera);
 	void HandleCursorInput();
 
-	void LoadJSONScenes();
-	void SaveJSONScenes();
+	void DiscoverScenes();
+
+	void MarkCurrentSceneDirty();
+	void SaveDirtyScenes();
+	void UpdateSceneSaves();
+	void WaitForSceneSaves();
+
+	void SelectScene(const std::string& sceneName);
+	void ActivateScene(const std::string& sceneName);
+	void RequestSceneLoad(const std::string& sceneName, const std::filesystem::path& path);
+
+	void MonitorScenes();
+	void OnSceneLoaded(const std::string& sceneName, const std::filesystem::path& path, uint64_t request, const std::shared_ptr<Scene>& incoming);
+
+	void DrawLoadingPlaceholder() const;
 
 	void DrawImGui();
 private:
@@ -54,16 +85,77 @@ private:
 	bool m_LeftClickPressed = false;
 	bool m_QPressed = false;
 	bool m_EPressed = false;
+	bool m_RPressed = false;
 	bool m_ViewportHovered = false;
 
+	float m_Exposure = 1.5f;
+	float m_RenderScale = 1.f;
+	float m_TargetFrameTime = 16.f;
+	float m_SampleBudget = 12.f;
+	int m_TileSizeIndex = 2;
+	bool m_SpiralFromCursor = false;
+	glm::vec2 m_CursorTileOrigin = { 0.5f, 0.5f };
+
+	static constexpr std::array<uint32_t, 5> s_TileSizes = { 64, 128, 256, 512, 0 };
+	static constexpr std::array<const char*, 5> s_TileSizeNames = { "64", "128", "256", "512", "Whole image" };
+	bool m_MultiDevice = false;
+	// Indexes MultiDeviceSplit
+	int m_MultiDeviceSplitIndex = 0;
+	static constexpr std::array<const char*, 2> s_MultiDeviceSplitNames = { "Samples", "Bands of rows" };
+	bool m_DynamicResolution = false;
 	bool m_BloomEnabled = true;
+	int m_BloomDepth = 7;
+	float m_BloomRadius = 1.f;
 	bool m_ColorGradingEnabled = true;
+	// "NONE" in the LUT combo, grading is switched off without touching the checkbox
+	bool m_LutGradingOff = false;
+	float m_LutTransitionSeconds = 0.5f;
 
 	uint32_t m_ViewportWidth;
 	uint32_t m_ViewportHeight;
 
-	std::unordered_map<std::string, std::shared_ptr<Scene>> m_Scenes;
-	std::unordered_map<std::string, std::string> m_SceneFilePaths;
+	struct SceneEntry
+	{
+		std::filesystem::path Path;
+		uintmax_t FileSize = 0;
+
+		// Null until the scene is selected for the first time
+		std::shared_ptr<Scene> Live;
+		// Last version read from disk, used to diff external edits
+		std::shared_ptr<Scene> Snapshot;
+		bool Loading = false;
+		// Loads can overlap, only the result of the newest one is applied
+		uint64_t LatestLoad = 0;
+
+		// Set by edits and camera moves, cleared once a save of the edited state has been started
+		bool Dirty = false;
+		std::future<bool> PendingSave;
+		std::filesystem::file_time_type SavedWriteTime;
+	};
+
+	static constexpr std::chrono::seconds s_AutoSaveInterval{ 5 };
+	// Longer frames mean fewer round trips between CPU and GPU, still far from a device timeout
+	static constexpr float s_HeadlessSampleBudget = 50.f;
+	std::chrono::steady_clock::time_point m_LastAutoSave = std::chrono::steady_clock::now();
+
+	std::unordered_map<std::string, SceneEntry> m_Scenes;
+
+	struct PendingSceneLoad
+	{
+		std::string SceneName;
+		std::filesystem::path Path;
+		uint64_t Request;
+		std::future<std::shared_ptr<Scene>> Future;
+	};
+
+	std::vector<PendingSceneLoad> m_PendingSceneLoads;
+	uint64_t m_SceneLoadCount = 0;
+
+	std::filesystem::path m_PathToScenes = std::filesystem::current_path().parent_path() / "scenes";
+	// One accumulation checkpoint per scene, named after it
+	std::filesystem::path m_PathToCheckpoints = std::filesystem::current_path().parent_path() / "checkpoints";
+	std::unique_ptr<FileWatcher> m_SceneWatcher;
+	std::future<void> m_SceneWatcherFuture;
 
 	std::shared_ptr<Scene> m_CurrentScene;
 	std::string m_CurrentSceneName;
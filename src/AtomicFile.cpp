@@ -0,0 +1,95 @@
+#include "AtomicFile.h"
+
+#include <print>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// The stream is closed by then, so the contents are flushed to the OS through a fresh handle
+	bool SyncFile(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		const bool synced = FlushFileBuffers(file);
+		CloseHandle(file);
+		return synced;
+#else
+		const int fd = open(path.c_str(), O_RDWR);
+
+		if (fd < 0)
+			return false;
+
+		const bool synced = fsync(fd) == 0;
+		close(fd);
+		return synced;
+#endif
+	}
+
+	// Makes the rename itself durable. NTFS journals it, Windows has no directory handle to flush.
+	bool SyncDirectory(const std::filesystem::path& path)
+	{
+#ifdef _WIN32
+		return true;
+#else
+		const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+		const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+
+		if (fd < 0)
+			return false;
+
+		const bool synced = fsync(fd) == 0;
+		close(fd);
+		return synced;
+#endif
+	}
+}
+
+bool WriteFileAtomically(const std::filesystem::path& path, const std::function<void(std::ofstream&)>& writer, bool binary)
+{
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+
+	std::ofstream stream(tempPath, binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+
+	if (!stream.is_open())
+	{
+		std::println("Couldn't write file: {}", path.string());
+		return false;
+	}
+
+	writer(stream);
+	stream.close();
+
+	std::error_code error;
+
+	// Without the sync a crash right after the rename can leave the target empty or truncated
+	const bool written = stream && SyncFile(tempPath);
+
+	if (written)
+		std::filesystem::rename(tempPath, path, error);
+
+	if (!written || error)
+	{
+		std::println("Couldn't write file: {}", path.string());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	if (!SyncDirectory(path))
+		std::println("Couldn't sync the directory of file: {}", path.string());
+
+	return true;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+// Writes to a temp file next to the target and renames it over the target once the write succeeded.
+// Readers (and memory mappings) see either the old or the new contents, never a partial file.
+bool WriteFileAtomically(const std::filesystem::path& path, const std::function<void(std::ofstream&)>& writer, bool binary = false);
@@ -0,0 +1,172 @@
+#include "BinaryScene.h"
+
+#include <algorithm>
+#include <print>
+#include <vector>
+
+#include "AtomicFile.h"
+#include "Scene.h"
+
+namespace
+{
+	constexpr uint64_t s_SectionAlignment = 16;
+
+	uint64_t AlignSection(uint64_t offset)
+	{
+		return (offset + s_SectionAlignment - 1) & ~(s_SectionAlignment - 1);
+	}
+
+	bool IsSectionValid(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+	{
+		return offset % s_SectionAlignment == 0 && offset <= fileSize && count * elementSize <= fileSize - offset;
+	}
+
+	template<typename T>
+	std::span<const T> SectionView(std::span<const std::byte> data, uint64_t offset, uint32_t count)
+	{
+		return { reinterpret_cast<const T*>(data.data() + offset), count };
+	}
+
+	template<typename T>
+	void WriteSection(std::ofstream& stream, uint64_t offset, std::span<const T> elements)
+	{
+		constexpr std::array<char, s_SectionAlignment> zeros = {};
+		const auto currentOffset = static_cast<uint64_t>(stream.tellp());
+		stream.write(zeros.data(), static_cast<std::streamsize>(offset - currentOffset));
+		stream.write(reinterpret_cast<const char*>(elements.data()), static_cast<std::streamsize>(elements.size_bytes()));
+	}
+}
+
+bool BinarySceneFile::Open(const std::filesystem::path& path)
+{
+	m_Header = nullptr;
+
+	if (!m_File.Open(path))
+		return false;
+
+	const std::span<const std::byte> data = m_File.GetData();
+
+	if (data.size() < sizeof(BinarySceneHeader))
+	{
+		std::println("Binary scene is truncated: {}", path.string());
+		return false;
+	}
+
+	const auto* header = reinterpret_cast<const BinarySceneHeader*>(data.data());
+
+	if (header->Magic != s_Magic || header->Version != s_Version)
+	{
+		std::println("Unsupported binary scene (version {}): {}", header->Version, path.string());
+		return false;
+	}
+
+	const uint64_t nameCount = static_cast<uint64_t>(header->SphereCount) + header->MaterialCount + 1;
+	const uint64_t nameDataOffset = header->NameOffset + nameCount * sizeof(uint32_t);
+
+	const bool sectionsValid =
+		IsSectionValid(header->PositionOffset, header->SphereCount, sizeof(glm::vec3), data.size()) &&
+		IsSectionValid(header->RadiusOffset, header->SphereCount, sizeof(float), data.size()) &&
+		IsSectionValid(header->MaterialIndexOffset, header->SphereCount, sizeof(uint32_t), data.size()) &&
+		IsSectionValid(header->MaterialOffset, header->MaterialCount, sizeof(Material), data.size()) &&
+		IsSectionValid(header->CameraOffset, header->CameraCount, sizeof(BinaryCamera), data.size()) &&
+		IsSectionValid(header->NameOffset, nameCount, sizeof(uint32_t), data.size()) &&
+		header->NameTableSize <= data.size() - nameDataOffset;
+
+	if (!sectionsValid)
+	{
+		std::println("Binary scene has out of range sections: {}", path.string());
+		return false;
+	}
+
+	m_SpherePositions = SectionView<glm::vec3>(data, header->PositionOffset, header->SphereCount);
+	m_SphereRadii = SectionView<float>(data, header->RadiusOffset, header->SphereCount);
+	m_SphereMaterialIndices = SectionView<uint32_t>(data, header->MaterialIndexOffset, header->SphereCount);
+	m_Materials = SectionView<Material>(data, header->MaterialOffset, header->MaterialCount);
+	m_Cameras = SectionView<BinaryCamera>(data, header->CameraOffset, header->CameraCount);
+	m_NameOffsets = SectionView<uint32_t>(data, header->NameOffset, static_cast<uint32_t>(nameCount));
+	m_NameData = reinterpret_cast<const char*>(data.data() + nameDataOffset);
+
+	// The sections are handed to the GPU untouched, so anything the shader indexes with has to be checked here
+	const bool namesValid = m_NameOffsets.front() == 0 && m_NameOffsets.back() == header->NameTableSize &&
+		std::ranges::is_sorted(m_NameOffsets);
+	const bool materialIndicesValid = std::ranges::all_of(m_SphereMaterialIndices, [header](uint32_t materialIndex) -> bool
+		{
+			return materialIndex < header->MaterialCount;
+		});
+
+	if (!namesValid || !materialIndicesValid)
+	{
+		std::println("Binary scene has invalid name or material indices: {}", path.string());
+		return false;
+	}
+
+	m_Header = header;
+	return true;
+}
+
+bool BinarySceneFile::Write(const Scene& scene, const std::filesystem::path& path)
+{
+	const uint32_t sphereCount = scene.GetSphereCount();
+	const uint32_t materialCount = scene.GetMaterialCount();
+	const std::span<const Camera> cameras = scene.GetCameras();
+
+	std::vector<uint32_t> nameOffsets;
+	std::string nameData;
+	nameOffsets.reserve(sphereCount + materialCount + 1);
+
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+		nameData += scene.GetSphereName(i);
+	}
+
+	for (uint32_t i = 0; i < materialCount; i++)
+	{
+		nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+		nameData += scene.GetMaterialName(i);
+	}
+
+	nameOffsets.push_back(static_cast<uint32_t>(nameData.size()));
+
+	std::vector<BinaryCamera> binaryCameras;
+	binaryCameras.reserve(cameras.size());
+	for (const Camera& camera : cameras)
+	{
+		binaryCameras.push_back({ camera.GetPosition(), camera.GetPitch(), camera.GetYaw(), camera.GetFieldOfView() });
+	}
+
+	BinarySceneHeader header = {};
+	header.Magic = s_Magic;
+	header.Version = s_Version;
+	header.SphereCount = sphereCount;
+	header.MaterialCount = materialCount;
+	header.CameraCount = static_cast<uint32_t>(cameras.size());
+	header.ActiveCameraIndex = scene.GetActiveCameraIndex();
+	header.BackgroundColor = scene.GetBgColor();
+	header.NameTableSize = static_cast<uint32_t>(nameData.size());
+	header.PositionOffset = AlignSection(sizeof(BinarySceneHeader));
+	header.RadiusOffset = AlignSection(header.PositionOffset + sphereCount * sizeof(glm::vec3));
+	header.MaterialIndexOffset = AlignSection(header.RadiusOffset + sphereCount * sizeof(float));
+	header.MaterialOffset = AlignSection(header.MaterialIndexOffset + sphereCount * sizeof(uint32_t));
+	header.CameraOffset = AlignSection(header.MaterialOffset + materialCount * sizeof(Material));
+	header.NameOffset = AlignSection(header.CameraOffset + cameras.size() * sizeof(BinaryCamera));
+
+	// Renamed over the target, so scenes that are currently mapped keep their old contents
+	return WriteFileAtomically(path, [&](std::ofstream& stream) -> void
+		{
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			WriteSection(stream, header.PositionOffset, scene.GetSpherePositions());
+			WriteSection(stream, header.RadiusOffset, scene.GetSphereRadii());
+			WriteSection(stream, header.MaterialIndexOffset, scene.GetSphereMaterialIndices());
+			WriteSection(stream, header.MaterialOffset, scene.GetMaterials());
+			WriteSection(stream, header.CameraOffset, std::span<const BinaryCamera>(binaryCameras));
+			WriteSection(stream, header.NameOffset, std::span<const uint32_t>(nameOffsets));
+			stream.write(nameData.data(), static_cast<std::streamsize>(nameData.size()));
+		}, true);
+}
+
+std::string_view BinarySceneFile::GetName(uint32_t index) const
+{
+	return { m_NameData + m_NameOffsets[index], m_NameOffsets[index + 1] - m_NameOffsets[index] };
+}
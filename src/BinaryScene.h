@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "Material.h"
+#include "MappedFile.h"
+
+class Scene;
+
+/*
+ * Binary scene layout (little endian, every section 16 byte aligned):
+ *   BinarySceneHeader
+ *   glm::vec3 Positions[SphereCount]
+ *   float Radii[SphereCount]
+ *   uint32_t MaterialIndices[SphereCount]
+ *   Material Materials[MaterialCount]
+ *   BinaryCamera[CameraCount]
+ *   uint32_t NameOffsets[SphereCount + MaterialCount + 1], followed by the name characters
+ * The sphere and material sections are the arrays the GPU buffers expect and can be copied as they are.
+ */
+struct BinarySceneHeader
+{
+	std::array<char, 4> Magic;
+	uint32_t Version;
+	uint32_t SphereCount;
+	uint32_t MaterialCount;
+	uint32_t CameraCount;
+	uint32_t ActiveCameraIndex;
+	glm::vec3 BackgroundColor;
+	uint32_t NameTableSize;
+	uint64_t PositionOffset;
+	uint64_t RadiusOffset;
+	uint64_t MaterialIndexOffset;
+	uint64_t MaterialOffset;
+	uint64_t CameraOffset;
+	uint64_t NameOffset;
+};
+
+struct BinaryCamera
+{
+	glm::vec3 Position;
+	float Pitch;
+	float Yaw;
+	float FieldOfView;
+};
+
+static_assert(sizeof(BinarySceneHeader) == 88 && std::is_trivially_copyable_v<BinarySceneHeader>);
+static_assert(sizeof(BinaryCamera) == 24 && std::is_trivially_copyable_v<BinaryCamera>);
+
+class BinarySceneFile
+{
+public:
+	static constexpr std::array<char, 4> s_Magic = { 'R', 'T', 'S', 'C' };
+	static constexpr uint32_t s_Version = 2;
+
+	// Maps the file and validates every section, the returned views point into the mapping
+	[[nodiscard]] bool Open(const std::filesystem::path& path);
+
+	static bool Write(const Scene& scene, const std::filesystem::path& path);
+
+	[[nodiscard]] const BinarySceneHeader& GetHeader() const { return *m_Header; }
+	[[nodiscard]] std::span<const glm::vec3> GetSpherePositions() const { return m_SpherePositions; }
+	[[nodiscard]] std::span<const float> GetSphereRadii() const { return m_SphereRadii; }
+	[[nodiscard]] std::span<const uint32_t> GetSphereMaterialIndices() const { return m_SphereMaterialIndices; }
+	[[nodiscard]] std::span<const Material> GetMaterials() const { return m_Materials; }
+	[[nodiscard]] std::span<const BinaryCamera> GetCameras() const { return m_Cameras; }
+
+	[[nodiscard]] std::string_view GetSphereName(uint32_t index) const { return GetName(index); }
+	[[nodiscard]] std::string_view GetMaterialName(uint32_t index) const { return GetName(m_Header->SphereCount + index); }
+
+private:
+	[[nodiscard]] std::string_view GetName(uint32_t index) const;
+
+private:
+	MappedFile m_File;
+	const BinarySceneHeader* m_Header = nullptr;
+
+	std::span<const glm::vec3> m_SpherePositions;
+	std::span<const float> m_SphereRadii;
+	std::span<const uint32_t> m_SphereMaterialIndices;
+	std::span<const Material> m_Materials;
+	std::span<const BinaryCamera> m_Cameras;
+	std::span<const uint32_t> m_NameOffsets;
+	const char* m_NameData = nullptr;
+};
@@ -0,0 +1,353 @@
+#include "CubeLut.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <print>
+#include <span>
+#include <string_view>
+
+#include <glm.hpp>
+#include <gtc/packing.hpp>
+
+#include "AtomicFile.h"
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr std::array<char, 4> s_CacheMagic = { 'R', 'T', 'L', 'C' };
+	constexpr uint32_t s_CacheVersion = 2;
+	constexpr std::string_view s_CacheExtension = ".lutcache";
+	constexpr uint32_t s_MaxLutSize = 256;
+
+	struct LutCacheHeader
+	{
+		std::array<char, 4> Magic;
+		uint32_t Version;
+		uint32_t Size;
+		CubeLutFormat Format;
+		uint64_t SourceHash;
+		float MaxError;
+		uint32_t Reserved;
+	};
+
+	// FNV-1a, only used to notice that a .cube file changed since it was cached
+	uint64_t HashBytes(std::span<const std::byte> bytes)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (const std::byte byte : bytes)
+		{
+			hash ^= static_cast<uint64_t>(byte);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	uint64_t TexelCount(uint32_t size)
+	{
+		return static_cast<uint64_t>(size) * size * size;
+	}
+
+	size_t TexelSize(CubeLutFormat format)
+	{
+		return format == CubeLutFormat::A2B10G10R10_UNORM ? sizeof(uint32_t) : sizeof(uint64_t);
+	}
+
+	template<typename T>
+	void AppendTexel(std::vector<std::byte>& texels, T packed)
+	{
+		const auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(packed);
+		texels.insert(texels.end(), bytes.begin(), bytes.end());
+	}
+
+	float EncodingError(std::span<const glm::vec3> rgb, CubeLutFormat format)
+	{
+		float maxError = 0.f;
+
+		for (const glm::vec3& color : rgb)
+		{
+			const glm::vec4 texel(color, 1.f);
+			const glm::vec4 decoded = format == CubeLutFormat::A2B10G10R10_UNORM
+				? glm::unpackUnorm3x10_1x2(glm::packUnorm3x10_1x2(texel))
+				: glm::unpackHalf4x16(glm::packHalf4x16(texel));
+
+			const glm::vec3 error = glm::abs(glm::vec3(decoded) - color);
+			maxError = std::max({ maxError, error.r, error.g, error.b });
+		}
+
+		return maxError;
+	}
+
+	// Measures the round trip error of each format and keeps the smallest one inside the budget.
+	// Tables with values outside [0, 1] can only go to half floats.
+	CubeLut Encode(uint32_t size, std::span<const glm::vec3> rgb)
+	{
+		CubeLut lut;
+		lut.Size = size;
+		lut.Format = CubeLutFormat::A2B10G10R10_UNORM;
+		lut.MaxError = EncodingError(rgb, lut.Format);
+
+		if (lut.MaxError > CubeLutLoader::s_ErrorBudget)
+		{
+			lut.Format = CubeLutFormat::R16G16B16A16_SFLOAT;
+			lut.MaxError = EncodingError(rgb, lut.Format);
+		}
+
+		lut.Texels.reserve(rgb.size() * TexelSize(lut.Format));
+
+		for (const glm::vec3& color : rgb)
+		{
+			if (lut.Format == CubeLutFormat::A2B10G10R10_UNORM)
+				AppendTexel(lut.Texels, glm::packUnorm3x10_1x2(glm::vec4(color, 1.f)));
+			else
+				AppendTexel(lut.Texels, glm::packHalf4x16(glm::vec4(color, 1.f)));
+		}
+
+		return lut;
+	}
+
+	bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipBlanks(const char* it, const char* end)
+	{
+		while (it != end && IsBlank(*it))
+			++it;
+
+		return it;
+	}
+
+	// Reads whitespace separated floats from one line, returns false if the line holds fewer than expected
+	bool ParseFloats(const char* it, const char* end, std::span<float> out)
+	{
+		for (float& value : out)
+		{
+			it = SkipBlanks(it, end);
+
+			if (it != end && *it == '+')
+				++it;
+
+			const auto [next, error] = std::from_chars(it, end, value);
+			if (error != std::errc())
+				return false;
+
+			it = next;
+		}
+
+		return true;
+	}
+
+	std::optional<CubeLut> ParseCube(std::string_view text, const std::filesystem::path& path)
+	{
+		uint32_t size = 0;
+		std::vector<glm::vec3> rgb;
+		std::array<float, 3> domainMin = { 0.f, 0.f, 0.f };
+		std::array<float, 3> domainMax = { 1.f, 1.f, 1.f };
+
+		const char* it = text.data();
+		const char* const end = text.data() + text.size();
+		uint64_t lineNumber = 0;
+
+		while (it != end)
+		{
+			const char* lineEnd = it;
+			while (lineEnd != end && *lineEnd != '\n')
+				++lineEnd;
+
+			const char* const lineStart = SkipBlanks(it, lineEnd);
+			it = lineEnd == end ? end : lineEnd + 1;
+			lineNumber++;
+
+			if (lineStart == lineEnd || *lineStart == '#')
+				continue;
+
+			const bool isKeyword = (*lineStart >= 'A' && *lineStart <= 'Z') || (*lineStart >= 'a' && *lineStart <= 'z');
+
+			if (!isKeyword)
+			{
+				glm::vec3& color = rgb.emplace_back();
+				if (!ParseFloats(lineStart, lineEnd, { &color.x, 3 }))
+				{
+					std::println("Invalid LUT row at line {}: {}", lineNumber, path.string());
+					return std::nullopt;
+				}
+
+				continue;
+			}
+
+			const char* keywordEnd = lineStart;
+			while (keywordEnd != lineEnd && !IsBlank(*keywordEnd))
+				++keywordEnd;
+
+			const std::string_view keyword(lineStart, keywordEnd);
+
+			if (keyword == "LUT_3D_SIZE")
+			{
+				const char* valueStart = SkipBlanks(keywordEnd, lineEnd);
+				const auto [next, error] = std::from_chars(valueStart, lineEnd, size);
+
+				if (error != std::errc() || size < 2 || size > s_MaxLutSize)
+				{
+					std::println("Invalid LUT_3D_SIZE at line {}: {}", lineNumber, path.string());
+					return std::nullopt;
+				}
+
+				rgb.reserve(TexelCount(size));
+			}
+			else if (keyword == "LUT_1D_SIZE")
+			{
+				std::println("1D LUTs are not supported: {}", path.string());
+				return std::nullopt;
+			}
+			else if ((keyword == "DOMAIN_MIN" && !ParseFloats(keywordEnd, lineEnd, domainMin)) ||
+				(keyword == "DOMAIN_MAX" && !ParseFloats(keywordEnd, lineEnd, domainMax)))
+			{
+				std::println("Invalid LUT domain at line {}: {}", lineNumber, path.string());
+				return std::nullopt;
+			}
+			// TITLE and vendor specific keywords don't affect the table
+		}
+
+		const uint64_t rowCount = rgb.size();
+
+		// Headerless files are bare rows, the cube side is implied by their count
+		if (size == 0)
+			size = static_cast<uint32_t>(std::lround(std::cbrt(static_cast<double>(rowCount))));
+
+		if (rowCount == 0 || size < 2 || rowCount != TexelCount(size))
+		{
+			std::println("LUT has {} rows, expected a {}^3 table: {}", rowCount, size, path.string());
+			return std::nullopt;
+		}
+
+		if (domainMin != std::array{ 0.f, 0.f, 0.f } || domainMax != std::array{ 1.f, 1.f, 1.f })
+			std::println("LUT domain other than [0, 1] is ignored: {}", path.string());
+
+		CubeLut lut = Encode(size, rgb);
+
+		if (lut.MaxError > CubeLutLoader::s_ErrorBudget)
+			std::println("LUT exceeds the error budget ({} > {}): {}", lut.MaxError, CubeLutLoader::s_ErrorBudget, path.string());
+
+		return lut;
+	}
+
+	std::optional<CubeLut> ReadCache(const std::filesystem::path& cachePath, uint64_t sourceHash)
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(cachePath, error))
+			return std::nullopt;
+
+		MappedFile file;
+
+		if (!file.Open(cachePath))
+			return std::nullopt;
+
+		const std::span<const std::byte> data = file.GetData();
+
+		if (data.size() < sizeof(LutCacheHeader))
+			return std::nullopt;
+
+		const auto* header = reinterpret_cast<const LutCacheHeader*>(data.data());
+
+		const bool formatValid = header->Format == CubeLutFormat::A2B10G10R10_UNORM || header->Format == CubeLutFormat::R16G16B16A16_SFLOAT;
+		const bool headerValid = header->Magic == s_CacheMagic && header->Version == s_CacheVersion &&
+			header->SourceHash == sourceHash && header->Size <= s_MaxLutSize && formatValid &&
+			data.size() == sizeof(LutCacheHeader) + TexelCount(header->Size) * TexelSize(header->Format);
+
+		if (!headerValid)
+			return std::nullopt;
+
+		CubeLut lut;
+		lut.Size = header->Size;
+		lut.Format = header->Format;
+		lut.MaxError = header->MaxError;
+		lut.Texels.assign(data.begin() + sizeof(LutCacheHeader), data.end());
+
+		return lut;
+	}
+
+	void WriteCache(const std::filesystem::path& cachePath, uint64_t sourceHash, const CubeLut& lut)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+		LutCacheHeader header = {};
+		header.Magic = s_CacheMagic;
+		header.Version = s_CacheVersion;
+		header.Size = lut.Size;
+		header.Format = lut.Format;
+		header.SourceHash = sourceHash;
+		header.MaxError = lut.MaxError;
+
+		const bool written = WriteFileAtomically(cachePath, [&header, &lut](std::ofstream& stream) -> void
+			{
+				stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				stream.write(reinterpret_cast<const char*>(lut.Texels.data()), static_cast<std::streamsize>(lut.Texels.size()));
+			}, true);
+
+		if (!written)
+			std::println("Couldn't write LUT cache: {}", cachePath.string());
+	}
+}
+
+std::optional<CubeLut> CubeLutLoader::LoadCube(const std::filesystem::path& path)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+	{
+		std::println("Couldn't open LUT: {}", path.string());
+		return std::nullopt;
+	}
+
+	const std::span<const std::byte> data = file.GetData();
+	return ParseCube({ reinterpret_cast<const char*>(data.data()), data.size() }, path);
+}
+
+std::optional<CubeLut> CubeLutLoader::Load(const std::filesystem::path& path, const std::filesystem::path& cacheDirectory)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+	{
+		std::println("Couldn't open LUT: {}", path.string());
+		return std::nullopt;
+	}
+
+	const std::span<const std::byte> data = file.GetData();
+	const uint64_t sourceHash = HashBytes(data);
+
+	std::filesystem::path cachePath = cacheDirectory / path.filename();
+	cachePath.replace_extension(s_CacheExtension);
+
+	if (std::optional<CubeLut> cached = ReadCache(cachePath, sourceHash))
+		return cached;
+
+	std::optional<CubeLut> lut = ParseCube({ reinterpret_cast<const char*>(data.data()), data.size() }, path);
+
+	if (lut)
+		WriteCache(cachePath, sourceHash, *lut);
+
+	return lut;
+}
+
+CubeLut CubeLutLoader::MakeIdentity(uint32_t size)
+{
+	std::vector<glm::vec3> rgb;
+	rgb.reserve(TexelCount(size));
+
+	const float scale = 1.f / static_cast<float>(size - 1);
+
+	for (uint32_t b = 0; b < size; b++)
+		for (uint32_t g = 0; g < size; g++)
+			for (uint32_t r = 0; r < size; r++)
+				rgb.emplace_back(r * scale, g * scale, b * scale);
+
+	return Encode(size, rgb);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+enum class CubeLutFormat : uint32_t
+{
+	A2B10G10R10_UNORM,
+	R16G16B16A16_SFLOAT
+};
+
+// A 3D colour grading table encoded in the smallest texel format that stays within s_ErrorBudget.
+// Texels are in red-fastest order as the .cube format stores them.
+struct CubeLut
+{
+	uint32_t Size = 0;
+	CubeLutFormat Format = CubeLutFormat::A2B10G10R10_UNORM;
+	float MaxError = 0.f;
+	std::vector<std::byte> Texels;
+};
+
+namespace CubeLutLoader
+{
+	inline constexpr std::string_view s_Extension = ".cube";
+
+	// Half a step of the 8 bit swapchain, anything below that can't show up in the final image
+	inline constexpr float s_ErrorBudget = 0.5f / 255.f;
+
+	// Parses a .cube file. LUT_3D_SIZE is honoured, files without a header get their size from the row count.
+	[[nodiscard]] std::optional<CubeLut> LoadCube(const std::filesystem::path& path);
+
+	// Returns the cached texels when the cache entry matches the hash of the .cube contents,
+	// otherwise parses the text and refreshes the cache
+	[[nodiscard]] std::optional<CubeLut> Load(const std::filesystem::path& path, const std::filesystem::path& cacheDirectory);
+
+	// Table that leaves colours unchanged, used while the selected table is still streaming in
+	[[nodiscard]] CubeLut MakeIdentity(uint32_t size);
+}
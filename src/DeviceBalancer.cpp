@@ -0,0 +1,103 @@
+#include "DeviceBalancer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+void DeviceBalancer::Reset(size_t deviceCount)
+{
+	m_Throughput.assign(deviceCount, 0.0);
+}
+
+void DeviceBalancer::RemoveDevice(size_t device)
+{
+	if (device < m_Throughput.size())
+		m_Throughput.erase(m_Throughput.begin() + static_cast<std::ptrdiff_t>(device));
+}
+
+void DeviceBalancer::AddMeasurement(size_t device, uint64_t pixelSamples, double seconds)
+{
+	if (device >= m_Throughput.size() || pixelSamples == 0 || seconds <= 0.0)
+		return;
+
+	const double throughput = static_cast<double>(pixelSamples) / seconds;
+	double& smoothed = m_Throughput[device];
+	smoothed = smoothed > 0.0 ? std::lerp(smoothed, throughput, s_Smoothing) : throughput;
+}
+
+double DeviceBalancer::GetThroughput(size_t device) const
+{
+	if (device < m_Throughput.size() && m_Throughput[device] > 0.0)
+		return m_Throughput[device];
+
+	return GetAverageThroughput();
+}
+
+double DeviceBalancer::GetShare(size_t device, std::span<const size_t> devices) const
+{
+	double total = 0.0;
+	for (const size_t other : devices)
+		total += GetThroughput(other);
+
+	// Nothing measured yet, every device is assumed as fast as the others
+	if (total <= 0.0)
+		return devices.empty() ? 0.0 : 1.0 / static_cast<double>(devices.size());
+
+	return GetThroughput(device) / total;
+}
+
+std::vector<uint32_t> DeviceBalancer::SplitRows(uint32_t rows, std::span<const size_t> devices) const
+{
+	std::vector<uint32_t> split(devices.size(), 0);
+
+	if (devices.empty())
+		return split;
+
+	// Fewer rows than devices, the first ones get one each
+	if (rows < devices.size())
+	{
+		std::fill_n(split.begin(), rows, 1u);
+		return split;
+	}
+
+	const uint32_t spare = rows - static_cast<uint32_t>(devices.size());
+	std::vector<double> remainders(devices.size());
+	uint32_t assigned = 0;
+
+	for (size_t i = 0; i < devices.size(); i++)
+	{
+		const double exact = GetShare(devices[i], devices) * spare;
+		const double whole = std::floor(exact);
+
+		split[i] = 1 + static_cast<uint32_t>(whole);
+		remainders[i] = exact - whole;
+		assigned += static_cast<uint32_t>(whole);
+	}
+
+	// Rows lost to rounding go to the largest remainders
+	std::vector<size_t> order(devices.size());
+	std::iota(order.begin(), order.end(), size_t{ 0 });
+	std::ranges::sort(order, [&remainders](size_t a, size_t b) -> bool { return remainders[a] > remainders[b]; });
+
+	for (size_t i = 0; assigned < spare; i = (i + 1) % order.size(), assigned++)
+		split[order[i]]++;
+
+	return split;
+}
+
+double DeviceBalancer::GetAverageThroughput() const
+{
+	double total = 0.0;
+	size_t measured = 0;
+
+	for (const double throughput : m_Throughput)
+	{
+		if (throughput > 0.0)
+		{
+			total += throughput;
+			measured++;
+		}
+	}
+
+	return measured > 0 ? total / static_cast<double>(measured) : 0.0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Splits accumulation work between GPUs in proportion to their measured throughput, in pixel samples per second of wall clock.
+// A device without a measurement yet is assumed to be as fast as the average of the measured ones.
+class DeviceBalancer
+{
+public:
+	// Forgets every measurement, device 0 is the engine's own GPU
+	void Reset(size_t deviceCount);
+	void RemoveDevice(size_t device);
+	void AddMeasurement(size_t device, uint64_t pixelSamples, double seconds);
+
+	// Zero while no device has been measured
+	[[nodiscard]] double GetThroughput(size_t device) const;
+	// Fraction of the combined throughput of the given devices that the device contributes
+	[[nodiscard]] double GetShare(size_t device, std::span<const size_t> devices) const;
+	// Rows of every given device in order, every device gets at least one as long as there are enough
+	[[nodiscard]] std::vector<uint32_t> SplitRows(uint32_t rows, std::span<const size_t> devices) const;
+
+	[[nodiscard]] size_t GetDeviceCount() const { return m_Throughput.size(); }
+private:
+	[[nodiscard]] double GetAverageThroughput() const;
+private:
+	// Zero until the first measurement
+	std::vector<double> m_Throughput;
+
+	static constexpr double s_Smoothing = 0.3;
+};
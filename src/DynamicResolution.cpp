@@ -0,0 +1,42 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+float DynamicResolution::Update(float gpuTimeMs)
+{
+	if (gpuTimeMs <= 0.f)
+		return m_Scale;
+
+	if (m_SettleFrames > 0)
+	{
+		m_SettleFrames--;
+		return m_Scale;
+	}
+
+	m_SmoothedTimeMs = m_SmoothedTimeMs > 0.f ? std::lerp(m_SmoothedTimeMs, gpuTimeMs, s_Smoothing) : gpuTimeMs;
+
+	const float ratio = m_TargetTimeMs / m_SmoothedTimeMs;
+
+	if (std::abs(ratio - 1.f) <= s_Tolerance)
+		return m_Scale;
+
+	const float desired = m_Scale * std::sqrt(ratio);
+	const float scale = std::clamp(std::clamp(desired, m_Scale - s_MaxStep, m_Scale + s_MaxStep), m_MinScale, m_MaxScale);
+
+	if (scale != m_Scale)
+	{
+		m_Scale = scale;
+		m_SmoothedTimeMs = 0.f;
+		m_SettleFrames = s_SettleFrameCount;
+	}
+
+	return m_Scale;
+}
+
+void DynamicResolution::Reset(float scale)
+{
+	m_Scale = std::clamp(scale, m_MinScale, m_MaxScale);
+	m_SmoothedTimeMs = 0.f;
+	m_SettleFrames = 0;
+}
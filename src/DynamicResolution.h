@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks the render scale that keeps the GPU frame time near a target. GPU time is assumed to follow the pixel count,
+// so the area is scaled by target / measured and the side length by its square root.
+class DynamicResolution
+{
+public:
+	// Feeds the GPU time of the latest finished frame and returns the scale for the next one
+	float Update(float gpuTimeMs);
+	// Restarts from the given scale, e.g. when the controller is switched on
+	void Reset(float scale);
+
+	void SetTargetTime(float milliseconds) { m_TargetTimeMs = milliseconds; }
+	void SetScaleRange(float minScale, float maxScale) { m_MinScale = minScale; m_MaxScale = maxScale; }
+
+	[[nodiscard]] float GetScale() const { return m_Scale; }
+	[[nodiscard]] float GetTargetTime() const { return m_TargetTimeMs; }
+private:
+	float m_TargetTimeMs = 16.f;
+	float m_MinScale = 0.5f;
+	float m_MaxScale = 1.f;
+
+	float m_Scale = 1.f;
+	float m_SmoothedTimeMs = 0.f;
+	uint32_t m_SettleFrames = 0;
+
+	// Frames in flight still report the previous scale for a while after a change
+	static constexpr uint32_t s_SettleFrameCount = 4;
+	static constexpr float s_Smoothing = 0.15f;
+	// No change while the smoothed time is within this fraction of the target
+	static constexpr float s_Tolerance = 0.05f;
+	static constexpr float s_MaxStep = 0.05f;
+};
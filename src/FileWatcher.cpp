@@ -1,5 +1,22 @@
 #include "FileWatcher.h"
 
+#include <print>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	bool IsInside(const std::string& path, const std::string& directory)
+	{
+		return path.size() > directory.size() && path.starts_with(directory) &&
+			path[directory.size()] == std::filesystem::path::preferred_separator;
+	}
+}
+
 FileWatcher::FileWatcher(const std::filesystem::path& pathToWatch, std::chrono::duration<int, std::milli> delay)
 	: m_PathToWatch(pathToWatch), m_Delay(delay), m_Running(true)
 {
@@ -9,7 +26,27 @@ FileWatcher::FileWatcher(const std::filesystem::path& pathToWatch, std::chrono::
 	}
 }
 
-void FileWatcher::Start(const std::function<void(const std::string&, FileStatus)>& action)
+void FileWatcher::Start()
+{
+#ifdef __linux__
+	if (RunInotify())
+		return;
+
+	std::println("inotify unavailable, polling {} instead", m_PathToWatch.string());
+#endif
+
+	RunPolling();
+}
+
+void FileWatcher::PollEvents(const std::function<void(const std::string&, FileStatus)>& action)
+{
+	while (const std::optional<FileEvent> event = m_Events.Pop())
+	{
+		action(event->Path, event->Status);
+	}
+}
+
+void FileWatcher::RunPolling()
 {
 	while (m_Running)
 	{
@@ -20,7 +57,7 @@ void FileWatcher::Start(const std::function<void(const std::string&, FileStatus)
 		{
 			if (!std::filesystem::exists(it->first))
 			{
-				action(it->first, FileStatus::ERASED);
+				Publish(it->first, FileStatus::ERASED);
 				it = m_Paths.erase(it);
 			}
 			else
@@ -37,17 +74,270 @@ void FileWatcher::Start(const std::function<void(const std::string&, FileStatus)
 			if (!m_Paths.contains(pathString))
 			{
 				m_Paths[pathString] = currentFileLastWriteTime;
-				action(pathString, FileStatus::CREATED);
+				Publish(pathString, FileStatus::CREATED);
 			}
 			else
 			{
 				if (m_Paths[pathString] != currentFileLastWriteTime)
 				{
 					m_Paths[pathString] = currentFileLastWriteTime;
-					action(pathString, FileStatus::MODIFIED);
+					Publish(pathString, FileStatus::MODIFIED);
+				}
+			}
+		}
+
+	}
+}
+
+#ifdef __linux__
+bool FileWatcher::RunInotify()
+{
+	const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (fd < 0)
+		return false;
+
+	constexpr uint32_t watchMask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+	std::unordered_map<int, std::filesystem::path> watches;
+
+	const auto addWatch = [&](const std::filesystem::path& directory) -> void
+	{
+		const int wd = inotify_add_watch(fd, directory.c_str(), watchMask);
+		if (wd >= 0)
+			watches[wd] = directory;
+	};
+
+	// Watching an already watched directory again returns its existing descriptor
+	const auto watchTree = [&](const std::filesystem::path& directory) -> void
+	{
+		addWatch(directory);
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			if (entry.is_directory(error))
+				addWatch(entry.path());
+		}
+	};
+
+	watchTree(m_PathToWatch);
+
+	if (watches.empty())
+	{
+		close(fd);
+		return false;
+	}
+
+	alignas(inotify_event) std::array<char, 4096> buffer;
+
+	while (m_Running)
+	{
+		pollfd pollInfo = { fd, POLLIN, 0 };
+		constexpr int pollTimeoutMs = 50;
+
+		if (poll(&pollInfo, 1, pollTimeoutMs) > 0 && (pollInfo.revents & POLLIN))
+		{
+			ssize_t length;
+			while ((length = read(fd, buffer.data(), buffer.size())) > 0)
+			{
+				for (ssize_t offset = 0; offset < length;)
+				{
+					const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+					offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+					if (event->mask & IN_IGNORED)
+					{
+						watches.erase(event->wd);
+						continue;
+					}
+
+					// Events were dropped, the tree is compared with what is known instead
+					if (event->mask & IN_Q_OVERFLOW)
+					{
+						watchTree(m_PathToWatch);
+						QueueRescan(m_PathToWatch);
+						continue;
+					}
+
+					const auto watch = watches.find(event->wd);
+					if (watch == watches.end() || event->len == 0)
+						continue;
+
+					const std::filesystem::path path = watch->second / event->name;
+					const std::string pathString = path.string();
+
+					if (event->mask & IN_ISDIR)
+					{
+						// Files can be written into a new directory before its watch exists, a moved one arrives full
+						if (event->mask & (IN_CREATE | IN_MOVED_TO))
+						{
+							watchTree(path);
+							QueueRescan(path);
+						}
+
+						if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+						{
+							// A moved out directory keeps its watches, they would report paths that aren't in the tree anymore
+							for (auto it = watches.begin(); it != watches.end();)
+							{
+								if (it->second == path || IsInside(it->second.string(), pathString))
+								{
+									inotify_rm_watch(fd, it->first);
+									it = watches.erase(it);
+								}
+								else
+								{
+									++it;
+								}
+							}
+
+							QueueErasedDirectory(path);
+						}
+
+						continue;
+					}
+
+					std::error_code error;
+
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					{
+						// Editors that save by renaming a temp file over the original replace a known path
+						const bool known = m_Paths.contains(pathString);
+						m_Paths[pathString] = std::filesystem::last_write_time(path, error);
+						QueueEvent(pathString, known ? FileStatus::MODIFIED : FileStatus::CREATED);
+					}
+
+					if (event->mask & IN_CLOSE_WRITE)
+					{
+						m_Paths[pathString] = std::filesystem::last_write_time(path, error);
+						QueueEvent(pathString, FileStatus::MODIFIED);
+					}
+
+					if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+					{
+						m_Paths.erase(pathString);
+						QueueEvent(pathString, FileStatus::ERASED);
+					}
 				}
 			}
 		}
 
+		FlushPendingEvents();
+	}
+
+	close(fd);
+	return true;
+}
+#endif
+
+void FileWatcher::QueueEvent(const std::string& path, FileStatus status)
+{
+	const auto deadline = std::chrono::steady_clock::now() + s_DebounceWindow;
+	const auto [it, inserted] = m_PendingEvents.try_emplace(path, PendingEvent{ status, deadline });
+
+	if (inserted)
+		return;
+
+	PendingEvent& pending = it->second;
+	pending.Deadline = deadline;
+
+	switch (status)
+	{
+	case FileStatus::CREATED:
+		pending.Status = pending.Status == FileStatus::CREATED ? FileStatus::CREATED : FileStatus::MODIFIED;
+		break;
+	case FileStatus::MODIFIED:
+		if (pending.Status == FileStatus::ERASED)
+			pending.Status = FileStatus::MODIFIED;
+		break;
+	case FileStatus::ERASED:
+		if (pending.Status == FileStatus::CREATED)
+		{
+			m_PendingEvents.erase(it);
+			return;
+		}
+		pending.Status = FileStatus::ERASED;
+		break;
+	}
+}
+
+void FileWatcher::QueueRescan(const std::filesystem::path& directory)
+{
+	const std::string directoryString = directory.string();
+	std::error_code error;
+
+	for (auto it = m_Paths.begin(); it != m_Paths.end();)
+	{
+		if (IsInside(it->first, directoryString) && !std::filesystem::exists(it->first, error))
+		{
+			QueueEvent(it->first, FileStatus::ERASED);
+			it = m_Paths.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	m_Paths.try_emplace(directoryString, std::filesystem::last_write_time(directory, error));
+
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		const std::string pathString = entry.path().string();
+		const auto lastWriteTime = std::filesystem::last_write_time(entry, error);
+		const auto [it, inserted] = m_Paths.try_emplace(pathString, lastWriteTime);
+
+		// Directories are only tracked, like the events of inotify only files are reported
+		if (entry.is_directory(error))
+			continue;
+
+		if (inserted)
+		{
+			QueueEvent(pathString, FileStatus::CREATED);
+		}
+		else if (it->second != lastWriteTime)
+		{
+			it->second = lastWriteTime;
+			QueueEvent(pathString, FileStatus::MODIFIED);
+		}
+	}
+}
+
+void FileWatcher::QueueErasedDirectory(const std::filesystem::path& directory)
+{
+	const std::string directoryString = directory.string();
+	m_Paths.erase(directoryString);
+
+	for (auto it = m_Paths.begin(); it != m_Paths.end();)
+	{
+		if (IsInside(it->first, directoryString))
+		{
+			QueueEvent(it->first, FileStatus::ERASED);
+			it = m_Paths.erase(it);
+		}
+		else
+		{
+			++it;
+		}
 	}
 }
+
+void FileWatcher::FlushPendingEvents()
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	auto it = m_PendingEvents.begin();
+	while (it != m_PendingEvents.end())
+	{
+		if (it->second.Deadline <= now && m_Events.Push({ it->first, it->second.Status }))
+			it = m_PendingEvents.erase(it);
+		else
+			++it;
+	}
+}
+
+void FileWatcher::Publish(const std::string& path, FileStatus status)
+{
+	if (!m_Events.Push({ path, status }))
+		std::println("File event queue full, dropping event for {}", path);
+}
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
 #include <filesystem>
 #include <chrono>
 #include <unordered_map>
 #include <functional>
 #include <thread>
 
+#include "SpscQueue.h"
+
 enum class FileStatus : uint8_t
 {
 	CREATED = 0,
@@ -14,19 +17,54 @@ enum class FileStatus : uint8_t
 	ERASED
 };
 
+struct FileEvent
+{
+	std::string Path;
+	FileStatus Status = FileStatus::MODIFIED;
+};
+
 class FileWatcher
 {
 public:
 	FileWatcher() = default;
 	explicit FileWatcher(const std::filesystem::path& pathToWatch, std::chrono::duration<int, std::milli> delay);
-	void Start(const std::function<void(const std::string&, FileStatus)>& action);
+
+	// Blocks the calling thread until Stop() is called; events are delivered through PollEvents()
+	void Start();
 	void Stop() { m_Running = false; }
 
+	void PollEvents(const std::function<void(const std::string&, FileStatus)>& action);
+
 private:
+	void RunPolling();
+#ifdef __linux__
+	bool RunInotify();
+#endif
+
+	void QueueEvent(const std::string& path, FileStatus status);
+	// Compares everything below the directory with the known paths and queues the differences, for files inotify
+	// never reported: after a queue overflow or in a directory that appeared with files already in it
+	void QueueRescan(const std::filesystem::path& directory);
+	// Forgets every known path below a directory that was deleted or moved out of the tree
+	void QueueErasedDirectory(const std::filesystem::path& directory);
+	void FlushPendingEvents();
+	void Publish(const std::string& path, FileStatus status);
+
+private:
+	struct PendingEvent
+	{
+		FileStatus Status;
+		std::chrono::steady_clock::time_point Deadline;
+	};
+
+	static constexpr std::chrono::milliseconds s_DebounceWindow{ 100 };
+
 	std::filesystem::path m_PathToWatch;
 	std::chrono::duration<int, std::milli> m_Delay;
 
 	std::unordered_map<std::string, std::filesystem::file_time_type> m_Paths;
-	bool m_Running;
-};
+	std::unordered_map<std::string, PendingEvent> m_PendingEvents;
 
+	SpscQueue<FileEvent, 256> m_Events;
+	std::atomic<bool> m_Running = false;
+};
@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#include <print>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_Data = std::exchange(other.m_Data, nullptr);
+		m_Size = std::exchange(other.m_Size, 0);
+	}
+
+	return *this;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::println("Couldn't open file for mapping: {}", path.string());
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	GetFileSizeEx(file, &size);
+
+	const HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(file);
+
+	if (!mapping)
+	{
+		std::println("Couldn't map file: {}", path.string());
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if (!view)
+	{
+		std::println("Couldn't map file: {}", path.string());
+		return false;
+	}
+
+	m_Size = static_cast<size_t>(size.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+	{
+		std::println("Couldn't open file for mapping: {}", path.string());
+		return false;
+	}
+
+	struct stat fileInfo = {};
+	void* view = MAP_FAILED;
+
+	if (fstat(fd, &fileInfo) == 0 && fileInfo.st_size > 0)
+		view = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	close(fd);
+
+	if (view == MAP_FAILED)
+	{
+		std::println("Couldn't map file: {}", path.string());
+		return false;
+	}
+
+	m_Size = static_cast<size_t>(fileInfo.st_size);
+	madvise(view, m_Size, MADV_WILLNEED);
+#endif
+
+	m_Data = static_cast<const std::byte*>(view);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (!m_Data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+#else
+	munmap(const_cast<std::byte*>(m_Data), m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of a whole file. The mapping stays valid after the file is replaced by a rename.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	[[nodiscard]] bool Open(const std::filesystem::path& path);
+	void Close();
+
+	[[nodiscard]] bool IsOpen() const { return m_Data != nullptr; }
+	[[nodiscard]] std::span<const std::byte> GetData() const { return { m_Data, m_Size }; }
+
+private:
+	const std::byte* m_Data = nullptr;
+	size_t m_Size = 0;
+};
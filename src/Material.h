@@ -1,14 +1,21 @@
 #pragma once
 
+#include <type_traits>
+
 #include <vec3.hpp>
 
+// Laid out like the std430 Material struct in ray_tracing.comp, so material arrays are uploaded as they are
 struct Material
 {
-	glm::vec3 Color {1.f};
-	float Roughness;
+	alignas(16) glm::vec3 Color {1.f};
+	float Roughness = 0.f;
 	float Metallic = 0.f;
 	float Specular = 0.0f;
 	float EmissionPower = 0.f;
 
 	[[nodiscard]] bool IsEmissive() const { return EmissionPower > 0.0f; }
+
+	bool operator==(const Material&) const = default;
 };
+
+static_assert(sizeof(Material) == 32 && std::is_trivially_copyable_v<Material>);
@@ -0,0 +1,467 @@
+#include "RenderFarm.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <format>
+#include <future>
+#include <mutex>
+#include <print>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr std::array<char, 4> s_JobMagic = { 'R', 'T', 'J', 'B' };
+	constexpr std::array<char, 4> s_ResultMagic = { 'R', 'T', 'R', 'S' };
+	constexpr uint32_t s_ProtocolVersion = 1;
+
+	constexpr uint32_t s_JobsPerWorker = 4;
+	constexpr std::chrono::seconds s_WorkerTimeout{ 60 };
+	// A job is a few numbers and the scene name, a coordinator sending more is broken or hostile
+	constexpr uint32_t s_MaxSceneNameLength = 4096;
+
+	// Followed by the scene name
+	struct JobMessage
+	{
+		std::array<char, 4> Magic;
+		uint32_t Version;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t Samples;
+		uint32_t Seed;
+		uint32_t SceneNameLength;
+	};
+
+	// Followed by the serialized accumulation checkpoint
+	struct ResultMessage
+	{
+		std::array<char, 4> Magic;
+		uint32_t Version;
+		uint64_t Size;
+	};
+
+	static_assert(sizeof(JobMessage) == 28 && std::is_trivially_copyable_v<JobMessage>);
+	static_assert(sizeof(ResultMessage) == 16 && std::is_trivially_copyable_v<ResultMessage>);
+
+	template<typename T>
+	bool SendValue(const Socket& socket, const T& value)
+	{
+		return socket.Send(std::as_bytes(std::span(&value, 1)));
+	}
+
+	template<typename T>
+	bool ReceiveValue(const Socket& socket, T& value)
+	{
+		return socket.Receive(std::as_writable_bytes(std::span(&value, 1)));
+	}
+
+	template<typename T>
+	bool ParseNumber(std::string_view text, T& value)
+	{
+		return std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc();
+	}
+
+	// Jobs shared between the connection threads of the coordinator
+	class JobBoard
+	{
+	public:
+		explicit JobBoard(std::vector<RenderFarm::RenderJob> jobs)
+			: m_Pending(std::make_move_iterator(jobs.begin()), std::make_move_iterator(jobs.end())), m_Remaining(jobs.size())
+		{
+		}
+
+		// Blocks while every job is out but not all are done, a failed worker hands its job back
+		std::optional<RenderFarm::RenderJob> Take()
+		{
+			std::unique_lock lock(m_Mutex);
+			m_Changed.wait(lock, [this]() -> bool { return !m_Pending.empty() || m_Remaining == 0 || m_Failed; });
+
+			if (m_Pending.empty() || m_Failed)
+				return std::nullopt;
+
+			RenderFarm::RenderJob job = std::move(m_Pending.front());
+			m_Pending.pop_front();
+			return job;
+		}
+
+		void Return(RenderFarm::RenderJob job)
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Pending.push_front(std::move(job));
+			m_Changed.notify_all();
+		}
+
+		void Complete(AccumulationCheckpoint result)
+		{
+			std::lock_guard lock(m_Mutex);
+
+			if (!m_Merged)
+				m_Merged = std::move(result);
+			else if (!m_Merged->Merge(result))
+				m_Failed = true;
+
+			m_Remaining--;
+			m_Changed.notify_all();
+		}
+
+		void Fail()
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Failed = true;
+			m_Changed.notify_all();
+		}
+
+		void AddConnection() { std::lock_guard lock(m_Mutex); m_Connections++; }
+		void RemoveConnection() { std::lock_guard lock(m_Mutex); m_Connections--; }
+
+		[[nodiscard]] bool IsFinished() { std::lock_guard lock(m_Mutex); return m_Remaining == 0 || m_Failed; }
+		[[nodiscard]] bool HasFailed() { std::lock_guard lock(m_Mutex); return m_Failed; }
+		[[nodiscard]] uint32_t GetConnectionCount() { std::lock_guard lock(m_Mutex); return m_Connections; }
+		[[nodiscard]] std::optional<AccumulationCheckpoint> TakeResult() { std::lock_guard lock(m_Mutex); return std::move(m_Merged); }
+
+	private:
+		std::mutex m_Mutex;
+		std::condition_variable m_Changed;
+		std::deque<RenderFarm::RenderJob> m_Pending;
+		size_t m_Remaining;
+		uint32_t m_Connections = 0;
+		bool m_Failed = false;
+		std::optional<AccumulationCheckpoint> m_Merged;
+	};
+
+	bool SendJob(const Socket& socket, const RenderFarm::RenderJob& job)
+	{
+		JobMessage message = {};
+		message.Magic = s_JobMagic;
+		message.Version = s_ProtocolVersion;
+		message.Width = job.Extent.x;
+		message.Height = job.Extent.y;
+		message.Samples = job.Samples;
+		message.Seed = job.Seed;
+		message.SceneNameLength = static_cast<uint32_t>(job.SceneName.size());
+
+		return SendValue(socket, message) && socket.Send(std::as_bytes(std::span(job.SceneName)));
+	}
+
+	std::optional<AccumulationCheckpoint> ReceiveResult(const Socket& socket, const RenderFarm::RenderJob& job)
+	{
+		ResultMessage message;
+
+		if (!ReceiveValue(socket, message))
+			return std::nullopt;
+
+		if (message.Magic != s_ResultMagic || message.Version != s_ProtocolVersion)
+		{
+			std::println("Worker sent an unsupported result (version {})", message.Version);
+			return std::nullopt;
+		}
+
+		// Checked before allocating, a worker rendering at another extent couldn't be merged anyway
+		const uint64_t expectedSize = sizeof(AccumulationCheckpointHeader) + static_cast<uint64_t>(job.Extent.x) * job.Extent.y * sizeof(glm::vec4);
+
+		if (message.Size != expectedSize)
+		{
+			std::println("Worker sent {} bytes instead of an accumulation of {}x{}", message.Size, job.Extent.x, job.Extent.y);
+			return std::nullopt;
+		}
+
+		std::vector<std::byte> data(message.Size);
+
+		if (!socket.Receive(data))
+			return std::nullopt;
+
+		return AccumulationCheckpoint::Deserialize(data, "worker result");
+	}
+
+	// Hands out jobs until none are left, the worker exits once the connection closes
+	void ServeWorker(const Socket& socket, JobBoard& board)
+	{
+		while (std::optional<RenderFarm::RenderJob> job = board.Take())
+		{
+			std::optional<AccumulationCheckpoint> result;
+
+			if (SendJob(socket, *job))
+				result = ReceiveResult(socket, *job);
+
+			if (!result)
+			{
+				std::println("Lost a worker, its job of {} samples goes to another one", job->Samples);
+				board.Return(std::move(*job));
+				break;
+			}
+
+			board.Complete(std::move(*result));
+		}
+
+		board.RemoveConnection();
+	}
+
+#ifdef _WIN32
+	using WorkerProcess = HANDLE;
+
+	std::optional<WorkerProcess> LaunchWorker(const std::string& executable, const std::string& host, uint16_t port)
+	{
+		std::string commandLine = std::format("\"{}\" --worker {} {}", executable, host, port);
+
+		STARTUPINFOA startupInfo = { sizeof(startupInfo) };
+		PROCESS_INFORMATION processInfo = {};
+
+		if (!CreateProcessA(executable.c_str(), commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+			return std::nullopt;
+
+		CloseHandle(processInfo.hThread);
+		return processInfo.hProcess;
+	}
+
+	void WaitForWorker(WorkerProcess process)
+	{
+		WaitForSingleObject(process, INFINITE);
+		CloseHandle(process);
+	}
+#else
+	using WorkerProcess = pid_t;
+
+	std::optional<WorkerProcess> LaunchWorker(const std::string& executable, const std::string& host, uint16_t port)
+	{
+		std::string portArgument = std::to_string(port);
+		std::array<char*, 5> arguments = { const_cast<char*>(executable.c_str()), const_cast<char*>("--worker"),
+			const_cast<char*>(host.c_str()), portArgument.data(), nullptr };
+
+		pid_t process = 0;
+
+		if (posix_spawnp(&process, executable.c_str(), nullptr, nullptr, arguments.data(), environ) != 0)
+			return std::nullopt;
+
+		return process;
+	}
+
+	void WaitForWorker(WorkerProcess process)
+	{
+		int status = 0;
+		waitpid(process, &status, 0);
+	}
+#endif
+}
+
+std::optional<RenderFarm::RenderJob> RenderFarm::WorkerConnection::ReceiveJob() const
+{
+	JobMessage message;
+
+	// The coordinator closes the connection once it has no job left
+	if (!ReceiveValue(m_Socket, message))
+		return std::nullopt;
+
+	if (message.Magic != s_JobMagic || message.Version != s_ProtocolVersion)
+	{
+		std::println("Coordinator sent an unsupported job (version {})", message.Version);
+		return std::nullopt;
+	}
+
+	if (message.SceneNameLength > s_MaxSceneNameLength)
+	{
+		std::println("Coordinator sent a scene name of {} bytes", message.SceneNameLength);
+		return std::nullopt;
+	}
+
+	RenderJob job;
+	job.Extent = { message.Width, message.Height };
+	job.Samples = message.Samples;
+	job.Seed = message.Seed;
+	job.SceneName.resize(message.SceneNameLength);
+
+	if (!m_Socket.Receive(std::as_writable_bytes(std::span(job.SceneName))))
+		return std::nullopt;
+
+	return job;
+}
+
+bool RenderFarm::WorkerConnection::SendResult(const AccumulationCheckpoint& checkpoint) const
+{
+	const std::vector<std::byte> data = checkpoint.Serialize();
+
+	ResultMessage message = {};
+	message.Magic = s_ResultMagic;
+	message.Version = s_ProtocolVersion;
+	message.Size = data.size();
+
+	return SendValue(m_Socket, message) && m_Socket.Send(data);
+}
+
+int RenderFarm::Coordinate(const CoordinatorSettings& settings)
+{
+	Socket listener;
+
+	if (!listener.Listen(settings.BindAddress, settings.Port))
+		return 1;
+
+	const uint16_t port = listener.GetLocalPort();
+
+	// Small jobs balance uneven workers, each one restarts the accumulation and ramps its sample budget up again
+	const uint32_t jobSamples = settings.SamplesPerJob > 0 ? settings.SamplesPerJob :
+		std::max(1u, settings.Samples / (std::max(settings.LocalWorkers, 1u) * s_JobsPerWorker));
+
+	// An odd step keeps the seeds of up to 2^32 jobs apart, merging needs them distinct
+	const uint32_t baseSeed = std::random_device{}();
+	std::vector<RenderJob> jobs;
+
+	for (uint32_t samples = 0; samples < settings.Samples; samples += jobSamples)
+	{
+		const auto index = static_cast<uint32_t>(jobs.size());
+		jobs.push_back({ settings.SceneName, settings.Extent, std::min(jobSamples, settings.Samples - samples), baseSeed + index * 0x9E3779B9u });
+	}
+
+	std::println("Rendering {} samples of {} at {}x{} in {} jobs, workers connect to port {}", settings.Samples, settings.SceneName,
+		settings.Extent.x, settings.Extent.y, jobs.size(), port);
+
+	std::vector<WorkerProcess> processes;
+	// Local workers reach a coordinator listening on every interface through loopback
+	const std::string localHost = settings.BindAddress == "0.0.0.0" ? "127.0.0.1" : settings.BindAddress;
+
+	for (uint32_t i = 0; i < settings.LocalWorkers; i++)
+	{
+		if (const std::optional<WorkerProcess> process = LaunchWorker(settings.Executable, localHost, port))
+			processes.push_back(*process);
+		else
+			std::println("Couldn't launch a local worker from {}", settings.Executable);
+	}
+
+	JobBoard board(std::move(jobs));
+	// Owned here rather than by the connection threads, so they can be shut down before joining. A deque keeps them in place.
+	std::deque<Socket> sockets;
+	std::vector<std::future<void>> connections;
+
+	const auto start = std::chrono::steady_clock::now();
+	auto lastConnected = start;
+
+	while (!board.IsFinished())
+	{
+		if (Socket connection = listener.Accept(std::chrono::milliseconds(200)); connection.IsOpen())
+		{
+			// Jobs are small, only a worker that stopped reading keeps one from going out
+			connection.SetSendTimeout(s_WorkerTimeout);
+
+			board.AddConnection();
+			const Socket& socket = sockets.emplace_back(std::move(connection));
+			connections.push_back(std::async(std::launch::async, ServeWorker, std::cref(socket), std::ref(board)));
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+
+		if (board.GetConnectionCount() > 0)
+		{
+			lastConnected = now;
+		}
+		else if (now - lastConnected > s_WorkerTimeout)
+		{
+			std::println("No worker was connected for {}s", s_WorkerTimeout.count());
+			board.Fail();
+		}
+	}
+
+	// Workers waiting for a job are released by the end of their connection, threads blocked on a stalled worker
+	// return once its socket is shut down
+	listener.Close();
+
+	for (const Socket& socket : sockets)
+		socket.Shutdown();
+
+	connections.clear();
+	sockets.clear();
+
+	for (const WorkerProcess process : processes)
+		WaitForWorker(process);
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::optional<AccumulationCheckpoint> result = board.TakeResult();
+
+	if (board.HasFailed() || !result)
+		return 1;
+
+	if (!result->Write(settings.Output))
+		return 1;
+
+	std::println("Rendered {} samples in {:.2f}s: {:.1f} samples/s -> {}", result->SampleCount, elapsed.count(),
+		static_cast<double>(result->SampleCount) / elapsed.count(), settings.Output.string());
+	return 0;
+}
+
+bool RenderFarm::Run(int argc, char** argv, int& outExitCode)
+{
+	if (argc < 2 || std::string_view(argv[1]) != "--coordinate")
+		return false;
+
+	outExitCode = 1;
+
+	CoordinatorSettings settings;
+	settings.Executable = argv[0];
+
+	if (argc < 5 || !ParseNumber(std::string_view(argv[3]), settings.Samples) || settings.Samples == 0)
+	{
+		std::println("Usage: {} --coordinate <scene> <samples> <output> [--workers N] [--port P] [--bind ADDRESS] [--job-samples S] [--size WxH]", argv[0]);
+		return true;
+	}
+
+	settings.SceneName = argv[2];
+	settings.Output = argv[4];
+
+	for (int i = 5; i + 1 < argc; i += 2)
+	{
+		const std::string_view option = argv[i];
+		const std::string_view value = argv[i + 1];
+		bool valid = false;
+
+		if (option == "--workers")
+		{
+			valid = ParseNumber(value, settings.LocalWorkers);
+		}
+		else if (option == "--port")
+		{
+			valid = ParseNumber(value, settings.Port);
+		}
+		else if (option == "--bind")
+		{
+			settings.BindAddress = value;
+			valid = !value.empty();
+		}
+		else if (option == "--job-samples")
+		{
+			valid = ParseNumber(value, settings.SamplesPerJob);
+		}
+		else if (option == "--size")
+		{
+			const size_t separator = value.find('x');
+			valid = separator != std::string_view::npos && ParseNumber(value.substr(0, separator), settings.Extent.x) &&
+				ParseNumber(value.substr(separator + 1), settings.Extent.y) && settings.Extent.x > 0 && settings.Extent.y > 0;
+		}
+
+		if (!valid)
+		{
+			std::println("Invalid option: {} {}", option, value);
+			return true;
+		}
+	}
+
+	if ((argc - 5) % 2 != 0)
+	{
+		std::println("Missing value for {}", argv[argc - 1]);
+		return true;
+	}
+
+	outExitCode = Coordinate(settings);
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <glm.hpp>
+
+#include "AccumulationCheckpoint.h"
+#include "Socket.h"
+
+// Spreads one accumulation over worker processes. The coordinator splits the samples into jobs that workers trace with
+// their own seeds, every result is an accumulation checkpoint of the whole image and they add up to the full render.
+// Workers connect over TCP, local ones are launched by the coordinator and others can join from any machine with the same scenes.
+namespace RenderFarm
+{
+	struct RenderJob
+	{
+		std::string SceneName;
+		glm::uvec2 Extent;
+		uint32_t Samples;
+		uint32_t Seed;
+	};
+
+	// Worker side of the connection to a coordinator
+	class WorkerConnection
+	{
+	public:
+		[[nodiscard]] bool Connect(const std::string& host, uint16_t port) { return m_Socket.Connect(host, port); }
+		// Blocks until the next job arrives, empty once the coordinator has none left for this worker
+		[[nodiscard]] std::optional<RenderJob> ReceiveJob() const;
+		[[nodiscard]] bool SendResult(const AccumulationCheckpoint& checkpoint) const;
+
+	private:
+		Socket m_Socket;
+	};
+
+	struct CoordinatorSettings
+	{
+		std::string Executable;
+		std::string SceneName;
+		std::filesystem::path Output;
+		glm::uvec2 Extent = { 1920, 1080 };
+		uint32_t Samples = 1000;
+		// 0 gives every local worker a few jobs, so faster ones take over the work of slower ones
+		uint32_t SamplesPerJob = 0;
+		uint32_t LocalWorkers = 1;
+		// 0 picks a free port, remote workers need a fixed one
+		uint16_t Port = 0;
+		// IPv4 address of the interface workers connect to, 127.0.0.1 keeps the coordinator to local workers
+		std::string BindAddress = "0.0.0.0";
+	};
+
+	// Returns the exit code, the merged render is written to the output as an accumulation checkpoint
+	int Coordinate(const CoordinatorSettings& settings);
+
+	// Handles "--coordinate <scene> <samples> <output> [--workers N] [--port P] [--bind ADDRESS] [--job-samples S] [--size WxH]",
+	// returns false if it wasn't given. Workers are started with "--worker <host> <port>".
+	bool Run(int argc, char** argv, int& outExitCode);
+}
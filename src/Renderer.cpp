@@ -1,5 +1,8 @@
 #include "Renderer.h"
 
+#include <algorithm>
+#include <numeric>
+
 
 Renderer::Renderer(const std::shared_ptr<GLFWwindow>& window, uint32_t width, uint32_t height) :
 	m_Width(width), m_Height(height), m_AspectRatio((float)m_Width / m_Height),
@@ -14,6 +17,12 @@ Renderer::~Renderer()
 {
 	if (m_Engine)
 	{
+		SaveFinalCheckpoint();
+
+		// They share the engine's instance
+		for (SecondaryDevice& secondary : m_TraceDevices)
+			secondary.Device->Cleanup();
+
 		m_Engine->Cleanup();
 	}
 }
@@ -33,31 +42,569 @@ void Renderer::ResizeViewport(uint32_t width, uint32_t height)
 
 	m_AspectRatio = static_cast<float>(m_Width) / m_Height;
 	m_SampleCount = 1;
+	m_NextTile = 0;
+	m_AccumulationStarted = false;
+	DropTraceJobs();
 
 	m_Engine->SetViewportSize(width, height);
 }
 
 void Renderer::Render()
 {
-	if(const auto& scene = m_CurrentScene.lock(); m_DispatchCompute = scene && !IsComplete())
+	// Viewport changes that had to wait for larger targets land inside DrawFrame
+	const bool shadersReloaded = m_Engine->ConsumeShadersReloaded();
+	const bool viewportResized = m_Engine->ConsumeViewportResized();
+
+	// The trace devices load the SPIR-V the engine just compiled
+	if (shadersReloaded)
+	{
+		for (SecondaryDevice& secondary : m_TraceDevices)
+			secondary.Device->ReloadShader();
+	}
+
+	if (shadersReloaded || viewportResized)
+		ResetAccumulation();
+
+	m_FrameTiles.clear();
+
+	if (m_AccumulationEnabled)
+		CollectTraceResults();
+
+	// Samples merged last keep the frame going past completion, they still have to be added and resolved
+	if(const auto& scene = m_CurrentScene.lock(); m_DispatchCompute = scene && (!IsComplete() || m_Engine->HasPendingMerges()))
 	{
+		UpdateRenderScale();
 		UpdateUniformBuffer(scene);
-		UpdateSphereBuffer(scene);
-		UpdateMaterialBuffer(scene);
 
+		if (scene->GetRevision() != m_UploadedSceneRevision)
+		{
+			m_Engine->ResizeSceneBuffers(scene->GetSphereCount(), scene->GetMaterialCount());
+			UpdateSphereBuffer(scene);
+			UpdateMaterialBuffer(scene);
+			m_UploadedSceneRevision = scene->GetRevision();
+		}
+
+		// Real-time frames trace every pixel, only accumulation can spread a sample over several frames
 		if (m_AccumulationEnabled)
-			++m_SampleCount;
+		{
+			// Not keyed to the sample count, that stays at one while the trace devices hold every remaining sample
+			if (!m_AccumulationStarted)
+				StartAccumulation(*scene);
+
+			SubmitTraceJobs(*scene);
+
+			const PassTimings& timings = m_Engine->GetPassTimings();
+			ScheduleTiles(m_SampleScheduler.Update(timings.RayTracing, timings.TracedPixels));
+
+			// Measured by wall clock like the trace devices, this GPU only traces within the budget of every frame
+			const auto now = std::chrono::steady_clock::now();
+
+			if (m_LastFrame != std::chrono::steady_clock::time_point{})
+				m_DeviceBalancer.AddMeasurement(0, timings.TracedPixels, std::chrono::duration<double>(now - m_LastFrame).count());
+
+			m_LastFrame = now;
+
+			// Periodically and once complete, the copy is taken right after this frame's tiles
+			const bool checkpointDue = std::chrono::steady_clock::now() - m_LastCheckpoint >= s_CheckpointInterval ||
+				(IsComplete() && m_CheckpointedSamples != m_SampleCount - 1);
+
+			if (!m_CheckpointPath.empty() && !m_RequestedCheckpoint && checkpointDue)
+				RequestCheckpoint();
+		}
+		else
+		{
+			m_FrameTiles.push_back({ glm::uvec2(0), m_Engine->GetRenderExtent() });
+		}
 	}
 
-	m_Engine->DrawFrame(m_DispatchCompute);
+	const bool present = !(m_MaxThroughput && m_AccumulationEnabled && m_DispatchCompute);
+	m_Engine->DrawFrame(m_DispatchCompute, m_FrameTiles, present);
+
+	if (std::optional<AccumulationData> data = m_Engine->ConsumeAccumulationReadback())
+		WriteCheckpoint(std::move(*data));
 }
 
-void Renderer::UpdateUniformBuffer(const std::shared_ptr<Scene>& scene) const
+void Renderer::ScheduleTiles(uint64_t pixelBudget)
 {
-	if (!scene) 
+	uint64_t pixels = 0;
+
+	while (!IsComplete() && !(m_BandRound && m_BandRound->PrimarySamplesLeft == 0))
+	{
+		// Samples the trace devices are still tracing count as well, a new one would overshoot the target once they merge
+		if (m_NextTile == 0 && !m_BandRound && GetRemainingSamples() == 0)
+			return;
+
+		if (m_NextTile == 0)
+		{
+			// Without a round of bands this GPU traces the whole image
+			const std::vector<TraceTile> regions = m_BandRound ? m_BandRound->PrimaryBands :
+				std::vector<TraceTile>{ { glm::uvec2(0), m_Engine->GetRenderExtent() } };
+
+			m_Tiles.clear();
+
+			for (const TraceTile& region : regions)
+			{
+				for (TraceTile tile : TileOrder::BuildSpiral(region.Extent, m_TileSize, m_TileOrigin))
+				{
+					tile.Offset += region.Offset;
+					m_Tiles.push_back(tile);
+				}
+			}
+		}
+
+		if (m_Tiles.empty())
+			return;
+
+		const TraceTile& tile = m_Tiles[m_NextTile];
+		const uint64_t tilePixels = static_cast<uint64_t>(tile.Extent.x) * tile.Extent.y;
+
+		// At least one tile per frame, even if it alone is over budget
+		if (!m_FrameTiles.empty() && pixels + tilePixels > pixelBudget)
+			return;
+
+		m_FrameTiles.push_back(tile);
+		pixels += tilePixels;
+
+		if (++m_NextTile == m_Tiles.size())
+		{
+			m_NextTile = 0;
+			CompletePrimarySample();
+		}
+	}
+}
+
+void Renderer::CompletePrimarySample()
+{
+	if (!m_BandRound)
+	{
+		m_SampleCount++;
+		return;
+	}
+
+	m_BandRound->PrimarySamplesLeft--;
+	CompleteBandRound();
+}
+
+void Renderer::CompleteBandRound()
+{
+	if (!m_BandRound || m_BandRound->PrimarySamplesLeft > 0 || m_BandRound->PendingBands > 0)
+		return;
+
+	m_SampleCount += m_BandRound->Samples;
+	m_BandRound.reset();
+}
+
+void Renderer::SetMultiDevice(bool enabled, MultiDeviceSplit split, bool includeSoftware)
+{
+	// Work handed to the old devices will never arrive, what is merged already stays
+	DropTraceJobs();
+
+	for (SecondaryDevice& secondary : m_TraceDevices)
+		secondary.Device->Cleanup();
+
+	m_TraceDevices.clear();
+	m_MultiDeviceSplit = split;
+
+	if (enabled)
+	{
+		for (std::unique_ptr<TraceDevice>& device : m_Engine->CreateTraceDevices(includeSoftware))
+			m_TraceDevices.push_back({ std::move(device) });
+
+		if (m_TraceDevices.empty())
+			std::println("No other GPU to trace on");
+	}
+
+	m_DeviceBalancer.Reset(m_TraceDevices.size() + 1);
+}
+
+void Renderer::CollectTraceResults()
+{
+	for (size_t i = 0; i < m_TraceDevices.size();)
+	{
+		SecondaryDevice& secondary = m_TraceDevices[i];
+		std::optional<AccumulationData> result = secondary.Device->ConsumeResult();
+		const bool current = secondary.JobGeneration == m_AccumulationGeneration;
+
+		if (secondary.Device->IsLost())
+		{
+			const bool jobLost = secondary.JobInFlight && current;
+			const uint32_t lostSamples = secondary.Job.Samples;
+
+			std::println("Stopped tracing on {}", secondary.Device->GetName());
+			secondary.Device->Cleanup();
+			m_TraceDevices.erase(m_TraceDevices.begin() + static_cast<std::ptrdiff_t>(i));
+			m_DeviceBalancer.RemoveDevice(i + 1);
+
+			// A missing band leaves the round incomplete, the other bands of it are dropped as well
+			if (jobLost && m_BandRound)
+				DropTraceJobs();
+			else if (jobLost)
+				m_SamplesInFlight -= lostSamples;
+
+			continue;
+		}
+
+		if (result)
+		{
+			const TraceJob& job = secondary.Job;
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - secondary.JobStart;
+			const uint64_t pixelSamples = static_cast<uint64_t>(job.Region.Extent.x) * job.Region.Extent.y * job.Samples;
+
+			secondary.JobInFlight = false;
+			m_DeviceBalancer.AddMeasurement(i + 1, pixelSamples, elapsed.count());
+
+			if (current)
+			{
+				m_Engine->MergeAccumulation(std::move(*result), job.Region.Offset);
+
+				if (m_BandRound)
+				{
+					m_BandRound->PendingBands--;
+					CompleteBandRound();
+				}
+				else
+				{
+					m_SamplesInFlight -= job.Samples;
+					m_SampleCount += job.Samples;
+				}
+			}
+		}
+
+		i++;
+	}
+}
+
+void Renderer::SubmitTraceJobs(const Scene& scene)
+{
+	const glm::uvec2 extent = m_Engine->GetRenderExtent();
+	const uint64_t pixels = static_cast<uint64_t>(extent.x) * extent.y;
+
+	if (m_TraceDevices.empty() || IsComplete() || pixels == 0)
+		return;
+
+	if (m_MultiDeviceSplit == MultiDeviceSplit::BANDS)
+	{
+		// Rounds start between samples of this GPU, its previous tiles covered the whole image or the band of a round
+		if (!m_BandRound && m_NextTile == 0)
+			StartBandRound(scene);
+
+		return;
+	}
+
+	std::vector<size_t> devices(m_TraceDevices.size() + 1);
+	std::iota(devices.begin(), devices.end(), size_t{ 0 });
+
+	for (size_t i = 0; i < m_TraceDevices.size(); i++)
+	{
+		if (m_TraceDevices[i].JobInFlight)
+			continue;
+
+		const uint32_t remaining = GetRemainingSamples();
+
+		if (remaining == 0)
+			return;
+
+		// About a job's time worth of samples, but no more than the device's share of what is left
+		const double fitting = std::floor(m_DeviceBalancer.GetThroughput(i + 1) * s_TraceJobSeconds / static_cast<double>(pixels));
+		const double share = std::floor(m_DeviceBalancer.GetShare(i + 1, devices) * remaining);
+		const uint32_t samples = static_cast<uint32_t>(std::clamp(std::min(fitting, share), 1.0, static_cast<double>(remaining)));
+
+		if (SubmitTraceJob(i, scene, { { glm::uvec2(0), extent }, samples, 0 }))
+			m_SamplesInFlight += samples;
+	}
+}
+
+uint32_t Renderer::GetRemainingSamples() const
+{
+	// The sample this GPU is in the middle of is as good as traced
+	const uint32_t promised = m_SampleCount + m_SamplesInFlight + (m_NextTile > 0 ? 1 : 0);
+
+	return m_MaxSamples > promised ? m_MaxSamples - promised : 0;
+}
+
+void Renderer::StartBandRound(const Scene& scene)
+{
+	const glm::uvec2 extent = m_Engine->GetRenderExtent();
+	std::vector<size_t> devices = { 0 };
+
+	// Devices still finishing a job of a reset accumulation sit this round out
+	for (size_t i = 0; i < m_TraceDevices.size(); i++)
+	{
+		if (!m_TraceDevices[i].JobInFlight)
+			devices.push_back(i + 1);
+	}
+
+	if (devices.size() == 1)
 		return;
 
-	const Camera& camera = scene->GetActiveCamera();
+	double throughput = 0.0;
+	for (const size_t device : devices)
+		throughput += m_DeviceBalancer.GetThroughput(device);
+
+	// The round takes about a job's time on every device once the bands match their throughput
+	const uint64_t pixels = static_cast<uint64_t>(extent.x) * extent.y;
+	const double fitting = std::floor(throughput * s_TraceJobSeconds / static_cast<double>(pixels));
+	const uint32_t samples = static_cast<uint32_t>(std::clamp(fitting, 1.0, static_cast<double>(GetRemainingSamples())));
+
+	// This GPU takes the first band, it always gets at least one row
+	const std::vector<uint32_t> rows = m_DeviceBalancer.SplitRows(extent.y, devices);
+	BandRound round = { {}, samples, samples, 0 };
+	round.PrimaryBands.push_back({ glm::uvec2(0), glm::uvec2(extent.x, rows[0]) });
+	uint32_t offset = rows[0];
+
+	for (size_t i = 1; i < devices.size(); i++)
+	{
+		if (rows[i] == 0)
+			continue;
+
+		const TraceTile band = { glm::uvec2(0, offset), glm::uvec2(extent.x, rows[i]) };
+		offset += rows[i];
+
+		if (SubmitTraceJob(devices[i] - 1, scene, { band, samples, 0 }))
+			round.PendingBands++;
+		else
+			round.PrimaryBands.push_back(band);
+	}
+
+	m_BandRound = std::move(round);
+}
+
+bool Renderer::SubmitTraceJob(size_t index, const Scene& scene, const TraceJob& job)
+{
+	SecondaryDevice& secondary = m_TraceDevices[index];
+
+	if (secondary.UploadedSceneRevision != scene.GetRevision())
+	{
+		secondary.Device->UploadScene(scene.GetSpherePositions(), scene.GetSphereRadii(), scene.GetSphereMaterialIndices(), scene.GetMaterials());
+		secondary.UploadedSceneRevision = scene.GetRevision();
+	}
+
+	secondary.Device->UploadUniforms(BuildUniforms(scene));
+
+	// Unique within the accumulation and after resuming it, the sample count of a resumed one is past every merged job
+	const std::array<uint32_t, 3> seedInput = { m_Checkpoint.Seed, m_SampleCount, m_TraceJobCount++ };
+	TraceJob seededJob = job;
+	seededJob.Seed = static_cast<uint32_t>(AccumulationCheckpoint::Hash(std::as_bytes(std::span(seedInput))));
+
+	if (!secondary.Device->Submit(seededJob, m_Engine->GetRenderExtent()))
+		return false;
+
+	secondary.Job = seededJob;
+	secondary.JobGeneration = m_AccumulationGeneration;
+	secondary.JobInFlight = true;
+	secondary.JobStart = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+void Renderer::DropTraceJobs()
+{
+	// Jobs in flight finish on their own and their results are dropped. Samples merged already stay, every pixel is
+	// averaged over its own count.
+	m_AccumulationGeneration++;
+	m_SamplesInFlight = 0;
+
+	// The tiles of this GPU's band don't add up to a sample of the image
+	if (m_BandRound)
+	{
+		m_BandRound.reset();
+		m_NextTile = 0;
+	}
+}
+
+void Renderer::SetCheckpointPath(const std::filesystem::path& path)
+{
+	if (path == m_CheckpointPath)
+		return;
+
+	m_CheckpointPath = path;
+	m_ResumeCandidate.reset();
+
+	// Read once here, camera moves start new accumulations every frame and each one looks for a match
+	std::error_code error;
+	if (!path.empty() && std::filesystem::exists(path, error))
+		m_ResumeCandidate = AccumulationCheckpoint::Read(path);
+}
+
+void Renderer::StartAccumulation(const Scene& scene)
+{
+	m_Checkpoint.SceneHash = HashScene(scene);
+	m_Checkpoint.CameraHash = HashCamera(scene.GetActiveCamera());
+	m_Checkpoint.Accumulation.Extent = m_Engine->GetRenderExtent();
+	m_CheckpointedSamples = 0;
+	m_AccumulationStart = m_LastCheckpoint = std::chrono::steady_clock::now();
+	m_AccumulationStarted = true;
+
+	const bool resume = m_ResumeCandidate && m_ResumeCandidate->SceneHash == m_Checkpoint.SceneHash &&
+		m_ResumeCandidate->CameraHash == m_Checkpoint.CameraHash && m_ResumeCandidate->Accumulation.Extent == m_Checkpoint.Accumulation.Extent;
+
+	if (resume)
+	{
+		// Continuing with the saved seed, every pixel picks up its random sequence at its own sample count
+		m_Checkpoint.Seed = m_ResumeCandidate->Seed;
+		m_SampleCount = m_ResumeCandidate->SampleCount + 1;
+		m_CheckpointedSamples = m_ResumeCandidate->SampleCount;
+		m_Engine->RestoreAccumulation(std::move(m_ResumeCandidate->Accumulation));
+		m_ResumeCandidate.reset();
+
+		std::println("Resumed {} samples from {}", m_CheckpointedSamples, m_CheckpointPath.string());
+	}
+	else
+	{
+		m_Checkpoint.Seed = m_FixedSeed ? *m_FixedSeed : std::random_device{}();
+	}
+
+	m_Engine->SetAccumulationSeed(m_Checkpoint.Seed);
+}
+
+std::optional<AccumulationCheckpoint> Renderer::ReadCheckpoint()
+{
+	std::optional<AccumulationData> data = m_Engine->ReadAccumulation();
+
+	if (!data)
+		return std::nullopt;
+
+	AccumulationCheckpoint checkpoint = m_Checkpoint;
+	checkpoint.SampleCount = m_SampleCount - 1;
+	checkpoint.Accumulation = std::move(*data);
+
+	return checkpoint;
+}
+
+void Renderer::RequestCheckpoint()
+{
+	m_RequestedCheckpoint = m_Checkpoint;
+	m_RequestedCheckpoint->SampleCount = m_SampleCount - 1;
+	m_RequestedCheckpointPath = m_CheckpointPath;
+
+	m_CheckpointedSamples = m_SampleCount - 1;
+	m_LastCheckpoint = std::chrono::steady_clock::now();
+	m_Engine->RequestAccumulationReadback();
+}
+
+void Renderer::WriteCheckpoint(AccumulationData data)
+{
+	if (!m_RequestedCheckpoint)
+		return;
+
+	AccumulationCheckpoint checkpoint = std::move(*m_RequestedCheckpoint);
+	m_RequestedCheckpoint.reset();
+
+	// Render targets recreated between the request and the copy hold an image of another size
+	if (data.Extent != checkpoint.Accumulation.Extent)
+		return;
+
+	checkpoint.Accumulation = std::move(data);
+
+	if (m_RequestedCheckpointPath == m_CheckpointPath)
+		m_ResumeCandidate.reset();
+
+	// One write at a time, they are far apart and a newer one must not be overtaken by an older one
+	if (m_PendingCheckpointWrite.valid())
+		m_PendingCheckpointWrite.wait();
+
+	m_PendingCheckpointWrite = std::async(std::launch::async, [checkpoint = std::move(checkpoint), path = m_RequestedCheckpointPath]() -> bool
+		{
+			std::error_code error;
+			std::filesystem::create_directories(path.parent_path(), error);
+
+			return checkpoint.Write(path);
+		});
+}
+
+bool Renderer::IsCheckpointWorthSaving() const
+{
+	// Only accumulation advances the counters, they still hold its progress right after it was switched off
+	const bool hasNewSamples = m_SampleCount - 1 > m_CheckpointedSamples || m_NextTile > 0;
+
+	return !m_CheckpointPath.empty() && hasNewSamples &&
+		std::chrono::steady_clock::now() - m_AccumulationStart >= s_MinCheckpointAge;
+}
+
+void Renderer::SaveFinalCheckpoint()
+{
+	// A readback requested by the last reset is still worth writing
+	m_Engine->WaitForFrames();
+
+	if (std::optional<AccumulationData> data = m_Engine->ConsumeAccumulationReadback())
+		WriteCheckpoint(std::move(*data));
+
+	if (!m_RequestedCheckpoint && IsCheckpointWorthSaving())
+		RequestCheckpoint();
+
+	// Also covers a reset without a traced frame since, its sums aren't cleared yet
+	if (m_RequestedCheckpoint)
+	{
+		if (std::optional<AccumulationData> data = m_Engine->ReadAccumulation())
+			WriteCheckpoint(std::move(*data));
+	}
+
+	if (m_PendingCheckpointWrite.valid())
+		m_PendingCheckpointWrite.wait();
+}
+
+uint64_t Renderer::HashScene(const Scene& scene)
+{
+	if (scene.GetRevision() != m_HashedSceneRevision)
+	{
+		uint64_t hash = AccumulationCheckpoint::Hash(std::as_bytes(scene.GetSpherePositions()));
+		hash = AccumulationCheckpoint::Hash(std::as_bytes(scene.GetSphereRadii()), hash);
+		hash = AccumulationCheckpoint::Hash(std::as_bytes(scene.GetSphereMaterialIndices()), hash);
+
+		// Field by field, the tail padding of Material is never initialized
+		for (const Material& material : scene.GetMaterials())
+		{
+			const std::array<float, 7> fields = { material.Color.r, material.Color.g, material.Color.b, material.Roughness,
+				material.Metallic, material.Specular, material.EmissionPower };
+			hash = AccumulationCheckpoint::Hash(std::as_bytes(std::span(fields)), hash);
+		}
+
+		m_SceneGeometryHash = hash;
+		m_HashedSceneRevision = scene.GetRevision();
+	}
+
+	// Settings of the renderer change the image as much as the scene itself
+	const uint64_t hash = AccumulationCheckpoint::Hash(std::as_bytes(std::span(&m_BackgroundColor, 1)), m_SceneGeometryHash);
+	return AccumulationCheckpoint::Hash(std::as_bytes(std::span(&m_MaxRayBounces, 1)), hash);
+}
+
+uint64_t Renderer::HashCamera(const Camera& camera) const
+{
+	const std::array<glm::vec3, 3> frame = { camera.GetPosition(), camera.GetDirection(), camera.GetUp() };
+	const std::array<float, 2> projection = { camera.GetFieldOfView(), m_AspectRatio };
+	const glm::uvec2 extent = m_Engine->GetRenderExtent();
+
+	uint64_t hash = AccumulationCheckpoint::Hash(std::as_bytes(std::span(frame)));
+	hash = AccumulationCheckpoint::Hash(std::as_bytes(std::span(projection)), hash);
+	return AccumulationCheckpoint::Hash(std::as_bytes(std::span(&extent, 1)), hash);
+}
+
+void Renderer::SetDynamicResolution(bool enabled)
+{
+	m_DynamicResolutionEnabled = enabled;
+	m_DynamicResolution.Reset(m_Engine->GetRenderScale());
+}
+
+void Renderer::UpdateRenderScale()
+{
+	// Every scale change throws away the accumulated samples, so the controller only drives real-time mode
+	float scale = m_RenderScale;
+
+	if (m_DynamicResolutionEnabled && !m_AccumulationEnabled)
+		scale = m_DynamicResolution.Update(m_Engine->GetRenderTime());
+
+	if (scale == m_Engine->GetRenderScale())
+		return;
+
+	m_Engine->SetRenderScale(scale);
+
+	if (m_AccumulationEnabled)
+		ResetAccumulation();
+}
+
+UniformBufferData Renderer::BuildUniforms(const Scene& scene) const
+{
+	const Camera& camera = scene.GetActiveCamera();
 	UniformBufferData ubo = {};
 
 	ubo.CameraPosition = camera.GetPosition();
@@ -69,38 +616,32 @@ void Renderer::UpdateUniformBuffer(const std::shared_ptr<Scene>& scene) const
 	ubo.SampleCount = m_SampleCount;
 	ubo.MaxBounces = m_MaxRayBounces;
 	ubo.BackgroundColor = m_BackgroundColor;
-	ubo.Width = m_Width;
-	ubo.Height = m_Height;
+	const glm::uvec2 renderExtent = m_Engine->GetRenderExtent();
+	ubo.Width = renderExtent.x;
+	ubo.Height = renderExtent.y;
 	ubo.AccumulationEnabled = m_AccumulationEnabled;
+	ubo.SphereCount = scene.GetSphereCount();
 
-	void* data;
-	vmaMapMemory(m_Engine->GetAllocator(), m_Engine->UniformBuffer.Allocation, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vmaUnmapMemory(m_Engine->GetAllocator(), m_Engine->UniformBuffer.Allocation);
+	return ubo;
 }
 
-void Renderer::UpdateSphereBuffer(const std::shared_ptr<Scene>& scene) const
+void Renderer::UpdateUniformBuffer(const std::shared_ptr<Scene>& scene) const
 {
 	if (!scene) 
 		return;
 
-	const auto& spheres = scene->GetSpheres();
-	std::vector<SphereBufferData> gpuSpheres;
-	gpuSpheres.reserve(spheres.size());
+	const UniformBufferData ubo = BuildUniforms(*scene);
+	m_Engine->StageBufferWrite(m_Engine->UniformBuffer, std::as_bytes(std::span(&ubo, 1)));
+}
 
-	for (const auto& sphere : spheres) 
-	{
-		SphereBufferData sd = {};
-		sd.Position = sphere.GetPosition();
-		sd.Radius = sphere.GetRadius();
-		sd.MaterialIndex = sphere.GetMaterialIndex();
-		gpuSpheres.push_back(sd);
-	}
+void Renderer::UpdateSphereBuffer(const std::shared_ptr<Scene>& scene) const
+{
+	if (!scene) 
+		return;
 
-	void* data;
-	vmaMapMemory(m_Engine->GetAllocator(), m_Engine->SphereBuffer.Allocation, &data);
-	memcpy(data, gpuSpheres.data(), gpuSpheres.size() * sizeof(SphereBufferData));
-	vmaUnmapMemory(m_Engine->GetAllocator(), m_Engine->SphereBuffer.Allocation);
+	m_Engine->StageBufferWrite(m_Engine->SpherePositionBuffer, std::as_bytes(scene->GetSpherePositions()));
+	m_Engine->StageBufferWrite(m_Engine->SphereRadiusBuffer, std::as_bytes(scene->GetSphereRadii()));
+	m_Engine->StageBufferWrite(m_Engine->SphereMaterialIndexBuffer, std::as_bytes(scene->GetSphereMaterialIndices()));
 }
 
 void Renderer::UpdateMaterialBuffer(const std::shared_ptr<Scene>& scene) const
@@ -108,36 +649,28 @@ void Renderer::UpdateMaterialBuffer(const std::shared_ptr<Scene>& scene) const
 	if (!scene)
 		return;
 
-	const auto& materials = scene->GetMaterials();
-	std::vector<MaterialBufferData> gpuMaterials;
-	gpuMaterials.reserve(materials.size());
-
-	for (const auto& material : materials)
-	{
-		const auto& mt = material.MaterialPtr;
-		MaterialBufferData md = {};
-		md.Color = mt->Color;
-		md.Roughness = mt->Roughness;
-		md.Metallic = mt->Metallic;
-		md.Specular = mt->Specular;
-		md.EmissionPower = mt->EmissionPower;
-		gpuMaterials.push_back(md);
-	}
-
-	void* data;
-	vmaMapMemory(m_Engine->GetAllocator(), m_Engine->MaterialBuffer.Allocation, &data);
-	memcpy(data, gpuMaterials.data(), gpuMaterials.size() * sizeof(MaterialBufferData));
-	vmaUnmapMemory(m_Engine->GetAllocator(), m_Engine->MaterialBuffer.Allocation);
+	m_Engine->StageBufferWrite(m_Engine->MaterialBuffer, std::as_bytes(scene->GetMaterials()));
 }
 
 void Renderer::ReloadShaders()
 {
 	m_Engine->ReloadShaders();
-	ResetAccumulation();
 }
 
 void Renderer::ResetAccumulation()
 {
+	// The engine copies the sums out before it clears them
+	if (!m_RequestedCheckpoint && IsCheckpointWorthSaving())
+		RequestCheckpoint();
+
 	m_SampleCount = 1;
+	m_NextTile = 0;
+	m_TraceJobCount = 0;
+	m_AccumulationStarted = false;
+	m_LastFrame = {};
+	DropTraceJobs();
 	m_Engine->ResetAccumulation();
+
+	// Starts from a single tile per frame so camera moves stay interactive
+	m_SampleScheduler.Reset();
 }
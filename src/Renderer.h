@@ -10,14 +10,30 @@
 #include <random>
 #include <future>
 #include <thread>
+#include <limits>
+#include <chrono>
+#include <filesystem>
+#include <optional>
 
+#include "AccumulationCheckpoint.h"
 #include "Camera.h"
+#include "DeviceBalancer.h"
+#include "DynamicResolution.h"
 #include "Ray.h"
-#include "Sphere.h"
+#include "SampleScheduler.h"
+#include "TileOrder.h"
 #include "Scene.h"
 #include "VulkanEngine.h"
 
 
+// How the accumulation is split between GPUs. Whole-image samples need no coordination, bands of rows converge every
+// region at the same pace but each round waits for the slowest device.
+enum class MultiDeviceSplit : uint8_t
+{
+	SAMPLES,
+	BANDS
+};
+
 class Renderer
 {
 public:
@@ -30,10 +46,15 @@ public:
 	void Render();
 	void ReloadShaders();
 
-	void SetScene(const std::shared_ptr<Scene>& scene) { m_CurrentScene = scene; }
+	void SetScene(const std::shared_ptr<Scene>& scene)
+	{
+		m_CurrentScene = scene;
+		m_UploadedSceneRevision = std::numeric_limits<uint64_t>::max();
+		m_HashedSceneRevision = std::numeric_limits<uint64_t>::max();
+	}
 
 	void ResetAccumulation();
-	void SetAccumulation(bool enabled) { m_AccumulationEnabled = enabled; }
+	void SetAccumulation(bool enabled) { m_AccumulationEnabled = enabled; m_Engine->SetAccumulationEnabled(enabled); }
 	bool IsAccumulationEnabled() const { return m_AccumulationEnabled; }
 
 	void SetMaxRayBounces(uint32_t bounces) { m_MaxRayBounces = bounces; }
@@ -49,24 +70,94 @@ public:
 	uint32_t& GetMaxSamples() { return m_MaxSamples; }
 
 	float GetRenderTime() const { return m_Engine->GetRenderTime(); }
+	const PassTimings& GetPassTimings() const { return m_Engine->GetPassTimings(); }
 	ImTextureID GetRenderTextureID() const { return m_Engine->GetRenderTextureID(); }
+	ImVec2 GetRenderTextureUV() const { return m_Engine->GetRenderTextureUV(); }
 
 	void SetBloomEnabled(bool enabled) { m_Engine->SetBloomEnabled(enabled); }
 	void SetColorGradingEnabled(bool enabled) { m_Engine->SetColorGradingEnabled(enabled); }
+	void SetExposure(float exposure) { m_Engine->SetExposure(exposure); }
+	void SetBloomRadius(float radius) { m_Engine->SetBloomRadius(radius); }
+	void SetBloomMaxDepth(uint32_t depth) { m_Engine->SetBloomMaxDepth(depth); }
 
-	bool IsComplete() const { return m_AccumulationEnabled && m_SampleCount >= m_MaxSamples; }
+	// The fixed scale applies while dynamic resolution is off and always while accumulating
+	void SetRenderScale(float scale) { m_RenderScale = scale; }
+	void SetDynamicResolution(bool enabled);
+	void SetTargetFrameTime(float milliseconds) { m_DynamicResolution.SetTargetTime(milliseconds); }
+	[[nodiscard]] float GetRenderScale() const { return m_Engine->GetRenderScale(); }
+	[[nodiscard]] glm::uvec2 GetRenderExtent() const { return m_Engine->GetRenderExtent(); }
 
-	void SwitchLuts(LUTType type) { m_Engine->SwitchLuts(type); }
+	bool IsComplete() const { return m_AccumulationEnabled && m_SampleCount >= m_MaxSamples; }
+	// Complete and nothing the trace devices traced is still on its way into the accumulation
+	bool IsFinished() const { return IsComplete() && m_SamplesInFlight == 0 && !m_BandRound && !m_Engine->HasPendingMerges(); }
+	uint32_t GetSampleCount() const { return m_SampleCount; }
+
+	// While accumulating, every frame traces as many tiles as fit the budget. One sample of the image spans frames
+	// once a tile alone fills the budget, the UI stays responsive at any resolution and bounce count.
+	void SetSampleBudget(float milliseconds) { m_SampleScheduler.SetBudget(milliseconds); }
+	// Tile size in pixels, 0 traces the whole image in one dispatch. Size and origin apply from the next sample on.
+	void SetTileSize(uint32_t tileSize) { m_TileSize = tileSize; }
+	// Tiles are traced in a spiral around the origin, in normalized render coordinates
+	void SetTileOrigin(const glm::vec2& origin) { m_TileOrigin = origin; }
+	// Fraction of the tiles of the current sample that are traced
+	float GetSampleProgress() const { return m_Tiles.empty() ? 0.f : static_cast<float>(m_NextTile) / static_cast<float>(m_Tiles.size()); }
+	// Skips presentation while accumulating, the window shows nothing new until it is switched off
+	void SetMaxThroughput(bool enabled) { m_MaxThroughput = enabled; }
+	// Blocks until every submitted frame is finished, e.g. to time an offline render
+	void WaitForFrames() const { m_Engine->WaitForFrames(); }
+	// Accumulations are saved there periodically, on completion and on shutdown. The next accumulation that starts
+	// with the scene and camera of the saved one resumes it, an empty path turns checkpoints off.
+	void SetCheckpointPath(const std::filesystem::path& path);
+	// Accumulations started from now on use this seed instead of a random one, e.g. one per render farm job
+	void SetAccumulationSeed(uint32_t seed) { m_FixedSeed = seed; }
+	// Reads the current accumulation back right away, with the hashes and seed it was started with
+	[[nodiscard]] std::optional<AccumulationCheckpoint> ReadCheckpoint();
+	// Also accumulates on every other suitable GPU, software ones like lavapipe only if asked for. Their sums are merged
+	// into the accumulation of the engine's GPU, work is balanced by the throughput measured on each of them.
+	void SetMultiDevice(bool enabled, MultiDeviceSplit split = MultiDeviceSplit::SAMPLES, bool includeSoftware = false);
+	[[nodiscard]] size_t GetTraceDeviceCount() const { return m_TraceDevices.size(); }
+
+	void SwitchLuts(uint32_t lutIndex) { m_Engine->SwitchLuts(lutIndex); }
+	void SetLutTransitionTime(float seconds) { m_Engine->SetLutTransitionTime(seconds); }
+	std::span<const std::string> GetLutNames() const { return m_Engine->GetLutNames(); }
+	uint32_t GetSelectedLut() const { return m_Engine->GetSelectedLut(); }
+	bool IsLutStreaming() const { return m_Engine->IsLutStreaming(); }
 private:
+	void UpdateRenderScale();
+	// Takes tiles in spiral order until the pixel budget is used up, finishing a round of all tiles completes a sample
+	// of the image or of this GPU's band
+	void ScheduleTiles(uint64_t pixelBudget);
+	void CompletePrimarySample();
+	void CompleteBandRound();
+	// Merges finished jobs of the trace devices and drops lost ones, before the frame decides whether to dispatch
+	void CollectTraceResults();
+	// Hands out work to idle trace devices, whole-image samples or a new round of bands
+	void SubmitTraceJobs(const Scene& scene);
+	void StartBandRound(const Scene& scene);
+	// Samples left to hand out, counting those in flight on trace devices and the one this GPU is tracing
+	[[nodiscard]] uint32_t GetRemainingSamples() const;
+	[[nodiscard]] bool SubmitTraceJob(size_t index, const Scene& scene, const TraceJob& job);
+	void DropTraceJobs();
+	// Picks the seed of a new accumulation or resumes the checkpoint if it was rendered with the same scene and camera
+	void StartAccumulation(const Scene& scene);
+	void RequestCheckpoint();
+	void WriteCheckpoint(AccumulationData data);
+	void SaveFinalCheckpoint();
+	[[nodiscard]] bool IsCheckpointWorthSaving() const;
+	[[nodiscard]] uint64_t HashScene(const Scene& scene);
+	[[nodiscard]] uint64_t HashCamera(const Camera& camera) const;
+	[[nodiscard]] UniformBufferData BuildUniforms(const Scene& scene) const;
 	void UpdateUniformBuffer(const std::shared_ptr<Scene>& scene) const;
 	void UpdateSphereBuffer(const std::shared_ptr<Scene>& scene) const;
 	void UpdateMaterialBuffer(const std::shared_ptr<Scene>& scene) const;
+
 private:
 	std::unique_ptr<VulkanEngine> m_Engine;
 	uint32_t m_Width, m_Height;
 	float m_AspectRatio;
 
 	std::weak_ptr<Scene> m_CurrentScene;
+	uint64_t m_UploadedSceneRevision = std::numeric_limits<uint64_t>::max();
 
 	glm::vec3 m_BackgroundColor = { 0.5f, 0.7f, 1.0f };
 	uint32_t m_SampleCount = 1;
@@ -74,4 +165,74 @@ private:
 	uint32_t m_MaxSamples;
 	bool m_AccumulationEnabled = false;
 	bool m_DispatchCompute;
+	bool m_MaxThroughput = false;
+	SampleScheduler m_SampleScheduler;
+
+	uint32_t m_TileSize = 256;
+	glm::vec2 m_TileOrigin = { 0.5f, 0.5f };
+	// Order of the current sample, rebuilt when the next one starts
+	std::vector<TraceTile> m_Tiles;
+	size_t m_NextTile = 0;
+	std::vector<TraceTile> m_FrameTiles;
+
+	std::filesystem::path m_CheckpointPath;
+	// Hashes and seed of the current accumulation, the sample count is filled in when its sums are read back
+	AccumulationCheckpoint m_Checkpoint;
+	// Checkpoint found on disk, kept until it is resumed or replaced by a newer one
+	std::optional<AccumulationCheckpoint> m_ResumeCandidate;
+	std::optional<uint32_t> m_FixedSeed;
+	// Metadata and target of the sums the engine is reading back, the accumulation may have been reset since
+	std::optional<AccumulationCheckpoint> m_RequestedCheckpoint;
+	std::filesystem::path m_RequestedCheckpointPath;
+	uint32_t m_CheckpointedSamples = 0;
+	std::chrono::steady_clock::time_point m_AccumulationStart;
+	// Seed and checkpoint metadata are picked once per accumulation, jobs already seeded from them are in flight
+	bool m_AccumulationStarted = false;
+	std::chrono::steady_clock::time_point m_LastCheckpoint;
+	std::future<bool> m_PendingCheckpointWrite;
+	uint64_t m_HashedSceneRevision = std::numeric_limits<uint64_t>::max();
+	uint64_t m_SceneGeometryHash = 0;
+	static constexpr std::chrono::seconds s_CheckpointInterval{ 60 };
+	// Resets and shutdowns only save accumulations that ran this long, camera moves restart them far more often
+	static constexpr std::chrono::seconds s_MinCheckpointAge{ 10 };
+
+	struct SecondaryDevice
+	{
+		std::unique_ptr<TraceDevice> Device;
+		uint64_t UploadedSceneRevision = std::numeric_limits<uint64_t>::max();
+		// Accumulation the job in flight belongs to, results of one that was reset since are dropped
+		uint64_t JobGeneration = 0;
+		TraceJob Job = {};
+		bool JobInFlight = false;
+		std::chrono::steady_clock::time_point JobStart;
+	};
+
+	// This GPU traces its band the given number of times while every trace device traces its own, the samples only
+	// count once all bands are merged
+	struct BandRound
+	{
+		// Bands of devices that couldn't take theirs are traced here as well
+		std::vector<TraceTile> PrimaryBands;
+		uint32_t Samples;
+		uint32_t PrimarySamplesLeft;
+		uint32_t PendingBands;
+	};
+
+	std::vector<SecondaryDevice> m_TraceDevices;
+	MultiDeviceSplit m_MultiDeviceSplit = MultiDeviceSplit::SAMPLES;
+	// Device 0 is the engine's GPU, trace device i is i + 1
+	DeviceBalancer m_DeviceBalancer;
+	uint64_t m_AccumulationGeneration = 0;
+	// Jobs of the current accumulation, part of their seeds
+	uint32_t m_TraceJobCount = 0;
+	// Whole-image samples submitted to trace devices and not merged yet
+	uint32_t m_SamplesInFlight = 0;
+	std::optional<BandRound> m_BandRound;
+	std::chrono::steady_clock::time_point m_LastFrame;
+	// Jobs and rounds take about this long, longer ones save submissions and readbacks but merge less often
+	static constexpr double s_TraceJobSeconds = 0.5;
+
+	DynamicResolution m_DynamicResolution;
+	bool m_DynamicResolutionEnabled = false;
+	float m_RenderScale = 1.f;
 };
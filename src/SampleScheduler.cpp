@@ -0,0 +1,25 @@
+#include "SampleScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+uint64_t SampleScheduler::Update(float traceTimeMs, uint64_t tracedPixels)
+{
+	if (traceTimeMs <= 0.f || tracedPixels == 0)
+		return m_PixelsPerFrame;
+
+	const double pixelTimeMs = traceTimeMs / static_cast<double>(tracedPixels);
+	m_SmoothedPixelTimeMs = m_SmoothedPixelTimeMs > 0.0 ? std::lerp(m_SmoothedPixelTimeMs, pixelTimeMs, s_Smoothing) : pixelTimeMs;
+
+	const double maxPixels = static_cast<double>(std::max(m_PixelsPerFrame, tracedPixels) * s_MaxGrowth);
+	const double fitting = std::floor(m_BudgetMs / m_SmoothedPixelTimeMs);
+	m_PixelsPerFrame = static_cast<uint64_t>(std::clamp(fitting, 1.0, maxPixels));
+
+	return m_PixelsPerFrame;
+}
+
+void SampleScheduler::Reset()
+{
+	m_PixelsPerFrame = 0;
+	m_SmoothedPixelTimeMs = 0.0;
+}
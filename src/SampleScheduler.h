@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Picks how much ray tracing a frame records so it fits a GPU time budget. Work is counted in pixel samples,
+// the cost of one is the measured tracing time divided by the pixel samples it covered.
+class SampleScheduler
+{
+public:
+	// Feeds the tracing time of the latest finished frame and returns the pixel samples for the next one,
+	// zero until the first measurement
+	uint64_t Update(float traceTimeMs, uint64_t tracedPixels);
+	// Starts over without an estimate, e.g. after the resolution changed the cost of a pixel
+	void Reset();
+
+	void SetBudget(float milliseconds) { m_BudgetMs = milliseconds; }
+
+	[[nodiscard]] uint64_t GetPixelsPerFrame() const { return m_PixelsPerFrame; }
+	[[nodiscard]] float GetBudget() const { return m_BudgetMs; }
+private:
+	float m_BudgetMs = 12.f;
+
+	uint64_t m_PixelsPerFrame = 0;
+	double m_SmoothedPixelTimeMs = 0.0;
+
+	static constexpr double s_Smoothing = 0.2;
+	// Timings trail the recorded frame, growing step by step keeps a stale estimate from stalling the queue
+	static constexpr uint64_t s_MaxGrowth = 2;
+};
@@ -0,0 +1,132 @@
+#include "Scene.h"
+
+namespace
+{
+	bool SameCamera(const Camera& a, const Camera& b)
+	{
+		return a.GetPosition() == b.GetPosition() &&
+			a.GetPitch() == b.GetPitch() &&
+			a.GetYaw() == b.GetYaw() &&
+			a.GetFieldOfView() == b.GetFieldOfView();
+	}
+}
+
+void Scene::AddSphere(std::string name, const glm::vec3& position, float radius, uint32_t materialIndex)
+{
+	m_SpherePositions.push_back(position);
+	m_SphereRadii.push_back(radius);
+	m_SphereMaterialIndices.push_back(materialIndex);
+	m_SphereNames.push_back(std::move(name));
+}
+
+void Scene::AddMaterial(std::string name, const Material& material)
+{
+	m_Materials.push_back(material);
+	m_MaterialNames.push_back(std::move(name));
+}
+
+void Scene::ReserveSpheres(size_t count)
+{
+	m_SpherePositions.reserve(count);
+	m_SphereRadii.reserve(count);
+	m_SphereMaterialIndices.reserve(count);
+	m_SphereNames.reserve(count);
+}
+
+void Scene::ReserveMaterials(size_t count)
+{
+	m_Materials.reserve(count);
+	m_MaterialNames.reserve(count);
+}
+
+bool Scene::SphereDiffers(const Scene& other, size_t index) const
+{
+	return m_SpherePositions[index] != other.m_SpherePositions[index] ||
+		m_SphereRadii[index] != other.m_SphereRadii[index] ||
+		m_SphereMaterialIndices[index] != other.m_SphereMaterialIndices[index] ||
+		m_SphereNames[index] != other.m_SphereNames[index];
+}
+
+SceneChanges Scene::ApplyChanges(const Scene& previous, const Scene& incoming)
+{
+	SceneChanges changes;
+
+	if (incoming.GetSphereCount() != previous.GetSphereCount() || GetSphereCount() != previous.GetSphereCount())
+	{
+		m_SpherePositions = incoming.m_SpherePositions;
+		m_SphereRadii = incoming.m_SphereRadii;
+		m_SphereMaterialIndices = incoming.m_SphereMaterialIndices;
+		m_SphereNames = incoming.m_SphereNames;
+		changes.Spheres = true;
+	}
+	else
+	{
+		for (size_t i = 0; i < incoming.m_SphereRadii.size(); i++)
+		{
+			if (incoming.SphereDiffers(previous, i))
+			{
+				m_SpherePositions[i] = incoming.m_SpherePositions[i];
+				m_SphereRadii[i] = incoming.m_SphereRadii[i];
+				m_SphereMaterialIndices[i] = incoming.m_SphereMaterialIndices[i];
+				m_SphereNames[i] = incoming.m_SphereNames[i];
+				changes.Spheres = true;
+			}
+		}
+	}
+
+	if (incoming.GetMaterialCount() != previous.GetMaterialCount() || GetMaterialCount() != previous.GetMaterialCount())
+	{
+		m_Materials = incoming.m_Materials;
+		m_MaterialNames = incoming.m_MaterialNames;
+		changes.Materials = true;
+	}
+	else
+	{
+		for (size_t i = 0; i < incoming.m_Materials.size(); i++)
+		{
+			if (incoming.m_Materials[i] != previous.m_Materials[i] || incoming.m_MaterialNames[i] != previous.m_MaterialNames[i])
+			{
+				m_Materials[i] = incoming.m_Materials[i];
+				m_MaterialNames[i] = incoming.m_MaterialNames[i];
+				changes.Materials = true;
+			}
+		}
+	}
+
+	if (incoming.m_Cameras.size() != previous.m_Cameras.size() || m_Cameras.size() != previous.m_Cameras.size())
+	{
+		m_Cameras = incoming.m_Cameras;
+		changes.Cameras = true;
+	}
+	else
+	{
+		for (size_t i = 0; i < incoming.m_Cameras.size(); i++)
+		{
+			if (!SameCamera(incoming.m_Cameras[i], previous.m_Cameras[i]))
+			{
+				m_Cameras[i] = incoming.m_Cameras[i];
+				changes.Cameras = true;
+			}
+		}
+	}
+
+	if (incoming.m_ActiveCameraIndex != previous.m_ActiveCameraIndex)
+	{
+		m_ActiveCameraIndex = incoming.m_ActiveCameraIndex;
+		changes.Cameras = true;
+	}
+
+	if (m_ActiveCameraIndex >= m_Cameras.size())
+		m_ActiveCameraIndex = 0;
+
+	if (incoming.m_BackgroundColor != previous.m_BackgroundColor)
+	{
+		m_BackgroundColor = incoming.m_BackgroundColor;
+		changes.Background = true;
+	}
+
+	if (changes.NeedsUpload())
+		MarkChanged();
+
+	return changes;
+}
@@ -1,15 +1,22 @@
 #pragma once
 
-#include "Sphere.h"
 #include "Material.h"
 #include "Camera.h"
 
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
-struct MaterialInfo
+struct SceneChanges
 {
-	std::string Name;
-	std::shared_ptr<Material> MaterialPtr;
+	bool Spheres = false;
+	bool Materials = false;
+	bool Cameras = false;
+	bool Background = false;
+
+	[[nodiscard]] bool Any() const { return Spheres || Materials || Cameras || Background; }
+	[[nodiscard]] bool NeedsUpload() const { return Spheres || Materials; }
 };
 
 class Scene
@@ -17,9 +24,32 @@ class Scene
 public:
 	Scene() = default;
 
-	std::vector<Sphere>& GetSpheres() { return m_Spheres; }
-	std::vector<MaterialInfo>& GetMaterials() { return m_Materials; }
+	void AddSphere(std::string name, const glm::vec3& position, float radius, uint32_t materialIndex);
+	void AddMaterial(std::string name, const Material& material);
+	void ReserveSpheres(size_t count);
+	void ReserveMaterials(size_t count);
+
+	uint32_t GetSphereCount() const { return static_cast<uint32_t>(m_SphereRadii.size()); }
+	uint32_t GetMaterialCount() const { return static_cast<uint32_t>(m_Materials.size()); }
+
+	// Hot data, one tightly packed array per attribute in the same layout as the GPU buffers
+	std::span<glm::vec3> GetSpherePositions() { return m_SpherePositions; }
+	std::span<float> GetSphereRadii() { return m_SphereRadii; }
+	std::span<uint32_t> GetSphereMaterialIndices() { return m_SphereMaterialIndices; }
+	std::span<Material> GetMaterials() { return m_Materials; }
+
+	std::span<const glm::vec3> GetSpherePositions() const { return m_SpherePositions; }
+	std::span<const float> GetSphereRadii() const { return m_SphereRadii; }
+	std::span<const uint32_t> GetSphereMaterialIndices() const { return m_SphereMaterialIndices; }
+	std::span<const Material> GetMaterials() const { return m_Materials; }
+
+	// Editor-only side tables, never touched by the upload path
+	const std::string& GetSphereName(uint32_t index) const { return m_SphereNames[index]; }
+	const std::string& GetMaterialName(uint32_t index) const { return m_MaterialNames[index]; }
+	std::span<const std::string> GetMaterialNames() const { return m_MaterialNames; }
+
 	std::vector<Camera>& GetCameras() { return m_Cameras; }
+	const std::vector<Camera>& GetCameras() const { return m_Cameras; }
 
 	Camera& GetActiveCamera() { return m_Cameras[m_ActiveCameraIndex]; }
 	const Camera& GetActiveCamera() const { return m_Cameras[m_ActiveCameraIndex]; }
@@ -29,7 +59,14 @@ public:
 
 	void SetBgColor(const glm::vec3& bgColor) { m_BackgroundColor = bgColor; }
 	glm::vec3& GetBgColor() { return m_BackgroundColor; }
+	const glm::vec3& GetBgColor() const { return m_BackgroundColor; }
 
+	// Bumped whenever sphere or material data changes so GPU buffers are only re-uploaded when needed
+	uint64_t GetRevision() const { return m_Revision; }
+	void MarkChanged() { m_Revision++; }
+
+	// Applies only the elements that differ between two on-disk versions of this scene
+	SceneChanges ApplyChanges(const Scene& previous, const Scene& incoming);
 
 	void SwitchCamera(int direction)
 	{
@@ -47,10 +84,20 @@ public:
 	}
 
 private:
-	std::vector<Sphere> m_Spheres;
-	std::vector<MaterialInfo> m_Materials;
+	bool SphereDiffers(const Scene& other, size_t index) const;
+
+private:
+	std::vector<glm::vec3> m_SpherePositions;
+	std::vector<float> m_SphereRadii;
+	std::vector<uint32_t> m_SphereMaterialIndices;
+	std::vector<Material> m_Materials;
+
+	std::vector<std::string> m_SphereNames;
+	std::vector<std::string> m_MaterialNames;
+
 	std::vector<Camera> m_Cameras;
 
 	glm::vec3 m_BackgroundColor = glm::vec3(0.0);
 	uint32_t m_ActiveCameraIndex = 0;
+	uint64_t m_Revision = 0;
 };
@@ -0,0 +1,368 @@
+#include "SceneSerializer.h"
+#include "AtomicFile.h"
+#include "BinaryScene.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <print>
+
+#include <json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+	// Builds a Scene straight from parser events without materializing the JSON document.
+	// Unknown keys are skipped, missing fields keep their defaults.
+	class SceneSaxHandler : public nlohmann::json_sax<json>
+	{
+	public:
+		explicit SceneSaxHandler(Scene& scene) : m_Scene(scene) {}
+
+		bool null() override { return true; }
+		bool boolean(bool) override { return true; }
+		bool number_integer(number_integer_t value) override { return Number(static_cast<double>(value)); }
+		bool number_unsigned(number_unsigned_t value) override { return Number(static_cast<double>(value)); }
+		bool number_float(number_float_t value, const string_t&) override { return Number(value); }
+		bool binary(binary_t&) override { return true; }
+
+		bool string(string_t& value) override
+		{
+			if (m_Depth == s_ElementDepth && m_Field == "Name")
+				m_Name = std::move(value);
+
+			return true;
+		}
+
+		bool key(string_t& key) override
+		{
+			if (m_Depth == s_RootDepth)
+				m_Section = SectionFromKey(key);
+			else if (m_Depth == s_ElementDepth)
+				m_Field = std::move(key);
+
+			return true;
+		}
+
+		bool start_object(std::size_t) override
+		{
+			if (++m_Depth == s_ElementDepth)
+				BeginElement();
+
+			return true;
+		}
+
+		bool end_object() override
+		{
+			if (m_Depth-- == s_ElementDepth)
+				EndElement();
+
+			return true;
+		}
+
+		bool start_array(std::size_t) override
+		{
+			m_Depth++;
+			m_Component = 0;
+			return true;
+		}
+
+		bool end_array() override
+		{
+			m_Depth--;
+			return true;
+		}
+
+		bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& exception) override
+		{
+			std::println("Scene JSON error at byte {}: {}", position, exception.what());
+			return false;
+		}
+
+	private:
+		enum class Section : uint8_t
+		{
+			NONE,
+			MATERIALS,
+			SPHERES,
+			CAMERAS,
+			ACTIVE_CAMERA_INDEX,
+			BACKGROUND_COLOR
+		};
+
+		static constexpr uint32_t s_RootDepth = 1;
+		static constexpr uint32_t s_SectionDepth = 2;
+		static constexpr uint32_t s_ElementDepth = 3;
+		static constexpr uint32_t s_FieldDepth = 4;
+
+		static Section SectionFromKey(std::string_view key)
+		{
+			if (key == "Materials")
+				return Section::MATERIALS;
+			if (key == "Spheres")
+				return Section::SPHERES;
+			if (key == "Cameras")
+				return Section::CAMERAS;
+			if (key == "ActiveCameraIndex")
+				return Section::ACTIVE_CAMERA_INDEX;
+			if (key == "BackgroundColor")
+				return Section::BACKGROUND_COLOR;
+
+			return Section::NONE;
+		}
+
+		bool Number(double value)
+		{
+			const auto number = static_cast<float>(value);
+
+			if (m_Depth == s_RootDepth && m_Section == Section::ACTIVE_CAMERA_INDEX)
+			{
+				m_Scene.SetActiveCameraIndex(static_cast<uint32_t>(value));
+			}
+			else if (m_Depth == s_SectionDepth && m_Section == Section::BACKGROUND_COLOR)
+			{
+				if (m_Component < 3)
+					m_Scene.GetBgColor()[m_Component++] = number;
+			}
+			else if (m_Depth == s_ElementDepth)
+			{
+				if (m_Field == "Radius")
+					m_Radius = number;
+				else if (m_Field == "MaterialIndex")
+					m_MaterialIndex = static_cast<uint32_t>(value);
+				else if (m_Field == "Roughness")
+					m_Material.Roughness = number;
+				else if (m_Field == "Metallic")
+					m_Material.Metallic = number;
+				else if (m_Field == "Specular")
+					m_Material.Specular = number;
+				else if (m_Field == "EmissionPower")
+					m_Material.EmissionPower = number;
+				else if (m_Field == "FieldOfView")
+					m_FieldOfView = number;
+			}
+			else if (m_Depth == s_FieldDepth && m_Component < 3)
+			{
+				if (m_Field == "Position")
+					m_Position[m_Component] = number;
+				else if (m_Field == "Color")
+					m_Material.Color[m_Component] = number;
+				else if (m_Field == "Rotation")
+					m_Rotation[m_Component] = number;
+
+				m_Component++;
+			}
+
+			return true;
+		}
+
+		void BeginElement()
+		{
+			m_Field.clear();
+			m_Name.clear();
+			m_Material = Material{};
+			m_Position = m_Section == Section::CAMERAS ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f);
+			m_Rotation = { 0.f, -90.f, 0.f };
+			m_Radius = 1.f;
+			m_MaterialIndex = 0;
+			m_FieldOfView = 90.f;
+		}
+
+		void EndElement()
+		{
+			switch (m_Section)
+			{
+			case Section::MATERIALS:
+				m_Scene.AddMaterial(std::move(m_Name), m_Material);
+				break;
+			case Section::SPHERES:
+				m_Scene.AddSphere(std::move(m_Name), m_Position, m_Radius, m_MaterialIndex);
+				break;
+			case Section::CAMERAS:
+				m_Scene.GetCameras().emplace_back(m_Position, m_Rotation.x, m_Rotation.y, m_FieldOfView);
+				break;
+			default:
+				break;
+			}
+		}
+
+	private:
+		Scene& m_Scene;
+
+		uint32_t m_Depth = 0;
+		uint32_t m_Component = 0;
+		Section m_Section = Section::NONE;
+		std::string m_Field;
+
+		std::string m_Name;
+		Material m_Material;
+		glm::vec3 m_Position = glm::vec3(0.f);
+		glm::vec3 m_Rotation = glm::vec3(0.f);
+		float m_Radius = 1.f;
+		uint32_t m_MaterialIndex = 0;
+		float m_FieldOfView = 90.f;
+	};
+}
+
+std::shared_ptr<Scene> SceneSerializer::Load(const std::filesystem::path& path)
+{
+	if (path.extension() == s_BinaryExtension)
+		return LoadBinary(path);
+
+	return LoadJSON(path);
+}
+
+bool SceneSerializer::Save(const Scene& scene, const std::filesystem::path& path)
+{
+	if (path.extension() == s_BinaryExtension)
+		return SaveBinary(scene, path);
+
+	return SaveJSON(scene, path);
+}
+
+bool SceneSerializer::IsSceneFile(const std::filesystem::path& path)
+{
+	const std::filesystem::path extension = path.extension();
+	return extension == s_JSONExtension || extension == s_BinaryExtension;
+}
+
+std::shared_ptr<Scene> SceneSerializer::LoadJSON(const std::filesystem::path& path)
+{
+	MappedFile file;
+
+	if (!file.Open(path))
+		return nullptr;
+
+	const auto* begin = reinterpret_cast<const char*>(file.GetData().data());
+	const auto* end = begin + file.GetData().size();
+
+	auto scene = std::make_shared<Scene>();
+	SceneSaxHandler handler(*scene);
+
+	if (!json::sax_parse(begin, end, &handler))
+	{
+		std::println("Couldn't parse scene file: {}", path.string());
+		return nullptr;
+	}
+
+	// The shader indexes the materials with these unchecked, like the binary format they are validated on load
+	const bool materialIndicesValid = std::ranges::all_of(scene->GetSphereMaterialIndices(), [&scene](uint32_t materialIndex) -> bool
+		{
+			return materialIndex < scene->GetMaterialCount();
+		});
+
+	if (!materialIndicesValid)
+	{
+		std::println("Scene file has invalid material indices: {}", path.string());
+		return nullptr;
+	}
+
+	if (scene->GetActiveCameraIndex() >= scene->GetCameras().size())
+		scene->SetActiveCameraIndex(0);
+
+	return scene;
+}
+
+bool SceneSerializer::SaveJSON(const Scene& scene, const std::filesystem::path& path)
+{
+	json sceneJson;
+	json materialsJson = json::array();
+
+	for (uint32_t i = 0; i < scene.GetMaterialCount(); i++)
+	{
+		json materialJson;
+		const Material& material = scene.GetMaterials()[i];
+
+		materialJson["Name"] = scene.GetMaterialName(i);
+		materialJson["Color"] = { material.Color.r, material.Color.g, material.Color.b };
+		materialJson["Roughness"] = material.Roughness;
+		materialJson["Metallic"] = material.Metallic;
+		materialJson["Specular"] = material.Specular;
+		materialJson["EmissionPower"] = material.EmissionPower;
+
+		materialsJson.push_back(materialJson);
+	}
+	sceneJson["Materials"] = materialsJson;
+
+	json spheresJson = json::array();
+	for (uint32_t i = 0; i < scene.GetSphereCount(); i++)
+	{
+		json sphereJson;
+		const glm::vec3& pos = scene.GetSpherePositions()[i];
+
+		sphereJson["Name"] = scene.GetSphereName(i);
+		sphereJson["Position"] = { pos.x, pos.y, pos.z };
+		sphereJson["Radius"] = scene.GetSphereRadii()[i];
+		sphereJson["MaterialIndex"] = scene.GetSphereMaterialIndices()[i];
+
+		spheresJson.push_back(sphereJson);
+	}
+	sceneJson["Spheres"] = spheresJson;
+
+	for (const Camera& camera : scene.GetCameras())
+	{
+		json cameraJson;
+		cameraJson["Position"] = { camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z };
+		cameraJson["Rotation"] = { camera.GetPitch(), camera.GetYaw() };
+		cameraJson["FieldOfView"] = camera.GetFieldOfView();
+		sceneJson["Cameras"].push_back(cameraJson);
+	}
+
+	sceneJson["ActiveCameraIndex"] = scene.GetActiveCameraIndex();
+
+	const glm::vec3& bgColor = scene.GetBgColor();
+	sceneJson["BackgroundColor"] = { bgColor.x, bgColor.y, bgColor.z };
+
+	return WriteFileAtomically(path, [&sceneJson](std::ofstream& stream) -> void
+		{
+			stream << sceneJson.dump(4);
+		});
+}
+
+std::shared_ptr<Scene> SceneSerializer::LoadBinary(const std::filesystem::path& path)
+{
+	BinarySceneFile file;
+
+	if (!file.Open(path))
+		return nullptr;
+
+	const BinarySceneHeader& header = file.GetHeader();
+	auto scene = std::make_shared<Scene>();
+
+	scene->ReserveSpheres(header.SphereCount);
+	for (uint32_t i = 0; i < header.SphereCount; i++)
+	{
+		scene->AddSphere(std::string(file.GetSphereName(i)), file.GetSpherePositions()[i],
+			file.GetSphereRadii()[i], file.GetSphereMaterialIndices()[i]);
+	}
+
+	scene->ReserveMaterials(header.MaterialCount);
+	for (uint32_t i = 0; i < header.MaterialCount; i++)
+	{
+		scene->AddMaterial(std::string(file.GetMaterialName(i)), file.GetMaterials()[i]);
+	}
+
+	auto& cameras = scene->GetCameras();
+	cameras.reserve(header.CameraCount);
+	for (const BinaryCamera& camera : file.GetCameras())
+	{
+		cameras.emplace_back(camera.Position, camera.Pitch, camera.Yaw, camera.FieldOfView);
+	}
+
+	scene->SetActiveCameraIndex(header.ActiveCameraIndex < header.CameraCount ? header.ActiveCameraIndex : 0);
+	scene->SetBgColor(header.BackgroundColor);
+
+	return scene;
+}
+
+bool SceneSerializer::SaveBinary(const Scene& scene, const std::filesystem::path& path)
+{
+	return BinarySceneFile::Write(scene, path);
+}
+
+std::string SceneSerializer::SceneNameFromPath(const std::filesystem::path& path)
+{
+	const std::string fileName = path.filename().string();
+	return fileName.substr(0, fileName.find('.'));
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Scene.h"
+
+namespace SceneSerializer
+{
+	inline constexpr std::string_view s_JSONExtension = ".json";
+	inline constexpr std::string_view s_BinaryExtension = ".rtscene";
+
+	// Picks the format from the file extension
+	[[nodiscard]] std::shared_ptr<Scene> Load(const std::filesystem::path& path);
+	bool Save(const Scene& scene, const std::filesystem::path& path);
+	[[nodiscard]] bool IsSceneFile(const std::filesystem::path& path);
+
+	// Returns nullptr if the file can't be opened or isn't valid JSON (e.g. while an editor is still writing it)
+	[[nodiscard]] std::shared_ptr<Scene> LoadJSON(const std::filesystem::path& path);
+	bool SaveJSON(const Scene& scene, const std::filesystem::path& path);
+
+	// Reads the mapped file section by section, the file is validated before anything is copied
+	[[nodiscard]] std::shared_ptr<Scene> LoadBinary(const std::filesystem::path& path);
+	bool SaveBinary(const Scene& scene, const std::filesystem::path& path);
+
+	[[nodiscard]] std::string SceneNameFromPath(const std::filesystem::path& path);
+}
@@ -0,0 +1,225 @@
+#include "SceneTools.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AccumulationCheckpoint.h"
+#include "SceneSerializer.h"
+
+namespace
+{
+	template<typename Function>
+	double MeasureMilliseconds(uint32_t iterations, Function&& function)
+	{
+		double bestTime = std::numeric_limits<double>::max();
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			bestTime = std::min(bestTime, elapsed.count());
+		}
+
+		return bestTime;
+	}
+}
+
+int SceneTools::Convert(const std::filesystem::path& input, const std::filesystem::path& output)
+{
+	if (!SceneSerializer::IsSceneFile(input) || !SceneSerializer::IsSceneFile(output))
+	{
+		std::println("Scene files must use the {} or {} extension", SceneSerializer::s_JSONExtension, SceneSerializer::s_BinaryExtension);
+		return 1;
+	}
+
+	const std::shared_ptr<Scene> scene = SceneSerializer::Load(input);
+
+	if (!scene || !SceneSerializer::Save(*scene, output))
+		return 1;
+
+	std::println("Converted {} -> {} ({} spheres, {} materials)", input.string(), output.string(),
+		scene->GetSphereCount(), scene->GetMaterialCount());
+	return 0;
+}
+
+int SceneTools::RunLoadBenchmark(std::span<const uint32_t> sphereCounts)
+{
+	constexpr uint32_t materialCount = 64;
+	constexpr uint32_t iterations = 5;
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "raytracer_scene_benchmark";
+	std::filesystem::create_directories(directory);
+
+	std::println("{:>10} | {:>12} {:>12} | {:>12} {:>12} | {:>8}", "spheres", "json MB", "json ms", "binary MB", "binary ms", "speedup");
+
+	for (const uint32_t sphereCount : sphereCounts)
+	{
+		const Scene scene = GenerateScene(sphereCount, materialCount, sphereCount);
+		const std::filesystem::path jsonPath = directory / std::format("bench_{}{}", sphereCount, SceneSerializer::s_JSONExtension);
+		const std::filesystem::path binaryPath = directory / std::format("bench_{}{}", sphereCount, SceneSerializer::s_BinaryExtension);
+
+		if (!SceneSerializer::SaveJSON(scene, jsonPath) || !SceneSerializer::SaveBinary(scene, binaryPath))
+			return 1;
+
+		const double jsonTime = MeasureMilliseconds(iterations, [&jsonPath]() -> void
+			{
+				[[maybe_unused]] const auto loaded = SceneSerializer::LoadJSON(jsonPath);
+			});
+
+		const double binaryTime = MeasureMilliseconds(iterations, [&binaryPath]() -> void
+			{
+				[[maybe_unused]] const auto loaded = SceneSerializer::LoadBinary(binaryPath);
+			});
+
+		constexpr double bytesPerMB = 1024.0 * 1024.0;
+		std::println("{:>10} | {:>12.2f} {:>12.2f} | {:>12.2f} {:>12.2f} | {:>7.1f}x", sphereCount,
+			static_cast<double>(std::filesystem::file_size(jsonPath)) / bytesPerMB, jsonTime,
+			static_cast<double>(std::filesystem::file_size(binaryPath)) / bytesPerMB, binaryTime,
+			jsonTime / binaryTime);
+
+		std::filesystem::remove(jsonPath);
+		std::filesystem::remove(binaryPath);
+	}
+
+	return 0;
+}
+
+Scene SceneTools::GenerateScene(uint32_t sphereCount, uint32_t materialCount, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::uniform_int_distribution<uint32_t> materialIndex(0, std::max(materialCount, 1u) - 1);
+
+	Scene scene;
+
+	scene.ReserveMaterials(materialCount);
+	for (uint32_t i = 0; i < materialCount; i++)
+	{
+		Material material;
+		material.Color = { unit(generator), unit(generator), unit(generator) };
+		material.Roughness = unit(generator);
+		material.Metallic = unit(generator);
+		material.Specular = unit(generator);
+		material.EmissionPower = unit(generator) < 0.1f ? unit(generator) * 10.f : 0.f;
+
+		scene.AddMaterial(std::format("Material{}", i), material);
+	}
+
+	const float extent = std::cbrt(static_cast<float>(sphereCount)) * 2.f;
+
+	scene.ReserveSpheres(sphereCount);
+	for (uint32_t i = 0; i < sphereCount; i++)
+	{
+		const float x = unit(generator);
+		const float y = unit(generator);
+		const float z = unit(generator);
+		const float radius = 0.2f + unit(generator) * 0.8f;
+
+		scene.AddSphere(std::format("Sphere{}", i), (glm::vec3(x, y, z) - 0.5f) * extent, radius, materialIndex(generator));
+	}
+
+	scene.GetCameras().emplace_back(glm::vec3(0.f, 0.f, extent), 0.f, -90.f, 90.f);
+	scene.SetBgColor({ 0.5f, 0.7f, 1.0f });
+
+	return scene;
+}
+
+int SceneTools::MergeCheckpoints(const std::filesystem::path& output, std::span<const std::filesystem::path> inputs)
+{
+	std::optional<AccumulationCheckpoint> merged;
+
+	for (const std::filesystem::path& input : inputs)
+	{
+		std::optional<AccumulationCheckpoint> checkpoint = AccumulationCheckpoint::Read(input);
+
+		if (!checkpoint)
+		{
+			std::println("Couldn't read {}", input.string());
+			return 1;
+		}
+
+		if (!merged)
+			merged = std::move(checkpoint);
+		else if (!merged->Merge(*checkpoint))
+			return 1;
+	}
+
+	if (!merged || !merged->Write(output))
+		return 1;
+
+	std::println("Merged {} checkpoints -> {} ({} samples at {}x{})", inputs.size(), output.string(), merged->SampleCount,
+		merged->Accumulation.Extent.x, merged->Accumulation.Extent.y);
+	return 0;
+}
+
+bool SceneTools::Run(int argc, char** argv, int& outExitCode)
+{
+	if (argc < 2)
+		return false;
+
+	const std::string_view command = argv[1];
+
+	if (command == "--convert")
+	{
+		if (argc != 4)
+		{
+			std::println("Usage: {} --convert <input> <output>", argv[0]);
+			outExitCode = 1;
+			return true;
+		}
+
+		outExitCode = Convert(argv[2], argv[3]);
+		return true;
+	}
+
+	if (command == "--benchmark-scenes")
+	{
+		std::vector<uint32_t> sphereCounts;
+
+		for (int i = 2; i < argc; i++)
+		{
+			const std::string_view argument = argv[i];
+			uint32_t sphereCount = 0;
+
+			if (std::from_chars(argument.data(), argument.data() + argument.size(), sphereCount).ec != std::errc())
+			{
+				std::println("Invalid sphere count: {}", argument);
+				outExitCode = 1;
+				return true;
+			}
+
+			sphereCounts.push_back(sphereCount);
+		}
+
+		if (sphereCounts.empty())
+			sphereCounts = { 1'000, 10'000, 100'000, 1'000'000 };
+
+		outExitCode = RunLoadBenchmark(sphereCounts);
+		return true;
+	}
+
+	if (command == "--merge-checkpoints")
+	{
+		if (argc < 5)
+		{
+			std::println("Usage: {} --merge-checkpoints <output> <input> <input...>", argv[0]);
+			outExitCode = 1;
+			return true;
+		}
+
+		const std::vector<std::filesystem::path> inputs(argv + 3, argv + argc);
+		outExitCode = MergeCheckpoints(argv[2], inputs);
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "Scene.h"
+
+// Command line utilities that run without creating a window or a Vulkan device
+namespace SceneTools
+{
+	// Converts between the JSON and binary scene formats, the direction is picked from the file extensions
+	int Convert(const std::filesystem::path& input, const std::filesystem::path& output);
+
+	// Generates scenes with the given sphere counts and reports how long each format takes to load
+	int RunLoadBenchmark(std::span<const uint32_t> sphereCounts);
+
+	[[nodiscard]] Scene GenerateScene(uint32_t sphereCount, uint32_t materialCount, uint32_t seed);
+
+	// Sums the accumulation checkpoints of one image rendered with different seeds, e.g. on several machines
+	int MergeCheckpoints(const std::filesystem::path& output, std::span<const std::filesystem::path> inputs);
+
+	// Handles "--convert <in> <out>", "--benchmark-scenes [counts...]" and "--merge-checkpoints <out> <in...>",
+	// returns false if none was given
+	bool Run(int argc, char** argv, int& outExitCode);
+}
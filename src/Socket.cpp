@@ -0,0 +1,257 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <print>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	using NativeSocket = SOCKET;
+	constexpr int s_SendFlags = 0;
+
+	bool InitSockets()
+	{
+		static const bool initialized = []() -> bool
+			{
+				WSADATA data;
+				return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+			}();
+
+		return initialized;
+	}
+
+	void CloseNative(NativeSocket socket) { closesocket(socket); }
+	void ShutdownNative(NativeSocket socket) { shutdown(socket, SD_BOTH); }
+	int PollNative(pollfd* fds, int timeout) { return WSAPoll(fds, 1, timeout); }
+
+	void SetSendTimeoutNative(NativeSocket socket, std::chrono::milliseconds timeout)
+	{
+		const DWORD milliseconds = static_cast<DWORD>(timeout.count());
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+	}
+#else
+	using NativeSocket = int;
+	// A worker that went away must fail the send instead of killing the coordinator with SIGPIPE
+#ifdef MSG_NOSIGNAL
+	constexpr int s_SendFlags = MSG_NOSIGNAL;
+#else
+	constexpr int s_SendFlags = 0;
+#endif
+
+	bool InitSockets() { return true; }
+	void CloseNative(NativeSocket socket) { close(socket); }
+	void ShutdownNative(NativeSocket socket) { shutdown(socket, SHUT_RDWR); }
+	int PollNative(pollfd* fds, int timeout) { return poll(fds, 1, timeout); }
+
+	void SetSendTimeoutNative(NativeSocket socket, std::chrono::milliseconds timeout)
+	{
+		timeval time = {};
+		time.tv_sec = static_cast<decltype(time.tv_sec)>(timeout.count() / 1000);
+		time.tv_usec = static_cast<decltype(time.tv_usec)>(timeout.count() % 1000 * 1000);
+		setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &time, sizeof(time));
+	}
+#endif
+
+	NativeSocket ToNative(intptr_t handle) { return static_cast<NativeSocket>(handle); }
+}
+
+Socket::~Socket()
+{
+	Close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+	: m_Handle(std::exchange(other.m_Handle, s_InvalidHandle))
+{
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_Handle = std::exchange(other.m_Handle, s_InvalidHandle);
+	}
+
+	return *this;
+}
+
+bool Socket::Listen(const std::string& address, uint16_t port)
+{
+	Close();
+
+	if (!InitSockets())
+		return false;
+
+	sockaddr_in bindAddress = {};
+	bindAddress.sin_family = AF_INET;
+	bindAddress.sin_port = htons(port);
+
+	if (inet_pton(AF_INET, address.c_str(), &bindAddress.sin_addr) != 1)
+	{
+		std::println("Invalid IPv4 address to listen on: {}", address);
+		return false;
+	}
+
+	const NativeSocket socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	m_Handle = static_cast<intptr_t>(socket);
+
+	if (!IsOpen())
+	{
+		std::println("Couldn't create a socket");
+		return false;
+	}
+
+	// A coordinator restarted right away can take the port of the previous one back
+	const int reuse = 1;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+	if (bind(socket, reinterpret_cast<const sockaddr*>(&bindAddress), sizeof(bindAddress)) != 0 || listen(socket, SOMAXCONN) != 0)
+	{
+		std::println("Couldn't listen on {}:{}", address, port);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool Socket::Connect(const std::string& host, uint16_t port)
+{
+	Close();
+
+	if (!InitSockets())
+		return false;
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+	{
+		std::println("Couldn't resolve {}", host);
+		return false;
+	}
+
+	for (const addrinfo* address = addresses; address && !IsOpen(); address = address->ai_next)
+	{
+		const NativeSocket socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		m_Handle = static_cast<intptr_t>(socket);
+
+		if (IsOpen() && connect(socket, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0)
+			Close();
+	}
+
+	freeaddrinfo(addresses);
+
+	if (!IsOpen())
+	{
+		std::println("Couldn't connect to {}:{}", host, port);
+		return false;
+	}
+
+	// Messages are written in one piece, there is nothing to gain from delaying the small ones
+	const int noDelay = 1;
+	setsockopt(ToNative(m_Handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+	return true;
+}
+
+Socket Socket::Accept(std::chrono::milliseconds timeout) const
+{
+	Socket connection;
+
+	pollfd listener = {};
+	listener.fd = ToNative(m_Handle);
+	listener.events = POLLIN;
+
+	if (PollNative(&listener, static_cast<int>(timeout.count())) <= 0)
+		return connection;
+
+	connection.m_Handle = static_cast<intptr_t>(accept(ToNative(m_Handle), nullptr, nullptr));
+	return connection;
+}
+
+void Socket::Close()
+{
+	if (IsOpen())
+	{
+		CloseNative(ToNative(m_Handle));
+		m_Handle = s_InvalidHandle;
+	}
+}
+
+void Socket::Shutdown() const
+{
+	if (IsOpen())
+		ShutdownNative(ToNative(m_Handle));
+}
+
+void Socket::SetSendTimeout(std::chrono::milliseconds timeout) const
+{
+	if (IsOpen())
+		SetSendTimeoutNative(ToNative(m_Handle), timeout);
+}
+
+bool Socket::Send(std::span<const std::byte> data) const
+{
+	while (!data.empty())
+	{
+		// Chunked, a single call takes an int length on Windows
+		const int chunk = static_cast<int>(std::min<size_t>(data.size(), 1 << 20));
+		const auto sent = send(ToNative(m_Handle), reinterpret_cast<const char*>(data.data()), chunk, s_SendFlags);
+
+		if (sent <= 0)
+			return false;
+
+		data = data.subspan(static_cast<size_t>(sent));
+	}
+
+	return true;
+}
+
+bool Socket::Receive(std::span<std::byte> data) const
+{
+	while (!data.empty())
+	{
+		const int chunk = static_cast<int>(std::min<size_t>(data.size(), 1 << 20));
+		const auto received = recv(ToNative(m_Handle), reinterpret_cast<char*>(data.data()), chunk, 0);
+
+		if (received <= 0)
+			return false;
+
+		data = data.subspan(static_cast<size_t>(received));
+	}
+
+	return true;
+}
+
+uint16_t Socket::GetLocalPort() const
+{
+	sockaddr_in address = {};
+	socklen_t length = sizeof(address);
+
+	if (getsockname(ToNative(m_Handle), reinterpret_cast<sockaddr*>(&address), &length) != 0)
+		return 0;
+
+	return ntohs(address.sin_port);
+}
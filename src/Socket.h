@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// Blocking TCP stream socket, closed on destruction
+class Socket
+{
+public:
+	Socket() = default;
+	~Socket();
+
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+
+	// Accepts connections on the interface of the IPv4 address, 0.0.0.0 for all of them. Port 0 picks a free one.
+	[[nodiscard]] bool Listen(const std::string& address, uint16_t port);
+	[[nodiscard]] bool Connect(const std::string& host, uint16_t port);
+	// Waits for a connection to a listening socket, the returned socket is closed if none came within the timeout
+	[[nodiscard]] Socket Accept(std::chrono::milliseconds timeout) const;
+	void Close();
+	// Ends both directions while the socket stays open, a Send or Receive blocked on another thread returns false
+	void Shutdown() const;
+	// Send fails once the peer stopped reading for this long, instead of blocking forever
+	void SetSendTimeout(std::chrono::milliseconds timeout) const;
+
+	// Both block until every byte went through, false once the peer closed the connection or it failed
+	[[nodiscard]] bool Send(std::span<const std::byte> data) const;
+	[[nodiscard]] bool Receive(std::span<std::byte> data) const;
+
+	[[nodiscard]] bool IsOpen() const { return m_Handle != s_InvalidHandle; }
+	[[nodiscard]] uint16_t GetLocalPort() const;
+
+private:
+	// Wide enough for both file descriptors and Winsock handles
+	static constexpr intptr_t s_InvalidHandle = -1;
+	intptr_t m_Handle = s_InvalidHandle;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+// Lock-free ring buffer for exactly one producer thread and one consumer thread.
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+public:
+	bool Push(const T& value)
+	{
+		const size_t head = m_Head.load(std::memory_order_relaxed);
+
+		if (head - m_Tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		m_Items[head & (Capacity - 1)] = value;
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	std::optional<T> Pop()
+	{
+		const size_t tail = m_Tail.load(std::memory_order_relaxed);
+
+		if (tail == m_Head.load(std::memory_order_acquire))
+			return std::nullopt;
+
+		T value = std::move(m_Items[tail & (Capacity - 1)]);
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return value;
+	}
+
+private:
+	std::array<T, Capacity> m_Items;
+	alignas(64) std::atomic<size_t> m_Head = 0;
+	alignas(64) std::atomic<size_t> m_Tail = 0;
+};
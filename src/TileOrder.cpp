@@ -0,0 +1,55 @@
+#include "TileOrder.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<TraceTile> TileOrder::BuildSpiral(glm::uvec2 extent, uint32_t tileSize, glm::vec2 origin)
+{
+	if (extent.x == 0 || extent.y == 0)
+		return {};
+
+	if (tileSize == 0)
+		return { { glm::uvec2(0), extent } };
+
+	const glm::ivec2 tileCount = glm::ivec2((extent + tileSize - 1u) / tileSize);
+	const glm::ivec2 originTile = glm::clamp(glm::ivec2(glm::clamp(origin, 0.f, 1.f) * glm::vec2(tileCount)), glm::ivec2(0), tileCount - 1);
+
+	struct OrderedTile
+	{
+		TraceTile Tile;
+		// Square ring around the origin tile, then the angle within the ring, which walks each ring once around
+		int Ring;
+		float Angle;
+	};
+
+	std::vector<OrderedTile> ordered;
+	ordered.reserve(static_cast<size_t>(tileCount.x) * tileCount.y);
+
+	for (int y = 0; y < tileCount.y; y++)
+	{
+		for (int x = 0; x < tileCount.x; x++)
+		{
+			const glm::uvec2 offset = glm::uvec2(x, y) * tileSize;
+			const glm::ivec2 delta = glm::ivec2(x, y) - originTile;
+
+			ordered.push_back({
+				{ offset, glm::min(glm::uvec2(tileSize), extent - offset) },
+				std::max(std::abs(delta.x), std::abs(delta.y)),
+				std::atan2(static_cast<float>(delta.y), static_cast<float>(delta.x))
+			});
+		}
+	}
+
+	std::ranges::sort(ordered, [](const OrderedTile& a, const OrderedTile& b) -> bool
+		{
+			return a.Ring != b.Ring ? a.Ring < b.Ring : a.Angle < b.Angle;
+		});
+
+	std::vector<TraceTile> tiles;
+	tiles.reserve(ordered.size());
+
+	for (const OrderedTile& tile : ordered)
+		tiles.push_back(tile.Tile);
+
+	return tiles;
+}
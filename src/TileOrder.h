@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "VulkanTypes.h"
+
+// Splits the render extent into square tiles that are traced in a spiral, so the region around the origin converges first
+namespace TileOrder
+{
+	// The origin is in normalized render coordinates, (0.5, 0.5) is the centre.
+	// Tiles are clipped to the extent, a tile size of 0 yields a single tile covering all of it.
+	[[nodiscard]] std::vector<TraceTile> BuildSpiral(glm::uvec2 extent, uint32_t tileSize, glm::vec2 origin);
+}
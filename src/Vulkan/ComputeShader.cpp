@@ -0,0 +1,210 @@
+#include "ComputeShader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <print>
+
+namespace
+{
+	// Every combination gets its own pipeline, so this bounds the variant count at 16
+	constexpr uint32_t s_MaxSpecializationConstants = 4;
+
+	std::vector<uint32_t> LoadShaderFromFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+		auto const fileSize = static_cast<size_t>(file.tellg());
+		file.seekg(0, std::ios::beg);
+
+		if (fileSize % 4 != 0) 
+		{
+			std::println("Shader file size not a multiple of 4: {} bytes", fileSize);
+			return {};
+		}
+
+		std::vector<uint32_t> buffer(fileSize / 4);
+		file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+
+		return buffer;
+	}
+}
+
+bool ComputeShader::Build(VkDevice device, DescriptorCache& descriptorCache, const std::filesystem::path& path, Shader& outShader)
+{
+	Shader& shader = outShader;
+
+	const std::vector<uint32_t> buffer = LoadShaderFromFile(path);
+
+	if (!shader.Reflection.Reflect(buffer))
+	{
+		std::println("Failed to reflect shader: {}", path.string());
+		return false;
+	}
+
+	shader.DescriptorLayout = descriptorCache.GetLayout(shader.Reflection);
+
+	if (shader.DescriptorLayout == VK_NULL_HANDLE)
+		return false;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &shader.DescriptorLayout;
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = shader.Reflection.PushConstantSize;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	if (pushConstantRange.size > 0)
+	{
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+	}
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &shader.PipelineLayout))
+	{
+		std::println("Failed to create compute pipeline layout");
+		return false;
+	}
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = buffer.size() * sizeof(uint32_t);
+	createInfo.pCode = buffer.data();
+
+	VkShaderModule computeShaderModule = {};
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &computeShaderModule))
+	{
+		std::println("Failed to create compute shader module");
+		vkDestroyPipelineLayout(device, shader.PipelineLayout, nullptr);
+		return false;
+	}
+
+	VkPipelineShaderStageCreateInfo shaderStageInfo = {};
+	shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStageInfo.module = computeShaderModule;
+	shaderStageInfo.pName = "main";
+
+	const std::vector<uint32_t>& specializationIds = shader.Reflection.BoolSpecializationIds;
+
+	if (specializationIds.size() > s_MaxSpecializationConstants)
+	{
+		std::println("Shader has {} bool specialization constants, at most {} are supported: {}", specializationIds.size(), s_MaxSpecializationConstants, path.string());
+		vkDestroyShaderModule(device, computeShaderModule, nullptr);
+		vkDestroyPipelineLayout(device, shader.PipelineLayout, nullptr);
+		return false;
+	}
+
+	// VkBool32 values, one per constant, rewritten for each variant
+	std::vector<VkBool32> specializationData(specializationIds.size());
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+
+	for (uint32_t i = 0; i < specializationIds.size(); i++)
+		specializationEntries.push_back({ specializationIds[i], static_cast<uint32_t>(i * sizeof(VkBool32)), sizeof(VkBool32) });
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = specializationData.size() * sizeof(VkBool32);
+	specializationInfo.pData = specializationData.data();
+
+	if (!specializationEntries.empty())
+		shaderStageInfo.pSpecializationInfo = &specializationInfo;
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStageInfo;
+	pipelineInfo.layout = shader.PipelineLayout;
+
+	const uint32_t variantCount = 1u << specializationIds.size();
+	shader.Pipelines.assign(variantCount, VK_NULL_HANDLE);
+
+	for (uint32_t variant = 0; variant < variantCount; variant++)
+	{
+		for (uint32_t i = 0; i < specializationData.size(); i++)
+			specializationData[i] = (variant >> i) & 1u ? VK_TRUE : VK_FALSE;
+
+		if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shader.Pipelines[variant]))
+		{
+			std::println("Failed to create compute pipeline");
+			vkDestroyShaderModule(device, computeShaderModule, nullptr);
+			shader.Destroy(device);
+			shader.Pipelines.clear();
+			return false;
+		}
+	}
+
+	vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+	return true;
+}
+
+void ComputeShader::UpdateDescriptorSets(VkDevice device, const Shader& shader)
+{
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	descriptorWrites.reserve(shader.Reflection.Bindings.size());
+
+	for (const auto& layoutBinding : shader.Reflection.Bindings)
+	{
+		if (layoutBinding.descriptorCount > 1)
+		{
+			const auto elements = shader.ArrayBindings.find(layoutBinding.binding);
+			if (elements == shader.ArrayBindings.end())
+			{
+				std::println("No resource bound to binding {}", layoutBinding.binding);
+				continue;
+			}
+
+			for (uint32_t element = 0; element < std::min<size_t>(elements->second.size(), layoutBinding.descriptorCount); element++)
+			{
+				if (elements->second[element].imageView == VK_NULL_HANDLE)
+					continue;
+
+				VkWriteDescriptorSet writeDescriptorSet = {};
+				writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				writeDescriptorSet.dstSet = shader.DescriptorSet;
+				writeDescriptorSet.dstBinding = layoutBinding.binding;
+				writeDescriptorSet.dstArrayElement = element;
+				writeDescriptorSet.descriptorType = layoutBinding.descriptorType;
+				writeDescriptorSet.descriptorCount = 1;
+				writeDescriptorSet.pImageInfo = &elements->second[element];
+
+				descriptorWrites.push_back(writeDescriptorSet);
+			}
+
+			continue;
+		}
+
+		const auto it = shader.Bindings.find(layoutBinding.binding);
+		if (it == shader.Bindings.end())
+		{
+			std::println("No resource bound to binding {}", layoutBinding.binding);
+			continue;
+		}
+
+		VkWriteDescriptorSet writeDescriptorSet = {};
+		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeDescriptorSet.dstSet = shader.DescriptorSet;
+		writeDescriptorSet.dstBinding = layoutBinding.binding;
+		writeDescriptorSet.descriptorType = layoutBinding.descriptorType;
+		writeDescriptorSet.descriptorCount = 1;
+
+		if (layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+			layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+			layoutBinding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+		{
+			writeDescriptorSet.pImageInfo = &it->second.ImageInfo;
+		}
+		else
+		{
+			writeDescriptorSet.pBufferInfo = &it->second.BufferInfo;
+		}
+
+		descriptorWrites.push_back(writeDescriptorSet);
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()),
+		descriptorWrites.data(), 0, nullptr);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+
+#include <vulkan/vulkan.h>
+
+#include "DescriptorCache.h"
+#include "VulkanTypes.h"
+
+// Pipeline and descriptor plumbing of the compute shaders, shared by the engine and the trace devices
+namespace ComputeShader
+{
+	// Reflects the SPIR-V at path and creates its pipeline layout and one pipeline per specialization variant.
+	// The descriptor set is left to the caller.
+	[[nodiscard]] bool Build(VkDevice device, DescriptorCache& descriptorCache, const std::filesystem::path& path, Shader& outShader);
+	// Writes the bound resources of every reflected binding into the shader's descriptor set
+	void UpdateDescriptorSets(VkDevice device, const Shader& shader);
+}
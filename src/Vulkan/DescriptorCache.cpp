@@ -0,0 +1,192 @@
+#include "DescriptorCache.h"
+
+#include <algorithm>
+#include <print>
+#include <ranges>
+
+namespace
+{
+	bool IsSameBinding(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount &&
+			a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+	}
+}
+
+VkDescriptorSetLayout DescriptorCache::GetLayout(const ShaderReflection& reflection)
+{
+	std::lock_guard lock(m_Mutex);
+
+	const size_t hash = reflection.LayoutHash();
+
+	const auto [first, last] = m_LayoutsByHash.equal_range(hash);
+
+	for (const VkDescriptorSetLayout layout : std::ranges::subrange(first, last) | std::views::values)
+	{
+		if (std::ranges::equal(m_Layouts.at(layout).Bindings, reflection.Bindings, IsSameBinding))
+			return layout;
+	}
+
+	LayoutEntry entry = {};
+	entry.Bindings = reflection.Bindings;
+
+	// Descriptor arrays only need the elements that are used. Sampled arrays are filled in piecemeal
+	// while frames using other elements are in flight.
+	std::vector<VkDescriptorBindingFlags> bindingFlags;
+	bindingFlags.reserve(reflection.Bindings.size());
+	bool hasArrays = false;
+
+	for (const auto& binding : reflection.Bindings)
+	{
+		const bool isArray = binding.descriptorCount > 1;
+		const bool isStreamed = isArray && (binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+
+		VkDescriptorBindingFlags flags = isArray ? VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT : 0;
+		if (isStreamed)
+			flags |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		bindingFlags.push_back(flags);
+		hasArrays |= isArray;
+		entry.UpdateAfterBind |= isStreamed;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(reflection.Bindings.size());
+	layoutInfo.pBindings = reflection.Bindings.data();
+
+	if (hasArrays)
+		layoutInfo.pNext = &bindingFlagsInfo;
+
+	if (entry.UpdateAfterBind)
+		layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+
+	if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &entry.Layout))
+	{
+		std::println("Failed to create descriptor set layout");
+		return VK_NULL_HANDLE;
+	}
+
+	std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
+	for (const auto& binding : reflection.Bindings)
+	{
+		descriptorCounts[binding.descriptorType] += binding.descriptorCount;
+	}
+
+	for (const auto& [type, count] : descriptorCounts)
+	{
+		entry.PoolSizes.emplace_back(type, count * s_SetsPerPool);
+	}
+
+	const VkDescriptorSetLayout layout = entry.Layout;
+	m_LayoutsByHash.emplace(hash, layout);
+	m_Layouts[layout] = std::move(entry);
+
+	return layout;
+}
+
+VkDescriptorSet DescriptorCache::Allocate(VkDescriptorSetLayout layout)
+{
+	std::lock_guard lock(m_Mutex);
+
+	const auto layoutIt = m_Layouts.find(layout);
+	if (layoutIt == m_Layouts.end())
+	{
+		std::println("Descriptor set layout was not created by the cache");
+		return VK_NULL_HANDLE;
+	}
+
+	LayoutEntry& entry = layoutIt->second;
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &entry.Layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	for (const VkDescriptorPool pool : entry.Pools)
+	{
+		allocInfo.descriptorPool = pool;
+		if (vkAllocateDescriptorSets(m_Device, &allocInfo, &set) == VK_SUCCESS)
+		{
+			m_SetPools[set] = pool;
+			return set;
+		}
+	}
+
+	const VkDescriptorPool pool = CreatePool(entry.PoolSizes, entry.UpdateAfterBind);
+	if (pool == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	entry.Pools.push_back(pool);
+
+	allocInfo.descriptorPool = pool;
+	if (vkAllocateDescriptorSets(m_Device, &allocInfo, &set))
+	{
+		std::println("Failed to allocate descriptor set");
+		return VK_NULL_HANDLE;
+	}
+
+	m_SetPools[set] = pool;
+	return set;
+}
+
+void DescriptorCache::Free(VkDescriptorSet set)
+{
+	std::lock_guard lock(m_Mutex);
+
+	const auto it = m_SetPools.find(set);
+	if (it == m_SetPools.end())
+		return;
+
+	vkFreeDescriptorSets(m_Device, it->second, 1, &set);
+	m_SetPools.erase(it);
+}
+
+VkDescriptorPool DescriptorCache::CreatePool(const std::vector<VkDescriptorPoolSize>& poolSizes, bool updateAfterBind) const
+{
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+	if (updateAfterBind)
+		poolInfo.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+
+	poolInfo.maxSets = s_SetsPerPool;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &pool))
+	{
+		std::println("Failed to create descriptor pool");
+		return VK_NULL_HANDLE;
+	}
+
+	return pool;
+}
+
+void DescriptorCache::Cleanup()
+{
+	std::lock_guard lock(m_Mutex);
+
+	for (const auto& entry : m_Layouts | std::views::values)
+	{
+		for (const VkDescriptorPool pool : entry.Pools)
+		{
+			vkDestroyDescriptorPool(m_Device, pool, nullptr);
+		}
+
+		vkDestroyDescriptorSetLayout(m_Device, entry.Layout, nullptr);
+	}
+
+	m_Layouts.clear();
+	m_LayoutsByHash.clear();
+	m_SetPools.clear();
+}
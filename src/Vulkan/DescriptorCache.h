@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderReflection.h"
+
+class DescriptorCache
+{
+public:
+	DescriptorCache() = default;
+
+	void Init(VkDevice device) { m_Device = device; }
+
+	[[nodiscard]] VkDescriptorSetLayout GetLayout(const ShaderReflection& reflection);
+	[[nodiscard]] VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+	void Free(VkDescriptorSet set);
+
+	void Cleanup();
+private:
+	[[nodiscard]] VkDescriptorPool CreatePool(const std::vector<VkDescriptorPoolSize>& poolSizes, bool updateAfterBind) const;
+private:
+	struct LayoutEntry
+	{
+		// Compared on a hash hit, different layouts may share a hash
+		std::vector<VkDescriptorSetLayoutBinding> Bindings;
+		VkDescriptorSetLayout Layout;
+		std::vector<VkDescriptorPoolSize> PoolSizes;
+		std::vector<VkDescriptorPool> Pools;
+		bool UpdateAfterBind = false;
+	};
+
+	static constexpr uint32_t s_SetsPerPool = 32;
+
+	VkDevice m_Device = VK_NULL_HANDLE;
+	std::mutex m_Mutex;
+
+	std::unordered_map<VkDescriptorSetLayout, LayoutEntry> m_Layouts;
+	std::unordered_multimap<size_t, VkDescriptorSetLayout> m_LayoutsByHash;
+	std::unordered_map<VkDescriptorSet, VkDescriptorPool> m_SetPools;
+};
@@ -0,0 +1,333 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 Stage;
+		VkAccessFlags2 Access;
+		VkImageLayout Layout;
+	};
+
+	constexpr VkAccessFlags2 s_WriteAccess = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	// Render targets are sampled in GENERAL, only ImGui samples the display image in SHADER_READ_ONLY_OPTIMAL
+	UsageInfo GetUsageInfo(ResourceUsage usage)
+	{
+		switch (usage)
+		{
+		case ResourceUsage::COMPUTE_STORAGE_READ:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::COMPUTE_STORAGE_WRITE:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::COMPUTE_STORAGE_READ_WRITE:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::COMPUTE_SAMPLED_READ:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::FRAGMENT_SAMPLED_READ:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		case ResourceUsage::COLOR_ATTACHMENT:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		case ResourceUsage::CLEAR:
+			return { VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+		case ResourceUsage::TRANSFER_READ:
+			return { VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+		case ResourceUsage::TRANSFER_WRITE:
+			return { VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+		case ResourceUsage::PRESENT:
+			return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+		}
+
+		return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+	}
+
+	bool IsWrite(ResourceUsage usage)
+	{
+		return (GetUsageInfo(usage).Access & s_WriteAccess) != 0;
+	}
+}
+
+void FrameGraph::Reset()
+{
+	m_Resources.clear();
+	m_Passes.clear();
+	m_CommandBufferIndex = 0;
+}
+
+FrameResource FrameGraph::ImportImage(VkImage image, uint32_t mipLevels, bool discard, VkPipelineStageFlags2 waitStage)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.Image = image;
+	resource.MipLevels = mipLevels;
+
+	ResourceState& state = GetState(resource);
+	state.WriteStages |= waitStage;
+
+	if (discard)
+		state.Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	return static_cast<FrameResource>(m_Resources.size() - 1);
+}
+
+FrameResource FrameGraph::ImportBuffer(VkBuffer buffer)
+{
+	m_Resources.emplace_back().Buffer = buffer;
+	return static_cast<FrameResource>(m_Resources.size() - 1);
+}
+
+FrameResource FrameGraph::AcquireImage(VkImage image, uint32_t mipLevels, uint32_t srcQueueFamily, ResourceUsage releasedAs,
+	VkPipelineStageFlags2 waitStage)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.Image = image;
+	resource.MipLevels = mipLevels;
+
+	if (srcQueueFamily != m_QueueFamily)
+		resource.AcquireFamily = srcQueueFamily;
+
+	// The semaphore made the other queue's writes visible, the acquire only has to wait for it
+	ResourceState& state = GetState(resource);
+	state = {};
+	state.WriteStages = waitStage;
+	state.Layout = GetUsageInfo(releasedAs).Layout;
+
+	return static_cast<FrameResource>(m_Resources.size() - 1);
+}
+
+void FrameGraph::MarkOutput(FrameResource resource)
+{
+	m_Resources[resource].Output = true;
+}
+
+void FrameGraph::ReleaseImage(FrameResource resource, uint32_t dstQueueFamily, ResourceUsage dstUsage)
+{
+	m_Resources[resource].Output = true;
+	m_Resources[resource].ReleaseFamily = dstQueueFamily;
+	m_Resources[resource].ReleaseUsage = dstUsage;
+}
+
+void FrameGraph::AddPass(bool enabled, std::vector<ResourceAccess> accesses, std::function<void(VkCommandBuffer)> execute)
+{
+	m_Passes.push_back({ enabled, std::move(accesses), std::move(execute), m_CommandBufferIndex });
+}
+
+void FrameGraph::Execute(std::span<const VkCommandBuffer> cmds)
+{
+	std::vector<bool> live;
+	CullPasses(live);
+
+	for (size_t i = 0; i < m_Passes.size(); i++)
+	{
+		if (!live[i])
+			continue;
+
+		const VkCommandBuffer cmd = cmds[m_Passes[i].CommandBuffer];
+		RecordBarriers(cmd, m_Passes[i]);
+
+		if (m_Passes[i].Execute)
+			m_Passes[i].Execute(cmd);
+	}
+
+	RecordReleases(cmds.back());
+}
+
+FrameGraph::ResourceState& FrameGraph::GetState(const Resource& resource)
+{
+	return resource.Image != VK_NULL_HANDLE ? m_ImageStates[resource.Image] : m_BufferStates[resource.Buffer];
+}
+
+void FrameGraph::CullPasses(std::vector<bool>& outLive) const
+{
+	outLive.assign(m_Passes.size(), false);
+
+	std::vector<bool> needed(m_Resources.size(), false);
+
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		needed[i] = m_Resources[i].Output;
+
+	// Walks back from the outputs, a pass lives if a live pass after it reads something it writes
+	for (size_t i = m_Passes.size(); i-- > 0;)
+	{
+		const Pass& pass = m_Passes[i];
+
+		if (!pass.Enabled)
+			continue;
+
+		bool writes = false;
+		bool live = false;
+
+		for (const ResourceAccess& access : pass.Accesses)
+		{
+			if (IsWrite(access.Usage))
+			{
+				writes = true;
+				live |= needed[access.Resource];
+			}
+		}
+
+		if (writes && !live)
+			continue;
+
+		outLive[i] = true;
+
+		for (const ResourceAccess& access : pass.Accesses)
+		{
+			if (access.Usage != ResourceUsage::COMPUTE_STORAGE_WRITE && access.Usage != ResourceUsage::CLEAR)
+				needed[access.Resource] = true;
+		}
+	}
+}
+
+void FrameGraph::RecordBarriers(VkCommandBuffer cmd, const Pass& pass)
+{
+	m_ImageBarriers.clear();
+	m_BufferBarriers.clear();
+
+	for (const ResourceAccess& access : pass.Accesses)
+	{
+		Resource& resource = m_Resources[access.Resource];
+		ResourceState& state = GetState(resource);
+		const UsageInfo usage = GetUsageInfo(access.Usage);
+
+		const bool write = (usage.Access & s_WriteAccess) != 0;
+		const bool layoutChange = resource.Image != VK_NULL_HANDLE && usage.Layout != state.Layout;
+		const bool visible = (usage.Stage & ~state.VisibleStages) == 0 && (usage.Access & ~state.VisibleAccess) == 0;
+		const bool acquire = resource.AcquireFamily != VK_QUEUE_FAMILY_IGNORED;
+
+		VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+
+		// Writes and transitions wait for every access since the last write, reads only for the write itself
+		if (write || layoutChange)
+			srcStages = state.WriteStages | state.ReadStages;
+		else if (state.WriteStages != VK_PIPELINE_STAGE_2_NONE && !visible)
+			srcStages = state.WriteStages;
+
+		if (srcStages != VK_PIPELINE_STAGE_2_NONE || layoutChange || acquire)
+		{
+			const auto sameImage = std::ranges::find(m_ImageBarriers, resource.Image, &VkImageMemoryBarrier2::image);
+
+			// A pass touching an image in two ways, e.g. sampling one mip and writing another, gets a single barrier
+			if (resource.Image != VK_NULL_HANDLE && sameImage != m_ImageBarriers.end())
+			{
+				sameImage->srcStageMask |= srcStages;
+				sameImage->dstStageMask |= usage.Stage;
+				sameImage->dstAccessMask |= usage.Access;
+			}
+			else if (resource.Image != VK_NULL_HANDLE)
+			{
+				VkImageMemoryBarrier2& barrier = m_ImageBarriers.emplace_back(VkImageMemoryBarrier2{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 });
+				barrier.srcStageMask = srcStages;
+				barrier.srcAccessMask = state.WriteAccess;
+				barrier.dstStageMask = usage.Stage;
+				barrier.dstAccessMask = usage.Access;
+				barrier.oldLayout = state.Layout;
+				barrier.newLayout = usage.Layout;
+				// An acquire repeats the layouts of the release, the first use of an acquired image must match the released usage
+				barrier.srcQueueFamilyIndex = acquire ? resource.AcquireFamily : VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = acquire ? m_QueueFamily : VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = resource.Image;
+				barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, resource.MipLevels, 0, 1 };
+			}
+			else
+			{
+				VkBufferMemoryBarrier2& barrier = m_BufferBarriers.emplace_back(VkBufferMemoryBarrier2{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 });
+				barrier.srcStageMask = srcStages;
+				barrier.srcAccessMask = state.WriteAccess;
+				barrier.dstStageMask = usage.Stage;
+				barrier.dstAccessMask = usage.Access;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.buffer = resource.Buffer;
+				barrier.offset = 0;
+				barrier.size = VK_WHOLE_SIZE;
+			}
+		}
+
+		resource.AcquireFamily = VK_QUEUE_FAMILY_IGNORED;
+
+		if (write)
+		{
+			// Not visible to anything until the next barrier
+			state.WriteStages = usage.Stage;
+			state.WriteAccess = usage.Access & s_WriteAccess;
+			state.ReadStages = VK_PIPELINE_STAGE_2_NONE;
+			state.VisibleStages = VK_PIPELINE_STAGE_2_NONE;
+			state.VisibleAccess = VK_ACCESS_2_NONE;
+		}
+		else if (layoutChange)
+		{
+			// The transition is a write, later reads in other stages chain through this one
+			state.WriteStages = usage.Stage;
+			state.WriteAccess = VK_ACCESS_2_NONE;
+			state.ReadStages = usage.Stage;
+			state.VisibleStages = usage.Stage;
+			state.VisibleAccess = usage.Access;
+		}
+		else
+		{
+			state.ReadStages |= usage.Stage;
+
+			if (srcStages != VK_PIPELINE_STAGE_2_NONE || acquire)
+			{
+				state.VisibleStages |= usage.Stage;
+				state.VisibleAccess |= usage.Access;
+			}
+		}
+
+		state.Layout = usage.Layout;
+	}
+
+	FlushBarriers(cmd);
+}
+
+void FrameGraph::RecordReleases(VkCommandBuffer cmd)
+{
+	m_ImageBarriers.clear();
+	m_BufferBarriers.clear();
+
+	for (const Resource& resource : m_Resources)
+	{
+		if (!resource.ReleaseUsage)
+			continue;
+
+		ResourceState& state = GetState(resource);
+		const bool transfer = resource.ReleaseFamily != m_QueueFamily;
+
+		// Nothing on this queue waits for the release, the semaphore signal after it orders it before the acquire
+		VkImageMemoryBarrier2& barrier = m_ImageBarriers.emplace_back(VkImageMemoryBarrier2{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 });
+		barrier.srcStageMask = state.WriteStages | state.ReadStages;
+		barrier.srcAccessMask = state.WriteAccess;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		barrier.oldLayout = state.Layout;
+		barrier.newLayout = GetUsageInfo(*resource.ReleaseUsage).Layout;
+		barrier.srcQueueFamilyIndex = transfer ? m_QueueFamily : VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = transfer ? resource.ReleaseFamily : VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.Image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, resource.MipLevels, 0, 1 };
+
+		// The other queue owns the image now, this queue's next use comes after a semaphore wait on it
+		state = {};
+		state.Layout = barrier.newLayout;
+	}
+
+	FlushBarriers(cmd);
+}
+
+void FrameGraph::FlushBarriers(VkCommandBuffer cmd) const
+{
+	if (m_ImageBarriers.empty() && m_BufferBarriers.empty())
+		return;
+
+	VkDependencyInfo dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_ImageBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = m_ImageBarriers.data();
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(m_BufferBarriers.size());
+	dependencyInfo.pBufferMemoryBarriers = m_BufferBarriers.data();
+
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// How a pass touches a resource, every usage maps to one stage, access and layout
+enum class ResourceUsage : uint8_t
+{
+	COMPUTE_STORAGE_READ,
+	COMPUTE_STORAGE_WRITE,
+	COMPUTE_STORAGE_READ_WRITE,
+	COMPUTE_SAMPLED_READ,
+	FRAGMENT_SAMPLED_READ,
+	COLOR_ATTACHMENT,
+	CLEAR,
+	TRANSFER_READ,
+	TRANSFER_WRITE,
+	PRESENT
+};
+
+using FrameResource = uint32_t;
+
+struct ResourceAccess
+{
+	FrameResource Resource;
+	ResourceUsage Usage;
+};
+
+// Passes declare what they read and write, the graph derives the barriers between them.
+// Passes are recorded in the order they are added, disabled passes and passes whose writes nothing reads are culled.
+// The last state of every imported image and buffer is kept across frames, so the first barrier of a frame
+// only waits for what the previous frame actually did with the resource.
+// A graph records for one queue family, images crossing to another queue are released and acquired explicitly.
+class FrameGraph
+{
+public:
+	FrameGraph() = default;
+
+	void Init(uint32_t queueFamily) { m_QueueFamily = queueFamily; }
+
+	// Drops the passes and imports of the previous frame
+	void Reset();
+
+	// A discarded image starts from UNDEFINED, its contents are rewritten before they are read.
+	// waitStage is where a semaphore wait of the submission blocks, the first barrier chains to it.
+	[[nodiscard]] FrameResource ImportImage(VkImage image, uint32_t mipLevels, bool discard = false, VkPipelineStageFlags2 waitStage = VK_PIPELINE_STAGE_2_NONE);
+	[[nodiscard]] FrameResource ImportBuffer(VkBuffer buffer);
+	// The image was released by srcQueueFamily for releasedAs, its first barrier acquires it after the semaphore wait at waitStage
+	[[nodiscard]] FrameResource AcquireImage(VkImage image, uint32_t mipLevels, uint32_t srcQueueFamily, ResourceUsage releasedAs,
+		VkPipelineStageFlags2 waitStage);
+	// Passes writing an output stay alive even if no pass of the frame reads it
+	void MarkOutput(FrameResource resource);
+	// Hands the image to dstQueueFamily after the last pass, transitioned to the layout of dstUsage. Releasing makes it an output.
+	void ReleaseImage(FrameResource resource, uint32_t dstQueueFamily, ResourceUsage dstUsage);
+
+	// Passes without writes are kept for their side effects, e.g. timestamps. The accesses of one image within a pass share a layout.
+	void AddPass(bool enabled, std::vector<ResourceAccess> accesses, std::function<void(VkCommandBuffer)> execute = {});
+	// Passes added from here on go to the next command buffer of Execute, e.g. one submitted behind a semaphore wait
+	void NextCommandBuffer() { m_CommandBufferIndex++; }
+	// Records every live pass after a single batched barrier for all of its accesses, releases go to the last command buffer.
+	// The command buffers must be submitted in order to the same queue.
+	void Execute(std::span<const VkCommandBuffer> cmds);
+
+	// The image was destroyed, a new image with the same handle must not inherit its state
+	void ForgetImage(VkImage image) { m_ImageStates.erase(image); }
+private:
+	struct ResourceState
+	{
+		VkPipelineStageFlags2 WriteStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 WriteAccess = VK_ACCESS_2_NONE;
+		// Stages that read since the last write, a later write only has to wait for these
+		VkPipelineStageFlags2 ReadStages = VK_PIPELINE_STAGE_2_NONE;
+		// Stages and accesses the last write is already visible to
+		VkPipelineStageFlags2 VisibleStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 VisibleAccess = VK_ACCESS_2_NONE;
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	struct Resource
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		uint32_t MipLevels = 1;
+		bool Output = false;
+		// Owner the first barrier acquires the image from, IGNORED once acquired or if no transfer is needed
+		uint32_t AcquireFamily = VK_QUEUE_FAMILY_IGNORED;
+		uint32_t ReleaseFamily = VK_QUEUE_FAMILY_IGNORED;
+		std::optional<ResourceUsage> ReleaseUsage;
+	};
+
+	struct Pass
+	{
+		bool Enabled;
+		std::vector<ResourceAccess> Accesses;
+		std::function<void(VkCommandBuffer)> Execute;
+		uint32_t CommandBuffer;
+	};
+
+	[[nodiscard]] ResourceState& GetState(const Resource& resource);
+	void CullPasses(std::vector<bool>& outLive) const;
+	void RecordBarriers(VkCommandBuffer cmd, const Pass& pass);
+	void RecordReleases(VkCommandBuffer cmd);
+	void FlushBarriers(VkCommandBuffer cmd) const;
+private:
+	uint32_t m_QueueFamily = VK_QUEUE_FAMILY_IGNORED;
+
+	std::vector<Resource> m_Resources;
+	std::vector<Pass> m_Passes;
+	uint32_t m_CommandBufferIndex = 0;
+
+	std::vector<VkImageMemoryBarrier2> m_ImageBarriers;
+	std::vector<VkBufferMemoryBarrier2> m_BufferBarriers;
+
+	std::unordered_map<VkImage, ResourceState> m_ImageStates;
+	std::unordered_map<VkBuffer, ResourceState> m_BufferStates;
+};
@@ -0,0 +1,386 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <functional>
+#include <print>
+#include <unordered_map>
+
+namespace
+{
+	constexpr uint32_t SpirvMagicNumber = 0x07230203;
+	constexpr size_t SpirvHeaderWordCount = 5;
+
+	constexpr uint16_t OpExecutionMode = 16;
+	constexpr uint16_t OpTypeBool = 20;
+	constexpr uint16_t OpTypeInt = 21;
+	constexpr uint16_t OpTypeFloat = 22;
+	constexpr uint16_t OpTypeVector = 23;
+	constexpr uint16_t OpTypeMatrix = 24;
+	constexpr uint16_t OpTypeImage = 25;
+	constexpr uint16_t OpTypeSampler = 26;
+	constexpr uint16_t OpTypeSampledImage = 27;
+	constexpr uint16_t OpTypeArray = 28;
+	constexpr uint16_t OpTypeRuntimeArray = 29;
+	constexpr uint16_t OpTypeStruct = 30;
+	constexpr uint16_t OpTypePointer = 32;
+	constexpr uint16_t OpConstant = 43;
+	constexpr uint16_t OpSpecConstantTrue = 48;
+	constexpr uint16_t OpSpecConstantFalse = 49;
+	constexpr uint16_t OpVariable = 59;
+	constexpr uint16_t OpDecorate = 71;
+	constexpr uint16_t OpMemberDecorate = 72;
+
+	constexpr uint32_t DecorationSpecId = 1;
+	constexpr uint32_t DecorationBufferBlock = 3;
+	constexpr uint32_t DecorationArrayStride = 6;
+	constexpr uint32_t DecorationBinding = 33;
+	constexpr uint32_t DecorationDescriptorSet = 34;
+	constexpr uint32_t DecorationOffset = 35;
+
+	constexpr uint32_t StorageClassUniformConstant = 0;
+	constexpr uint32_t StorageClassUniform = 2;
+	constexpr uint32_t StorageClassPushConstant = 9;
+	constexpr uint32_t StorageClassStorageBuffer = 12;
+
+	constexpr uint32_t ExecutionModeLocalSize = 17;
+	constexpr uint32_t ImageDimBuffer = 5;
+
+	struct SpirvType
+	{
+		uint16_t Op = 0;
+		uint32_t Width = 0;
+		uint32_t ElementType = 0;
+		uint32_t Count = 0;
+		uint32_t StorageClass = 0;
+		uint32_t Dim = 0;
+		uint32_t Sampled = 0;
+		std::vector<uint32_t> Members;
+	};
+
+	struct SpirvDecorations
+	{
+		uint32_t Binding = UINT32_MAX;
+		uint32_t Set = 0;
+		uint32_t ArrayStride = 0;
+		uint32_t SpecId = UINT32_MAX;
+		bool BufferBlock = false;
+		std::unordered_map<uint32_t, uint32_t> MemberOffsets;
+	};
+
+	struct SpirvVariable
+	{
+		uint32_t Id;
+		uint32_t PointerType;
+		uint32_t StorageClass;
+	};
+
+	struct SpirvModule
+	{
+		std::unordered_map<uint32_t, SpirvType> Types;
+		std::unordered_map<uint32_t, SpirvDecorations> Decorations;
+		std::unordered_map<uint32_t, uint32_t> Constants;
+		std::vector<SpirvVariable> Variables;
+		std::vector<uint32_t> BoolSpecConstants;
+
+		uint32_t TypeSize(uint32_t typeId) const
+		{
+			const auto it = Types.find(typeId);
+			if (it == Types.end())
+				return 0;
+
+			const SpirvType& type = it->second;
+
+			switch (type.Op)
+			{
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return type.Width / 8;
+			case OpTypeVector:
+			case OpTypeMatrix:
+				return TypeSize(type.ElementType) * type.Count;
+			case OpTypeArray:
+			{
+				uint32_t stride = TypeSize(type.ElementType);
+
+				if (const auto decoration = Decorations.find(typeId); decoration != Decorations.end() && decoration->second.ArrayStride)
+					stride = decoration->second.ArrayStride;
+
+				const auto length = Constants.find(type.Count);
+				return length != Constants.end() ? stride * length->second : 0;
+			}
+			case OpTypeStruct:
+			{
+				uint32_t size = 0;
+				const auto decoration = Decorations.find(typeId);
+
+				for (uint32_t member = 0; member < type.Members.size(); member++)
+				{
+					uint32_t offset = 0;
+					if (decoration != Decorations.end())
+					{
+						if (const auto memberOffset = decoration->second.MemberOffsets.find(member); memberOffset != decoration->second.MemberOffsets.end())
+							offset = memberOffset->second;
+					}
+
+					size = std::max(size, offset + TypeSize(type.Members[member]));
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+	};
+
+	bool ToDescriptorType(const SpirvModule& module, uint32_t typeId, uint32_t storageClass, VkDescriptorType& outType)
+	{
+		const auto it = module.Types.find(typeId);
+		if (it == module.Types.end())
+			return false;
+
+		const SpirvType& type = it->second;
+
+		switch (type.Op)
+		{
+		case OpTypeSampler:
+			outType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case OpTypeSampledImage:
+		{
+			const auto image = module.Types.find(type.ElementType);
+			outType = image != module.Types.end() && image->second.Dim == ImageDimBuffer
+				? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
+				: VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		}
+		case OpTypeImage:
+			if (type.Dim == ImageDimBuffer)
+				outType = type.Sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				outType = type.Sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			return true;
+		case OpTypeStruct:
+		{
+			const auto decoration = module.Decorations.find(typeId);
+			const bool bufferBlock = decoration != module.Decorations.end() && decoration->second.BufferBlock;
+
+			if (storageClass == StorageClassStorageBuffer || bufferBlock)
+				outType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			else if (storageClass == StorageClassUniform)
+				outType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			else
+				return false;
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+}
+
+bool ShaderReflection::Reflect(std::span<const uint32_t> code)
+{
+	Bindings.clear();
+	BoolSpecializationIds.clear();
+	PushConstantSize = 0;
+	WorkgroupSize = { 1, 1, 1 };
+
+	if (code.size() < SpirvHeaderWordCount || code[0] != SpirvMagicNumber)
+	{
+		std::println("Invalid SPIR-V module");
+		return false;
+	}
+
+	SpirvModule module;
+
+	size_t offset = SpirvHeaderWordCount;
+	while (offset < code.size())
+	{
+		const uint16_t wordCount = static_cast<uint16_t>(code[offset] >> 16);
+		const uint16_t opcode = static_cast<uint16_t>(code[offset] & 0xFFFF);
+
+		if (wordCount == 0 || offset + wordCount > code.size())
+		{
+			std::println("Malformed SPIR-V instruction at word {}", offset);
+			return false;
+		}
+
+		const std::span<const uint32_t> words = code.subspan(offset, wordCount);
+
+		switch (opcode)
+		{
+		case OpExecutionMode:
+			if (wordCount >= 6 && words[2] == ExecutionModeLocalSize)
+				WorkgroupSize = { words[3], words[4], words[5] };
+			break;
+		case OpTypeBool:
+			module.Types[words[1]] = { .Op = opcode };
+			break;
+		case OpTypeInt:
+		case OpTypeFloat:
+			module.Types[words[1]] = { .Op = opcode, .Width = words[2] };
+			break;
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeArray:
+			module.Types[words[1]] = { .Op = opcode, .ElementType = words[2], .Count = words[3] };
+			break;
+		case OpTypeRuntimeArray:
+		case OpTypeSampledImage:
+			module.Types[words[1]] = { .Op = opcode, .ElementType = words[2] };
+			break;
+		case OpTypeImage:
+			module.Types[words[1]] = { .Op = opcode, .ElementType = words[2], .Dim = words[3], .Sampled = words[7] };
+			break;
+		case OpTypeSampler:
+			module.Types[words[1]] = { .Op = opcode };
+			break;
+		case OpTypeStruct:
+			module.Types[words[1]] = { .Op = opcode, .Members = std::vector<uint32_t>(words.begin() + 2, words.end()) };
+			break;
+		case OpTypePointer:
+			module.Types[words[1]] = { .Op = opcode, .ElementType = words[3], .StorageClass = words[2] };
+			break;
+		case OpConstant:
+			module.Constants[words[2]] = words[3];
+			break;
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+			module.BoolSpecConstants.push_back(words[2]);
+			break;
+		case OpVariable:
+			module.Variables.push_back({ words[2], words[1], words[3] });
+			break;
+		case OpDecorate:
+		{
+			SpirvDecorations& decoration = module.Decorations[words[1]];
+			if (words[2] == DecorationBinding)
+				decoration.Binding = words[3];
+			else if (words[2] == DecorationDescriptorSet)
+				decoration.Set = words[3];
+			else if (words[2] == DecorationArrayStride)
+				decoration.ArrayStride = words[3];
+			else if (words[2] == DecorationBufferBlock)
+				decoration.BufferBlock = true;
+			else if (words[2] == DecorationSpecId)
+				decoration.SpecId = words[3];
+			break;
+		}
+		case OpMemberDecorate:
+			if (words[3] == DecorationOffset)
+				module.Decorations[words[1]].MemberOffsets[words[2]] = words[4];
+			break;
+		default:
+			break;
+		}
+
+		offset += wordCount;
+	}
+
+	for (const SpirvVariable& variable : module.Variables)
+	{
+		const auto pointer = module.Types.find(variable.PointerType);
+		if (pointer == module.Types.end())
+			continue;
+
+		uint32_t typeId = pointer->second.ElementType;
+
+		if (variable.StorageClass == StorageClassPushConstant)
+		{
+			PushConstantSize = std::max(PushConstantSize, module.TypeSize(typeId));
+			continue;
+		}
+
+		if (variable.StorageClass != StorageClassUniformConstant &&
+			variable.StorageClass != StorageClassUniform &&
+			variable.StorageClass != StorageClassStorageBuffer)
+			continue;
+
+		const auto decoration = module.Decorations.find(variable.Id);
+		if (decoration == module.Decorations.end() || decoration->second.Binding == UINT32_MAX)
+			continue;
+
+		if (decoration->second.Set != 0)
+		{
+			std::println("Descriptor set {} is not supported, binding {} ignored", decoration->second.Set, decoration->second.Binding);
+			continue;
+		}
+
+		uint32_t descriptorCount = 1;
+		while (module.Types.contains(typeId))
+		{
+			const SpirvType& type = module.Types.at(typeId);
+
+			if (type.Op == OpTypeArray)
+			{
+				descriptorCount *= module.Constants.contains(type.Count) ? module.Constants.at(type.Count) : 1;
+			}
+			else if (type.Op == OpTypeRuntimeArray)
+			{
+				std::println("Runtime descriptor array at binding {} reflected as a single descriptor", decoration->second.Binding);
+			}
+			else
+			{
+				break;
+			}
+
+			typeId = type.ElementType;
+		}
+
+		VkDescriptorType descriptorType;
+		if (!ToDescriptorType(module, typeId, variable.StorageClass, descriptorType))
+		{
+			std::println("Unsupported resource type at binding {}", decoration->second.Binding);
+			continue;
+		}
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = decoration->second.Binding;
+		binding.descriptorType = descriptorType;
+		binding.descriptorCount = descriptorCount;
+		binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		Bindings.push_back(binding);
+	}
+
+	std::ranges::sort(Bindings, {}, &VkDescriptorSetLayoutBinding::binding);
+
+	for (const uint32_t constantId : module.BoolSpecConstants)
+	{
+		const auto decoration = module.Decorations.find(constantId);
+		if (decoration != module.Decorations.end() && decoration->second.SpecId != UINT32_MAX)
+			BoolSpecializationIds.push_back(decoration->second.SpecId);
+	}
+
+	std::ranges::sort(BoolSpecializationIds);
+
+	return true;
+}
+
+const VkDescriptorSetLayoutBinding* ShaderReflection::FindBinding(uint32_t binding) const
+{
+	const auto it = std::ranges::find(Bindings, binding, &VkDescriptorSetLayoutBinding::binding);
+	return it != Bindings.end() ? &*it : nullptr;
+}
+
+size_t ShaderReflection::LayoutHash() const
+{
+	size_t hash = Bindings.size();
+
+	const auto combine = [&hash](size_t value) -> void
+	{
+		hash ^= std::hash<size_t>{}(value) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	};
+
+	for (const auto& binding : Bindings)
+	{
+		combine(binding.binding);
+		combine(binding.descriptorType);
+		combine(binding.descriptorCount);
+		combine(binding.stageFlags);
+	}
+
+	return hash;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct ShaderReflection
+{
+	std::vector<VkDescriptorSetLayoutBinding> Bindings;
+	uint32_t PushConstantSize = 0;
+	std::array<uint32_t, 3> WorkgroupSize = { 1, 1, 1 };
+	// constant_id of every bool specialization constant, bit i of a pipeline variant sets BoolSpecializationIds[i]
+	std::vector<uint32_t> BoolSpecializationIds;
+
+	[[nodiscard]] bool Reflect(std::span<const uint32_t> code);
+	[[nodiscard]] const VkDescriptorSetLayoutBinding* FindBinding(uint32_t binding) const;
+	[[nodiscard]] size_t LayoutHash() const;
+};
@@ -0,0 +1,515 @@
+#include "TraceDevice.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <print>
+
+#include "ComputeShader.h"
+#include "../TileOrder.h"
+
+bool TraceDevice::Init(VkInstance instance, const vkb::PhysicalDevice& physicalDevice, const std::filesystem::path& shaderPath)
+{
+	m_Name = physicalDevice.name;
+	m_ShaderPath = shaderPath;
+
+	auto deviceResult = vkb::DeviceBuilder(physicalDevice).build();
+
+	if (!deviceResult)
+	{
+		std::println("Failed to create a trace device on {}: {}", m_Name, deviceResult.error().message());
+		return false;
+	}
+
+	const vkb::Device vkbDevice = deviceResult.value();
+	m_Device = vkbDevice.device;
+
+	// Same choice as the engine's compute queue, a family apart from graphics if there is one
+	if (const auto computeFamily = vkbDevice.get_queue_index(vkb::QueueType::compute))
+	{
+		m_Queue = vkbDevice.get_queue(vkb::QueueType::compute).value();
+		m_QueueFamily = computeFamily.value();
+	}
+	else
+	{
+		m_Queue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
+		m_QueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+	}
+
+	m_Graph.Init(m_QueueFamily);
+	m_DescriptorCache.Init(m_Device);
+
+	VmaAllocatorCreateInfo allocatorCreateInfo{};
+	allocatorCreateInfo.physicalDevice = physicalDevice.physical_device;
+	allocatorCreateInfo.device = m_Device;
+	allocatorCreateInfo.instance = instance;
+
+	if (vmaCreateAllocator(&allocatorCreateInfo, &m_Allocator) != VK_SUCCESS)
+	{
+		std::println("Failed to create the allocator of {}", m_Name);
+		return false;
+	}
+
+	VkCommandPoolCreateInfo commandPoolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolInfo.queueFamilyIndex = m_QueueFamily;
+	vkCreateCommandPool(m_Device, &commandPoolInfo, nullptr, &m_CommandPool);
+
+	VkCommandBufferAllocateInfo cmdAllocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	cmdAllocInfo.commandPool = m_CommandPool;
+	cmdAllocInfo.commandBufferCount = 1;
+	cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	vkAllocateCommandBuffers(m_Device, &cmdAllocInfo, &m_CommandBuffer);
+
+	VkSemaphoreTypeCreateInfo timelineCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	semaphoreInfo.pNext = &timelineCreateInfo;
+	vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Timeline);
+
+	m_UniformBuffer = CreateBuffer(sizeof(UniformBufferData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_SpherePositionBuffer, sizeof(glm::vec3), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_SphereRadiusBuffer, sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_SphereMaterialIndexBuffer, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_MaterialBuffer, sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	m_PlaceholderImage = CreateStorageImage({ 1, 1 }, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT);
+
+	if (m_UniformBuffer.Buffer == VK_NULL_HANDLE || m_PlaceholderImage.Image == VK_NULL_HANDLE || !BuildShader())
+		return false;
+
+	// Never written, GENERAL only has to match the descriptor
+	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_CommandBuffer, &bi);
+
+	m_Graph.Reset();
+	const FrameResource placeholder = m_Graph.ImportImage(m_PlaceholderImage.Image, 1, true);
+	m_Graph.AddPass(true, { { placeholder, ResourceUsage::COMPUTE_STORAGE_WRITE } });
+	m_Graph.MarkOutput(placeholder);
+	m_Graph.Execute({ &m_CommandBuffer, 1 });
+
+	vkEndCommandBuffer(m_CommandBuffer);
+
+	VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfo.commandBuffer = m_CommandBuffer;
+
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_Timeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = ++m_TimelineValue;
+
+	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	vkQueueSubmit2(m_Queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(m_Queue);
+
+	std::println("Tracing on {}", m_Name);
+	return true;
+}
+
+void TraceDevice::Cleanup()
+{
+	if (m_Device == VK_NULL_HANDLE)
+		return;
+
+	vkDeviceWaitIdle(m_Device);
+
+	if (m_Shader.DescriptorSet != VK_NULL_HANDLE)
+		m_Shader.Destroy(m_Device);
+
+	if (m_Allocator != VK_NULL_HANDLE)
+	{
+		for (AllocatedBuffer* buffer : { &m_UniformBuffer, &m_SpherePositionBuffer, &m_SphereRadiusBuffer, &m_SphereMaterialIndexBuffer,
+			&m_MaterialBuffer, &m_ReadbackBuffer })
+		{
+			vmaDestroyBuffer(m_Allocator, buffer->Buffer, buffer->Allocation);
+		}
+
+		DestroyImage(m_AccumulationImage);
+		DestroyImage(m_PlaceholderImage);
+		vmaDestroyAllocator(m_Allocator);
+	}
+
+	m_DescriptorCache.Cleanup();
+
+	vkDestroySemaphore(m_Device, m_Timeline, nullptr);
+	vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+	vkDestroyDevice(m_Device, nullptr);
+	m_Device = VK_NULL_HANDLE;
+}
+
+void TraceDevice::UploadScene(std::span<const glm::vec3> positions, std::span<const float> radii, std::span<const uint32_t> materialIndices,
+	std::span<const Material> materials)
+{
+	const VkDeviceSize sphereCapacity = std::max<size_t>(positions.size(), 1);
+	const VkDeviceSize materialCapacity = std::max<size_t>(materials.size(), 1);
+
+	GrowBuffer(m_SpherePositionBuffer, sphereCapacity * sizeof(glm::vec3), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_SphereRadiusBuffer, sphereCapacity * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_SphereMaterialIndexBuffer, sphereCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	GrowBuffer(m_MaterialBuffer, materialCapacity * sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	WriteBuffer(m_SpherePositionBuffer, std::as_bytes(positions));
+	WriteBuffer(m_SphereRadiusBuffer, std::as_bytes(radii));
+	WriteBuffer(m_SphereMaterialIndexBuffer, std::as_bytes(materialIndices));
+	WriteBuffer(m_MaterialBuffer, std::as_bytes(materials));
+
+	m_SphereCount = static_cast<uint32_t>(positions.size());
+	m_MaterialCount = static_cast<uint32_t>(materials.size());
+
+	BindSceneBuffers();
+	UpdateDescriptorSets();
+}
+
+void TraceDevice::UploadUniforms(const UniformBufferData& uniforms)
+{
+	WriteBuffer(m_UniformBuffer, std::as_bytes(std::span(&uniforms, 1)));
+}
+
+void TraceDevice::ReloadShader()
+{
+	m_ShaderReloadPending = true;
+
+	// Without a job nothing on the device uses the pipeline or its set
+	if (!IsBusy())
+		ApplyShaderReload();
+}
+
+void TraceDevice::ApplyShaderReload()
+{
+	m_ShaderReloadPending = false;
+
+	// A shader that doesn't build leaves the previous one in place
+	const Shader previous = m_Shader;
+
+	if (!BuildShader())
+		return;
+
+	previous.Destroy(m_Device);
+	m_DescriptorCache.Free(previous.DescriptorSet);
+}
+
+bool TraceDevice::BuildShader()
+{
+	Shader shader;
+
+	if (!ComputeShader::Build(m_Device, m_DescriptorCache, m_ShaderPath, shader))
+		return false;
+
+	shader.DescriptorSet = m_DescriptorCache.Allocate(shader.DescriptorLayout);
+
+	if (shader.DescriptorSet == VK_NULL_HANDLE)
+	{
+		std::println("Failed to allocate compute descriptor set");
+		shader.Destroy(m_Device);
+		return false;
+	}
+
+	m_Shader = shader;
+	m_Shader.Bind(0, DescriptorBinding(m_PlaceholderImage));
+	m_Shader.Bind(2, DescriptorBinding(m_UniformBuffer));
+	m_Shader.Bind(1, DescriptorBinding(m_AccumulationImage));
+	BindSceneBuffers();
+	UpdateDescriptorSets();
+
+	return true;
+}
+
+void TraceDevice::BindSceneBuffers()
+{
+	const VkDeviceSize sphereCount = std::max(m_SphereCount, 1u);
+	const VkDeviceSize materialCount = std::max(m_MaterialCount, 1u);
+
+	m_Shader.Bind(3, DescriptorBinding(m_SpherePositionBuffer, sphereCount * sizeof(glm::vec3)));
+	m_Shader.Bind(4, DescriptorBinding(m_MaterialBuffer, materialCount * sizeof(Material)));
+	m_Shader.Bind(5, DescriptorBinding(m_SphereRadiusBuffer, sphereCount * sizeof(float)));
+	m_Shader.Bind(6, DescriptorBinding(m_SphereMaterialIndexBuffer, sphereCount * sizeof(uint32_t)));
+}
+
+void TraceDevice::UpdateDescriptorSets() const
+{
+	// The accumulation is only created once the first job sizes it
+	if (m_AccumulationImage.Image != VK_NULL_HANDLE)
+		ComputeShader::UpdateDescriptorSets(m_Device, m_Shader);
+}
+
+bool TraceDevice::UpdateAccumulationImage(glm::uvec2 renderExtent)
+{
+	if (renderExtent == m_AccumulationExtent)
+		return true;
+
+	m_Graph.ForgetImage(m_AccumulationImage.Image);
+	DestroyImage(m_AccumulationImage);
+	m_AccumulationExtent = { 0, 0 };
+
+	m_AccumulationImage = CreateStorageImage(renderExtent, VK_FORMAT_R32G32B32A32_SFLOAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+	if (m_AccumulationImage.Image == VK_NULL_HANDLE)
+		return false;
+
+	m_AccumulationExtent = renderExtent;
+	m_Shader.Bind(1, DescriptorBinding(m_AccumulationImage));
+	UpdateDescriptorSets();
+
+	return true;
+}
+
+bool TraceDevice::Submit(const TraceJob& job, glm::uvec2 renderExtent)
+{
+	if (m_Job || m_Lost)
+	{
+		std::println("{} can't take a job while it is busy or lost", m_Name);
+		return false;
+	}
+
+	if (glm::any(glm::greaterThan(job.Region.Offset + job.Region.Extent, renderExtent)) || job.Samples == 0)
+	{
+		std::println("Trace job outside the {}x{} render extent", renderExtent.x, renderExtent.y);
+		return false;
+	}
+
+	if (!UpdateAccumulationImage(renderExtent))
+		return false;
+
+	const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(job.Region.Extent.x) * job.Region.Extent.y * sizeof(glm::vec4);
+	GrowBuffer(m_ReadbackBuffer, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+	if (m_ReadbackBuffer.Buffer == VK_NULL_HANDLE)
+		return false;
+
+	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(m_CommandBuffer, 0);
+	vkBeginCommandBuffer(m_CommandBuffer, &bi);
+
+	// Every job starts from zero, the sums of the previous one were read back already
+	m_Graph.Reset();
+	const FrameResource accumulationImage = m_Graph.ImportImage(m_AccumulationImage.Image, 1, true);
+
+	m_Graph.AddPass(true, { { accumulationImage, ResourceUsage::CLEAR } },
+		[this](VkCommandBuffer cmd) -> void
+		{
+			const VkClearColorValue clearColor = { { 0.f, 0.f, 0.f, 0.f } };
+			const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			vkCmdClearColorImage(cmd, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+		});
+
+	std::vector<TraceTile> tiles = TileOrder::BuildSpiral(job.Region.Extent, s_TileSize, glm::vec2(0.5f));
+
+	for (TraceTile& tile : tiles)
+		tile.Offset += job.Region.Offset;
+
+	for (uint32_t sample = 0; sample < job.Samples; sample++)
+	{
+		for (const TraceTile& tile : tiles)
+		{
+			m_Graph.AddPass(true, { { accumulationImage, ResourceUsage::COMPUTE_STORAGE_READ_WRITE } },
+				[this, tile, seed = job.Seed](VkCommandBuffer cmd) -> void
+				{
+					RayTrace(cmd, tile, seed);
+				});
+		}
+	}
+
+	m_Graph.AddPass(true, { { accumulationImage, ResourceUsage::TRANSFER_READ } },
+		[this, region = job.Region](VkCommandBuffer cmd) -> void
+		{
+			VkBufferImageCopy copy = {};
+			copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			copy.imageOffset = { static_cast<int32_t>(region.Offset.x), static_cast<int32_t>(region.Offset.y), 0 };
+			copy.imageExtent = { region.Extent.x, region.Extent.y, 1 };
+			vkCmdCopyImageToBuffer(cmd, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ReadbackBuffer.Buffer, 1, &copy);
+
+			// The timeline signal alone doesn't make the copy visible to the host
+			VkMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+			VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			dependencyInfo.memoryBarrierCount = 1;
+			dependencyInfo.pMemoryBarriers = &barrier;
+			vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+		});
+
+	m_Graph.Execute({ &m_CommandBuffer, 1 });
+	vkEndCommandBuffer(m_CommandBuffer);
+
+	VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfo.commandBuffer = m_CommandBuffer;
+
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_Timeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = ++m_TimelineValue;
+
+	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	if (const VkResult result = vkQueueSubmit2(m_Queue, 1, &submitInfo, VK_NULL_HANDLE); result != VK_SUCCESS)
+	{
+		std::println("Failed to submit to {}: {}", m_Name, static_cast<int>(result));
+		m_Lost = result == VK_ERROR_DEVICE_LOST;
+		return false;
+	}
+
+	m_Job = job;
+	return true;
+}
+
+std::optional<AccumulationData> TraceDevice::ConsumeResult()
+{
+	if (!m_Job)
+		return std::nullopt;
+
+	uint64_t completedValue = 0;
+
+	if (const VkResult result = vkGetSemaphoreCounterValue(m_Device, m_Timeline, &completedValue); result != VK_SUCCESS)
+	{
+		std::println("{} stopped responding: {}", m_Name, static_cast<int>(result));
+		m_Lost = true;
+		m_Job.reset();
+		return std::nullopt;
+	}
+
+	if (completedValue < m_TimelineValue)
+		return std::nullopt;
+
+	AccumulationData data;
+	data.Extent = m_Job->Region.Extent;
+	data.Sums.resize(static_cast<size_t>(data.Extent.x) * data.Extent.y);
+
+	void* mapped;
+	vmaMapMemory(m_Allocator, m_ReadbackBuffer.Allocation, &mapped);
+	vmaInvalidateAllocation(m_Allocator, m_ReadbackBuffer.Allocation, 0, VK_WHOLE_SIZE);
+	std::memcpy(data.Sums.data(), mapped, data.Sums.size() * sizeof(glm::vec4));
+	vmaUnmapMemory(m_Allocator, m_ReadbackBuffer.Allocation);
+
+	m_Job.reset();
+
+	if (m_ShaderReloadPending)
+		ApplyShaderReload();
+
+	return data;
+}
+
+void TraceDevice::RayTrace(VkCommandBuffer cmd, const TraceTile& tile, uint32_t seed) const
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Shader.GetPipeline());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_Shader.PipelineLayout, 0, 1, &m_Shader.DescriptorSet, 0, nullptr);
+
+	const RayTracingConstants constants = { tile.Offset, 0, seed };
+	vkCmdPushConstants(cmd, m_Shader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	const glm::uvec3 groupCount = m_Shader.GetGroupCount(tile.Extent.x, tile.Extent.y);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
+}
+
+AllocatedBuffer TraceDevice::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) const
+{
+	AllocatedBuffer buffer = {};
+
+	VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = memoryUsage;
+
+	if (vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo, &buffer.Buffer, &buffer.Allocation, nullptr) != VK_SUCCESS)
+	{
+		std::println("Failed to create buffer on {}", m_Name);
+		return {};
+	}
+
+	vmaGetAllocationInfo(m_Allocator, buffer.Allocation, &buffer.Info);
+	return buffer;
+}
+
+AllocatedImage TraceDevice::CreateStorageImage(glm::uvec2 extent, VkFormat format, VkImageUsageFlags usage) const
+{
+	AllocatedImage image = {};
+	image.ImageFormat = format;
+	image.ImageExtent = { extent.x, extent.y, 1 };
+
+	VkImageCreateInfo imageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = image.ImageExtent;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	if (const VkResult result = vmaCreateImage(m_Allocator, &imageInfo, &allocInfo, &image.Image, &image.Allocation, nullptr); result != VK_SUCCESS)
+	{
+		std::println("Failed to create vulkan image on {}: {}", m_Name, static_cast<int>(result));
+		return {};
+	}
+
+	VkImageViewCreateInfo viewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = image.Image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (const VkResult result = vkCreateImageView(m_Device, &viewInfo, nullptr, &image.ImageView); result != VK_SUCCESS)
+	{
+		std::println("Failed to create image view on {}: {}", m_Name, static_cast<int>(result));
+		vmaDestroyImage(m_Allocator, image.Image, image.Allocation);
+		return {};
+	}
+
+	return image;
+}
+
+void TraceDevice::DestroyImage(AllocatedImage& image) const
+{
+	if (image.Image == VK_NULL_HANDLE)
+		return;
+
+	vkDestroyImageView(m_Device, image.ImageView, nullptr);
+	vmaDestroyImage(m_Allocator, image.Image, image.Allocation);
+	image = {};
+}
+
+void TraceDevice::GrowBuffer(AllocatedBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) const
+{
+	if (buffer.Buffer != VK_NULL_HANDLE && buffer.Info.size >= size)
+		return;
+
+	vmaDestroyBuffer(m_Allocator, buffer.Buffer, buffer.Allocation);
+	buffer = CreateBuffer(std::bit_ceil(size), usage, memoryUsage);
+}
+
+void TraceDevice::WriteBuffer(const AllocatedBuffer& buffer, std::span<const std::byte> bytes) const
+{
+	if (bytes.empty())
+		return;
+
+	void* data;
+	vmaMapMemory(m_Allocator, buffer.Allocation, &data);
+	std::memcpy(data, bytes.data(), bytes.size());
+	vmaFlushAllocation(m_Allocator, buffer.Allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(m_Allocator, buffer.Allocation);
+}
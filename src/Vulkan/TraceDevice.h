@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+
+#include <vk_mem_alloc.h>
+#include <glm.hpp>
+
+#include "VkBootstrap.h"
+#include "VulkanTypes.h"
+#include "DescriptorCache.h"
+#include "FrameGraph.h"
+
+// Samples of a region of the render extent, accumulated from zero with a seed of their own
+struct TraceJob
+{
+	TraceTile Region;
+	uint32_t Samples;
+	uint32_t Seed;
+};
+
+// Another GPU that only runs ray_tracing.comp for the engine, without swapchain, UI or post processing. It keeps its own
+// copy of the scene and its own accumulation, the sums of every job are read back for the engine to add to its accumulation.
+// A job is recorded into a single submission, nothing is shared with the engine's device apart from the instance.
+class TraceDevice
+{
+public:
+	TraceDevice() = default;
+	TraceDevice(const TraceDevice&) = delete;
+	TraceDevice& operator=(const TraceDevice&) = delete;
+
+	// The shader is loaded from the compiled SPIR-V the engine builds, it has to be the same as the engine's
+	[[nodiscard]] bool Init(VkInstance instance, const vkb::PhysicalDevice& physicalDevice, const std::filesystem::path& shaderPath);
+	void Cleanup();
+
+	// Scene and uniforms can only change between jobs, the job in flight keeps reading what was there when it was submitted
+	void UploadScene(std::span<const glm::vec3> positions, std::span<const float> radii, std::span<const uint32_t> materialIndices,
+		std::span<const Material> materials);
+	void UploadUniforms(const UniformBufferData& uniforms);
+	// Rebuilds the pipeline from the compiled shader, e.g. after the engine recompiled it. With a job in flight the
+	// rebuild waits until ConsumeResult returns its sums, nothing blocks on the device.
+	void ReloadShader();
+
+	// The render extent sizes the accumulation, the region has to lie inside it
+	[[nodiscard]] bool Submit(const TraceJob& job, glm::uvec2 renderExtent);
+	[[nodiscard]] bool IsBusy() const { return m_Job.has_value(); }
+	// Sums of the finished job in row order of its region, empty while it is still tracing
+	[[nodiscard]] std::optional<AccumulationData> ConsumeResult();
+	// The device stopped responding, its job won't finish
+	[[nodiscard]] bool IsLost() const { return m_Lost; }
+
+	[[nodiscard]] const std::string& GetName() const { return m_Name; }
+private:
+	[[nodiscard]] AllocatedBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) const;
+	[[nodiscard]] AllocatedImage CreateStorageImage(glm::uvec2 extent, VkFormat format, VkImageUsageFlags usage) const;
+	void DestroyImage(AllocatedImage& image) const;
+	void GrowBuffer(AllocatedBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) const;
+	void WriteBuffer(const AllocatedBuffer& buffer, std::span<const std::byte> bytes) const;
+
+	[[nodiscard]] bool BuildShader();
+	void ApplyShaderReload();
+	void BindSceneBuffers();
+	void UpdateDescriptorSets() const;
+	// Recreates the accumulation for a new render extent, the device is idle between jobs
+	[[nodiscard]] bool UpdateAccumulationImage(glm::uvec2 renderExtent);
+	void RayTrace(VkCommandBuffer cmd, const TraceTile& tile, uint32_t seed) const;
+private:
+	std::string m_Name;
+	std::filesystem::path m_ShaderPath;
+
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkQueue m_Queue = VK_NULL_HANDLE;
+	uint32_t m_QueueFamily = 0;
+	VmaAllocator m_Allocator = VK_NULL_HANDLE;
+	DescriptorCache m_DescriptorCache;
+	FrameGraph m_Graph;
+
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+	VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+	VkSemaphore m_Timeline = VK_NULL_HANDLE;
+	uint64_t m_TimelineValue = 0;
+
+	Shader m_Shader = {};
+
+	AllocatedBuffer m_UniformBuffer = {};
+	AllocatedBuffer m_SpherePositionBuffer = {};
+	AllocatedBuffer m_SphereRadiusBuffer = {};
+	AllocatedBuffer m_SphereMaterialIndexBuffer = {};
+	AllocatedBuffer m_MaterialBuffer = {};
+	uint32_t m_SphereCount = 0;
+	uint32_t m_MaterialCount = 0;
+
+	AllocatedImage m_AccumulationImage = {};
+	glm::uvec2 m_AccumulationExtent = { 0, 0 };
+	// Bound to the HDR image binding, accumulation never writes it
+	AllocatedImage m_PlaceholderImage = {};
+	AllocatedBuffer m_ReadbackBuffer = {};
+
+	std::optional<TraceJob> m_Job;
+	bool m_Lost = false;
+	bool m_ShaderReloadPending = false;
+
+	// Short dispatches like the engine's tiles, a whole job at a high bounce count in one dispatch can hit the device timeout
+	static constexpr uint32_t s_TileSize = 256;
+};
@@ -0,0 +1,319 @@
+#include "UploadManager.h"
+
+#include <cstring>
+#include <print>
+
+void UploadManager::Init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamily, uint32_t dstQueueFamily,
+	VkPipelineStageFlags2 dstStage)
+{
+	m_Device = device;
+	m_Allocator = allocator;
+	m_Queue = queue;
+	m_QueueFamily = queueFamily;
+	m_DstQueueFamily = dstQueueFamily;
+	m_DstStage = dstStage;
+
+	VkCommandPoolCreateInfo commandPoolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolInfo.queueFamilyIndex = m_QueueFamily;
+
+	vkCreateCommandPool(m_Device, &commandPoolInfo, nullptr, &m_CommandPool);
+
+	VkSemaphoreTypeCreateInfo timelineCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	semaphoreCreateInfo.pNext = &timelineCreateInfo;
+
+	vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &m_Timeline);
+
+	void* ringData = nullptr;
+	m_Ring = CreateStagingBuffer(s_RingSize, &ringData);
+	m_RingData = static_cast<std::byte*>(ringData);
+}
+
+void UploadManager::Cleanup()
+{
+	Wait(m_SubmittedValue);
+
+	if (m_Recording.CommandBuffer != VK_NULL_HANDLE)
+	{
+		vkEndCommandBuffer(m_Recording.CommandBuffer);
+		ReleaseBatch(m_Recording);
+	}
+
+	vmaDestroyBuffer(m_Allocator, m_Ring.Buffer, m_Ring.Allocation);
+	vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+	vkDestroySemaphore(m_Device, m_Timeline, nullptr);
+}
+
+std::optional<uint64_t> UploadManager::UploadImage(const AllocatedImage& image, std::span<const std::byte> data)
+{
+	VkBuffer stagingBuffer = m_Ring.Buffer;
+	VkDeviceSize stagingOffset = 0;
+
+	if (const std::optional<VkDeviceSize> ringOffset = AllocateRing(data.size()))
+	{
+		stagingOffset = *ringOffset;
+		std::memcpy(m_RingData + stagingOffset, data.data(), data.size());
+		vmaFlushAllocation(m_Allocator, m_Ring.Allocation, stagingOffset, data.size());
+	}
+	else
+	{
+		void* mapped = nullptr;
+		const AllocatedBuffer dedicated = CreateStagingBuffer(data.size(), &mapped);
+
+		if (dedicated.Buffer == VK_NULL_HANDLE)
+		{
+			std::println("Failed to stage an upload of {} bytes", data.size());
+			return std::nullopt;
+		}
+
+		std::memcpy(mapped, data.data(), data.size());
+		vmaFlushAllocation(m_Allocator, dedicated.Allocation, 0, data.size());
+
+		stagingBuffer = dedicated.Buffer;
+		m_Recording.DedicatedBuffers.push_back(dedicated);
+	}
+
+	const VkCommandBuffer cmd = GetBatchCommandBuffer();
+	const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	VkImageMemoryBarrier2 toTransfer{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	toTransfer.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	toTransfer.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	toTransfer.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.image = image.Image;
+	toTransfer.subresourceRange = range;
+
+	VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &toTransfer;
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+	VkBufferImageCopy bufferImageCopy = {};
+	bufferImageCopy.bufferOffset = stagingOffset;
+	bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	bufferImageCopy.imageSubresource.layerCount = 1;
+	bufferImageCopy.imageExtent = image.ImageExtent;
+
+	vkCmdCopyBufferToImage(cmd, stagingBuffer, image.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+
+	const bool transfer = m_QueueFamily != m_DstQueueFamily;
+
+	// Nothing on this queue waits for the release, the consumer's semaphore wait orders it before the acquire
+	VkImageMemoryBarrier2 release{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+	release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	release.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+	release.dstAccessMask = VK_ACCESS_2_NONE;
+	release.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	release.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	release.srcQueueFamilyIndex = transfer ? m_QueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	release.dstQueueFamilyIndex = transfer ? m_DstQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	release.image = image.Image;
+	release.subresourceRange = range;
+
+	dependencyInfo.pImageMemoryBarriers = &release;
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+	const uint64_t value = m_SubmittedValue + 1;
+
+	if (transfer)
+	{
+		// The acquire repeats the layouts and families of the release and chains to the consumer's semaphore wait
+		VkImageMemoryBarrier2 acquire = release;
+		acquire.srcStageMask = m_DstStage;
+		acquire.srcAccessMask = VK_ACCESS_2_NONE;
+		acquire.dstStageMask = m_DstStage;
+		acquire.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+
+		m_PendingAcquires.push_back({ value, acquire });
+	}
+
+	return value;
+}
+
+void UploadManager::Submit()
+{
+	if (m_Recording.CommandBuffer == VK_NULL_HANDLE)
+		return;
+
+	vkEndCommandBuffer(m_Recording.CommandBuffer);
+
+	m_Recording.Value = ++m_SubmittedValue;
+
+	VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfo.commandBuffer = m_Recording.CommandBuffer;
+
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_Timeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = m_Recording.Value;
+
+	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	vkQueueSubmit2(m_Queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+	m_InFlight.push_back(std::move(m_Recording));
+	m_Recording = {};
+}
+
+void UploadManager::Update()
+{
+	vkGetSemaphoreCounterValue(m_Device, m_Timeline, &m_CompletedValue);
+	Reclaim();
+}
+
+void UploadManager::Wait(uint64_t value)
+{
+	if (value > m_SubmittedValue)
+		Submit();
+
+	VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_Timeline;
+	waitInfo.pValues = &value;
+
+	vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX);
+	Update();
+}
+
+uint64_t UploadManager::RecordAcquires(VkCommandBuffer cmd)
+{
+	std::vector<VkImageMemoryBarrier2> barriers;
+
+	std::erase_if(m_PendingAcquires, [this, &barriers](const PendingAcquire& pending) -> bool
+		{
+			if (!IsComplete(pending.Value))
+				return false;
+
+			barriers.push_back(pending.Barrier);
+			return true;
+		});
+
+	if (!barriers.empty())
+	{
+		VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size());
+		dependencyInfo.pImageMemoryBarriers = barriers.data();
+		vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+	}
+
+	// Already reached, the wait only establishes the dependency on everything the consumer may use by now
+	return m_CompletedValue;
+}
+
+void UploadManager::ForgetImage(VkImage image)
+{
+	std::erase_if(m_PendingAcquires, [image](const PendingAcquire& pending) -> bool
+		{
+			return pending.Barrier.image == image;
+		});
+}
+
+VkCommandBuffer UploadManager::GetBatchCommandBuffer()
+{
+	if (m_Recording.CommandBuffer != VK_NULL_HANDLE)
+		return m_Recording.CommandBuffer;
+
+	VkCommandBufferAllocateInfo cmdAllocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	cmdAllocInfo.commandPool = m_CommandPool;
+	cmdAllocInfo.commandBufferCount = 1;
+	cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+	vkAllocateCommandBuffers(m_Device, &cmdAllocInfo, &m_Recording.CommandBuffer);
+
+	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_Recording.CommandBuffer, &bi);
+
+	return m_Recording.CommandBuffer;
+}
+
+std::optional<VkDeviceSize> UploadManager::AllocateRing(VkDeviceSize size)
+{
+	if (size > s_RingSize)
+		return std::nullopt;
+
+	while (true)
+	{
+		// Starting over at the front keeps large uploads from wrapping needlessly
+		if (m_RingUsed == 0)
+			m_RingHead = 0;
+
+		const VkDeviceSize aligned = (m_RingHead + s_CopyAlignment - 1) / s_CopyAlignment * s_CopyAlignment;
+		const bool wrap = aligned + size > s_RingSize;
+		const VkDeviceSize offset = wrap ? 0 : aligned;
+		// The ring is freed in submission order, so the bytes skipped before the allocation count towards it
+		const VkDeviceSize consumed = wrap ? s_RingSize - m_RingHead + size : aligned - m_RingHead + size;
+
+		if (consumed <= s_RingSize - m_RingUsed)
+		{
+			m_RingHead = (offset + size) % s_RingSize;
+			m_RingUsed += consumed;
+			m_Recording.RingBytes += consumed;
+			return offset;
+		}
+
+		// Only bulk loads outrunning the GPU get here, the oldest batch is the first to free space
+		if (m_InFlight.empty())
+			Submit();
+
+		// Nothing recorded holds ring space either, the upload gets a staging buffer of its own
+		if (m_InFlight.empty())
+			return std::nullopt;
+
+		Wait(m_InFlight.front().Value);
+	}
+}
+
+AllocatedBuffer UploadManager::CreateStagingBuffer(VkDeviceSize size, void** outMapped) const
+{
+	AllocatedBuffer buffer = {};
+
+	VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	if (vmaCreateBuffer(m_Allocator, &bufferInfo, &allocInfo, &buffer.Buffer, &buffer.Allocation, &buffer.Info) != VK_SUCCESS)
+	{
+		std::println("Failed to create staging buffer");
+		return {};
+	}
+
+	*outMapped = buffer.Info.pMappedData;
+	return buffer;
+}
+
+void UploadManager::Reclaim()
+{
+	while (!m_InFlight.empty() && IsComplete(m_InFlight.front().Value))
+	{
+		ReleaseBatch(m_InFlight.front());
+		m_InFlight.pop_front();
+	}
+}
+
+void UploadManager::ReleaseBatch(Batch& batch)
+{
+	m_RingUsed -= batch.RingBytes;
+	vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &batch.CommandBuffer);
+
+	for (const AllocatedBuffer& buffer : batch.DedicatedBuffers)
+		vmaDestroyBuffer(m_Allocator, buffer.Buffer, buffer.Allocation);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include "VulkanTypes.h"
+
+// Streams data into device local resources through a persistently mapped staging ring on its own queue.
+// Everything recorded between two Submit calls goes out as one batch that signals the next value of the upload timeline,
+// its ring space and command buffer are reclaimed once the timeline passes that value.
+// Uploaded images change to the consumer's queue family on the way, the consumer acquires them with RecordAcquires.
+class UploadManager
+{
+public:
+	UploadManager() = default;
+
+	// dstStage is where the consumer first reads uploads, its semaphore wait on the upload timeline must include it
+	void Init(VkDevice device, VmaAllocator allocator, VkQueue queue, uint32_t queueFamily, uint32_t dstQueueFamily, VkPipelineStageFlags2 dstStage);
+	void Cleanup();
+
+	// Copies data into the ring and records the copy into the single mip of the image, which ends up in GENERAL.
+	// Returns the upload timeline value the image is ready at, empty if no staging memory was left and nothing was recorded.
+	[[nodiscard]] std::optional<uint64_t> UploadImage(const AllocatedImage& image, std::span<const std::byte> data);
+	// Sends every upload recorded since the last call in one submission
+	void Submit();
+	// Reclaims the batches the GPU is done with, called once per frame
+	void Update();
+	// Blocks until the value is reached, only for uploads that are needed before anything can render
+	void Wait(uint64_t value);
+
+	[[nodiscard]] bool IsComplete(uint64_t value) const { return value <= m_CompletedValue; }
+	// Acquires the images of completed batches on the consumer queue, the submission of cmd has to wait for the returned value
+	[[nodiscard]] uint64_t RecordAcquires(VkCommandBuffer cmd);
+	// The image is destroyed before the consumer used it, its acquire must not be recorded anymore
+	void ForgetImage(VkImage image);
+	[[nodiscard]] VkSemaphore GetTimeline() const { return m_Timeline; }
+private:
+	struct Batch
+	{
+		uint64_t Value = 0;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		// Ring bytes the batch holds, including the padding skipped at the end of the ring when it wrapped
+		VkDeviceSize RingBytes = 0;
+		// Uploads larger than the whole ring get a staging buffer of their own
+		std::vector<AllocatedBuffer> DedicatedBuffers;
+	};
+
+	struct PendingAcquire
+	{
+		uint64_t Value;
+		VkImageMemoryBarrier2 Barrier;
+	};
+
+	[[nodiscard]] VkCommandBuffer GetBatchCommandBuffer();
+	// Waits for the oldest batches while the ring is full, empty if the size can never fit or nothing frees space
+	[[nodiscard]] std::optional<VkDeviceSize> AllocateRing(VkDeviceSize size);
+	[[nodiscard]] AllocatedBuffer CreateStagingBuffer(VkDeviceSize size, void** outMapped) const;
+	void Reclaim();
+	void ReleaseBatch(Batch& batch);
+private:
+	static constexpr VkDeviceSize s_RingSize = 64ull << 20;
+	// Covers the texel size and optimalBufferCopyOffsetAlignment of every format uploaded so far
+	static constexpr VkDeviceSize s_CopyAlignment = 256;
+
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VmaAllocator m_Allocator = VK_NULL_HANDLE;
+	VkQueue m_Queue = VK_NULL_HANDLE;
+	uint32_t m_QueueFamily = 0;
+	uint32_t m_DstQueueFamily = 0;
+	VkPipelineStageFlags2 m_DstStage = VK_PIPELINE_STAGE_2_NONE;
+
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+	VkSemaphore m_Timeline = VK_NULL_HANDLE;
+	uint64_t m_SubmittedValue = 0;
+	uint64_t m_CompletedValue = 0;
+
+	AllocatedBuffer m_Ring = {};
+	std::byte* m_RingData = nullptr;
+	VkDeviceSize m_RingHead = 0;
+	VkDeviceSize m_RingUsed = 0;
+
+	Batch m_Recording;
+	std::deque<Batch> m_InFlight;
+	std::vector<PendingAcquire> m_PendingAcquires;
+};
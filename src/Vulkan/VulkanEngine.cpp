@@ -3,58 +3,14 @@
 #define VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <optional>
+#include <string_view>
 
 namespace
 {
-	void TransitionImage(const VkCommandBuffer cmd, const VkImage image, const VkImageLayout currentLayout, const VkImageLayout newLayout, uint32_t mipLevels)
-	{
-		VkImageMemoryBarrier2 imageBarrier{ .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-		imageBarrier.pNext = nullptr;
-
-		imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-		imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-		imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-		imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
-
-		imageBarrier.oldLayout = currentLayout;
-		imageBarrier.newLayout = newLayout;
-
-		VkImageSubresourceRange subImage{};
-		subImage.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		subImage.baseMipLevel = 0;
-		subImage.levelCount = mipLevels;
-		subImage.baseArrayLayer = 0;
-		subImage.layerCount = 1;
-		imageBarrier.subresourceRange = subImage;
-		imageBarrier.image = image;
-
-		VkDependencyInfo depInfo{};
-		depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-		depInfo.imageMemoryBarrierCount = 1;
-		depInfo.pImageMemoryBarriers = &imageBarrier;
-
-		vkCmdPipelineBarrier2(cmd, &depInfo);
-	}
-
-	std::vector<uint32_t> LoadShaderFromFile(const std::filesystem::path& path)
-	{
-		std::ifstream file(path, std::ios::binary | std::ios::ate);
-
-		auto const fileSize = static_cast<size_t>(file.tellg());
-		file.seekg(0, std::ios::beg);
-
-		if (fileSize % 4 != 0) 
-		{
-			std::println("Shader file size not a multiple of 4: {} bytes", fileSize);
-			return {};
-		}
-
-		std::vector<uint32_t> buffer(fileSize / 4);
-		file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
-
-		return buffer;
-	}
-
 	ShaderName StringToShaderName(const std::string& string)
 	{
 		if (string == "ray_tracing" || string == "ray_tracing.comp")
@@ -63,10 +19,12 @@ namespace
 			return ShaderName::DOWNSAMPLE;
 		if (string == "upsample" || string == "upsample.comp")
 			return ShaderName::UPSAMPLE;
-		if(string == "tone_mapping" || string == "tone_mapping.comp")
-			return ShaderName::TONE_MAPPING;
-		if (string == "color_grading" || string == "color_grading.comp")
-			return ShaderName::COLOR_GRADING;
+		if (string == "post_process" || string == "post_process.comp")
+			return ShaderName::POST_PROCESS;
+		if (string == "upscale" || string == "upscale.comp")
+			return ShaderName::UPSCALE;
+		if (string == "accumulation_merge" || string == "accumulation_merge.comp")
+			return ShaderName::ACCUMULATION_MERGE;
 
 		return ShaderName::NONE;
 	}
@@ -83,26 +41,81 @@ namespace
 		return std::system(command.c_str()) == 0;
 	}
 
-	std::vector<float> LoadLUT(const std::filesystem::path& pathToLut)
+	VkFormat ToVkFormat(CubeLutFormat format)
 	{
-		constexpr uint32_t lutSize = 33;
-		constexpr size_t rowCount = lutSize * lutSize * lutSize;
+		return format == CubeLutFormat::A2B10G10R10_UNORM ? VK_FORMAT_A2B10G10R10_UNORM_PACK32 : VK_FORMAT_R16G16B16A16_SFLOAT;
+	}
 
-		std::ifstream file(pathToLut);
-		assert(file.is_open());
+	// Features the ray tracer needs, trace devices are picked with the same requirements as the engine's device
+	vkb::PhysicalDeviceSelector CreateDeviceSelector(const vkb::Instance& instance)
+	{
+		VkPhysicalDeviceVulkan13Features features{};
+
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		features.dynamicRendering = true;
+		features.synchronization2 = true;
+
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.bufferDeviceAddress = true;
+		features12.descriptorIndexing = true;
+		features12.descriptorBindingPartiallyBound = true;
+		features12.descriptorBindingSampledImageUpdateAfterBind = true;
+		features12.descriptorBindingUpdateUnusedWhilePending = true;
+		features12.hostQueryReset = true;
+		features12.timelineSemaphore = true;
+
+		VkPhysicalDeviceFeatures features10{};
+		features10.shaderSampledImageArrayDynamicIndexing = true;
+		features10.shaderStorageImageArrayDynamicIndexing = true;
+		features10.shaderStorageImageExtendedFormats = true;
+
+		vkb::PhysicalDeviceSelector selector(instance);
+		selector.set_minimum_version(1, 3)
+			.set_required_features(features10)
+			.set_required_features_13(features)
+			.set_required_features_12(features12);
 
-		std::vector<float> lutData(rowCount * 4);
-		std::string line;
+		return selector;
+	}
 
-		for (size_t row = 0; row < rowCount; row++)
+	bool LifetimesOverlap(const TransientImageInfo& a, const TransientImageInfo& b)
+	{
+		return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+	}
+
+	// First fit by lifetime, an image only has to stay clear of the images that are alive during one of its passes.
+	// Returns the offset of each image and the size and alignment of the whole block in outCombined.
+	std::vector<VkDeviceSize> PackByLifetime(std::span<const TransientImageInfo> infos, std::span<const VkMemoryRequirements> requirements,
+		VkMemoryRequirements& outCombined)
+	{
+		std::vector<VkDeviceSize> offsets(infos.size(), 0);
+		outCombined.size = 0;
+		outCombined.alignment = 1;
+
+		for (size_t i = 0; i < infos.size(); i++)
 		{
-			std::getline(file, line);
-			std::istringstream iss(line);
-			iss >> lutData[row * 4] >> lutData[row * 4 + 1] >> lutData[row * 4 + 2];
-			lutData[row * 4 + 3] = 1.0f;
+			VkDeviceSize offset = 0;
+
+			// The offset only grows, moving past one image can land inside another so the scan starts over
+			for (size_t placed = 0; placed < i; placed++)
+			{
+				const bool intersects = offset < offsets[placed] + requirements[placed].size && offsets[placed] < offset + requirements[i].size;
+
+				if (LifetimesOverlap(infos[i], infos[placed]) && intersects)
+				{
+					offset = offsets[placed] + requirements[placed].size;
+					offset = (offset + requirements[i].alignment - 1) / requirements[i].alignment * requirements[i].alignment;
+					placed = static_cast<size_t>(-1);
+				}
+			}
+
+			offsets[i] = offset;
+			outCombined.size = std::max(outCombined.size, offset + requirements[i].size);
+			outCombined.alignment = std::max(outCombined.alignment, requirements[i].alignment);
 		}
 
-		return lutData;
+		return offsets;
 	}
 }
 
@@ -110,7 +123,7 @@ void VulkanEngine::Init(const std::shared_ptr<GLFWwindow>& window)
 {
 
 	m_Window = window;
-	m_FileWatcher = FileWatcher(m_PathToShaders, std::chrono::milliseconds(1500));
+	m_FileWatcher = std::make_unique<FileWatcher>(m_PathToShaders, std::chrono::milliseconds(1500));
 
 	InitDevices();
 	InitSwapchain();
@@ -125,7 +138,7 @@ void VulkanEngine::Init(const std::shared_ptr<GLFWwindow>& window)
 
 	m_FileWatcherFuture = std::async(std::launch::async, [this]() -> void
 		{
-			MonitorShaders();
+			m_FileWatcher->Start();
 		});
 
 	IsInitialized = true;
@@ -133,61 +146,128 @@ void VulkanEngine::Init(const std::shared_ptr<GLFWwindow>& window)
 
 void VulkanEngine::ReloadShaders()
 {
-	if (!m_ShadersNeedReload)
-		return;
+	std::lock_guard lock(m_ShaderReloadMutex);
 
-	for (const auto& shaderName : m_ChangedShaderFiles)
+	for (const auto& file : std::filesystem::directory_iterator(m_PathToShaders))
 	{
-		const std::filesystem::path shaderPath = m_PathToShaders / shaderName;
+		if (file.path().extension().string() != ".comp")
+			continue;
+
+		std::string fileName = file.path().filename().string();
+
+		if (std::ranges::find(m_ChangedShaderFiles, fileName) == m_ChangedShaderFiles.end())
+			m_ChangedShaderFiles.emplace_back(std::move(fileName));
+	}
+
+	m_ShadersNeedReload = true;
+}
+
+void VulkanEngine::UpdateShaderReload()
+{
+	if (m_ShaderReloadFuture.valid())
+	{
+		if (m_ShaderReloadFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		std::vector<std::pair<ShaderName, Shader>> reloadedShaders = m_ShaderReloadFuture.get();
 
-		if (CompileShader(shaderPath))
+		for (auto& [shaderName, shader] : reloadedShaders)
 		{
-			const std::string& fileName = shaderPath.stem().string();
-			std::println("Compiled to: compiled/{}.spv", fileName);
+			SwapShader(shaderName, shader);
+		}
 
-			vkQueueWaitIdle(m_GraphicsQueue);
+		if (!reloadedShaders.empty())
+			m_ShadersReloaded = true;
+	}
 
-			const ShaderName shaderName = StringToShaderName(fileName);
+	if (!m_ShadersNeedReload.exchange(false))
+		return;
 
-			if (shaderName == ShaderName::NONE)
+	std::vector<std::string> changedFiles;
+	{
+		std::lock_guard lock(m_ShaderReloadMutex);
+		changedFiles.swap(m_ChangedShaderFiles);
+	}
+
+	m_ShaderReloadFuture = std::async(std::launch::async, [this, changedFiles = std::move(changedFiles)]() -> std::vector<std::pair<ShaderName, Shader>>
+		{
+			std::vector<std::pair<ShaderName, Shader>> reloadedShaders;
+
+			for (const auto& fileName : changedFiles)
 			{
-				std::println("Unknown shader name: {}", fileName);
-				return;
+				const std::filesystem::path shaderPath = m_PathToShaders / fileName;
+				const ShaderName shaderName = StringToShaderName(shaderPath.filename().string());
+
+				if (shaderName == ShaderName::NONE)
+				{
+					std::println("Unknown shader name: {}", fileName);
+					continue;
+				}
+
+				if (!CompileShader(shaderPath))
+				{
+					std::println("Compilation failed : {}", fileName);
+					continue;
+				}
+
+				const std::string compiledName = std::format("{}.spv", shaderPath.stem().string());
+				std::println("Compiled to: compiled/{}", compiledName);
+
+				Shader shader;
+				if (BuildShader(m_PathToShaders / "compiled" / compiledName, shader))
+				{
+					reloadedShaders.emplace_back(shaderName, std::move(shader));
+				}
 			}
 
-			const Shader& shader = m_Shaders.at(shaderName);
-			const auto& bindings = shader.Bindings;
+			return reloadedShaders;
+		});
+}
 
-			shader.Destroy(m_Device);
+void VulkanEngine::SwapShader(const ShaderName shaderName, Shader& newShader)
+{
+	Shader& currentShader = m_Shaders.at(shaderName);
 
-			if (shaderName == ShaderName::DOWNSAMPLE)
-			{
-				VkPushConstantRange brightPassPushConstant = {};
-				brightPassPushConstant.offset = 0;
-				brightPassPushConstant.size = sizeof(int);
-				brightPassPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	newShader.DescriptorSet = m_DescriptorCache.Allocate(newShader.DescriptorLayout);
 
-				CreateShader(shaderName, bindings, &brightPassPushConstant, std::format("{}/{}.spv", (m_PathToShaders / "compiled").string(), fileName));
-			}
-			else
-			{
-				CreateShader(shaderName, bindings, nullptr, std::format("{}/{}.spv", (m_PathToShaders / "compiled").string(), fileName));
-			}
+	if (newShader.DescriptorSet == VK_NULL_HANDLE)
+	{
+		std::println("Failed to allocate compute descriptor set");
+		newShader.Destroy(m_Device);
+		return;
+	}
 
-			UpdateDescriptorSets(m_Shaders[shaderName]);
-		}
-		else
+	newShader.Bindings = currentShader.Bindings;
+	newShader.ArrayBindings = currentShader.ArrayBindings;
+	UpdateDescriptorSets(newShader);
+
+	const bool layoutChanged = newShader.DescriptorLayout != currentShader.DescriptorLayout;
+
+	// Frames still in flight may reference the old pipeline
+	Retire([this, retiredShader = currentShader]() mutable -> void
 		{
-			std::println("Compilation failed : {}", m_PathToShaders.stem().string());
-		}
-	}
+			DestroyShader(retiredShader);
+		});
+
+	currentShader = newShader;
 
-	m_ShadersNeedReload = false;
+	if (layoutChanged && (shaderName == ShaderName::DOWNSAMPLE || shaderName == ShaderName::UPSAMPLE))
+	{
+		Retire([this, upsampleSets = std::move(m_UpsampleDescriptorSets)]() -> void
+			{
+				for (const auto descSet : upsampleSets)
+					m_DescriptorCache.Free(descSet);
+			});
+
+		m_UpsampleDescriptorSets.clear();
+
+		InitBloomDescriptors();
+	}
 }
 
 void VulkanEngine::MonitorShaders()
 {
-	m_FileWatcher.Start([this](const std::string& pathToWatch, FileStatus status) -> void 
+	m_FileWatcher->PollEvents([this](const std::string& pathToWatch, FileStatus status) -> void 
 		{
 			if (!std::filesystem::is_regular_file(std::filesystem::path(pathToWatch)) && status != FileStatus::ERASED)
 				return;
@@ -208,7 +288,11 @@ void VulkanEngine::MonitorShaders()
 			case FileStatus::MODIFIED:
 			{
 				std::println("Shader modified: {}", fileName);
-				m_ChangedShaderFiles.emplace_back(fileName);
+
+				std::lock_guard lock(m_ShaderReloadMutex);
+				if (std::ranges::find(m_ChangedShaderFiles, fileName) == m_ChangedShaderFiles.end())
+					m_ChangedShaderFiles.emplace_back(fileName);
+
 				m_ShadersNeedReload = true;
 				break;
 			}
@@ -221,28 +305,46 @@ void VulkanEngine::MonitorShaders()
 
 void VulkanEngine::OnWindowResize(const uint32_t width, const uint32_t height)
 {
-	vkDeviceWaitIdle(m_Device);
 	RecreateSwapchain(width, height);
 }
 
 void VulkanEngine::SetViewportSize(const uint32_t width, const uint32_t height)
 {
-	if (width == m_ViewportWidth && height == m_ViewportHeight)
+	if (glm::uvec2(width, height) == m_RequestedViewport)
 		return;
 
-	m_ViewportWidth = width;
-	m_ViewportHeight = height;
+	m_RequestedViewport = { width, height };
+	m_ResizeRequestTime = std::chrono::steady_clock::now();
 
-	RecreateRenderTargets();
-	ResetAccumulation();
+	// Anything that fits the current targets applies right away, growing waits for UpdateRenderTargets
+	ApplyViewportSize();
+}
+
+ImVec2 VulkanEngine::GetRenderTextureUV() const
+{
+	return { static_cast<float>(m_ViewportWidth) / static_cast<float>(m_TargetCapacity.x),
+		static_cast<float>(m_ViewportHeight) / static_cast<float>(m_TargetCapacity.y) };
 }
 
+glm::uvec2 VulkanEngine::GetRenderExtent() const
+{
+	const glm::vec2 viewport = { m_ViewportWidth, m_ViewportHeight };
+	return glm::min(glm::uvec2(glm::ceil(viewport * m_RenderScale)), glm::uvec2(m_ViewportWidth, m_ViewportHeight));
+}
 
-void VulkanEngine::DrawFrame(const bool dispatchCompute)
+void VulkanEngine::DrawFrame(const bool dispatchCompute, const std::span<const TraceTile> tiles, const bool present)
 {
 	FrameData& frame = GetCurrentFrame();
-	vkWaitForFences(m_Device, 1, &frame.RenderFence, VK_TRUE, UINT64_MAX);
-	vkDeviceWaitIdle(m_Device);
+	WaitForTimeline(m_GraphicsTimeline, frame.GraphicsTimelineValue);
+
+	// Only the compute work recorded into this frame's command buffers and staging has to be done, the other frame keeps
+	// tracing. Buffers it reads are written through the staged writes, descriptors are renewed or only updated after a full wait.
+	WaitForTimeline(m_ComputeTimeline, frame.ComputeTimelineValue);
+	m_Uploads.Update();
+
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(m_Device, m_GraphicsTimeline, &completedValue);
+	m_RetireQueue.Flush(completedValue);
 
 	int width = 0, height = 0;
 
@@ -251,8 +353,29 @@ void VulkanEngine::DrawFrame(const bool dispatchCompute)
 	if(width == 0 || height == 0)
 		return;
 
-	frame.DataDeletionQueue.Flush();
-	vkResetFences(m_Device, 1, &frame.RenderFence);
+	MonitorShaders();
+	UpdateShaderReload();
+	UpdateLuts();
+	UpdateRenderTargets();
+
+	// Everything uploaded this frame goes out in one batch
+	m_Uploads.Submit();
+
+	if (!present)
+	{
+		if (dispatchCompute)
+		{
+			if (m_FrameNumber > m_Frames.size())
+				UpdateTimings();
+
+			SubmitCompute(frame, tiles, false);
+		}
+
+		SubmitGraphicsSignal(frame);
+		m_FrameNumber++;
+		ApplyViewportSize();
+		return;
+	}
 
 	uint32_t swapchainImageIndex = 0;
 	VkResult acquireResult = vkAcquireNextImageKHR(
@@ -294,99 +417,72 @@ void VulkanEngine::DrawFrame(const bool dispatchCompute)
 
 	vkResetCommandBuffer(cmd, 0);
 	vkBeginCommandBuffer(cmd, &bi);
-	vkCmdResetQueryPool(cmd, frame.TimestampQueryPool, 0, 2);
+
+	m_GraphicsGraph.Reset();
+
+	const FrameResource swapchainImage = m_GraphicsGraph.ImportImage(m_SwapchainImages[swapchainImageIndex], 1, true,
+		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+	FrameResource ldrImage;
 
 	if (dispatchCompute)
 	{
 		if (m_FrameNumber > m_Frames.size())
 			UpdateTimings();
 
-		if (m_FrameNumber > 0)
-		{
-			TransitionImage(cmd, m_HDRImage.Image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, m_MipLevels);
-			TransitionImage(cmd, m_LDRImage.Image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, 1);
-		}
-
-		uint32_t gx = (m_ViewportWidth + 15) / 16;
-		uint32_t gy = (m_ViewportHeight + 15) / 16;
-
-		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, frame.TimestampQueryPool, 0);
-		
-		RayTrace(cmd, gx, gy);
-
-		if (m_BloomEnabled)
-		{
-			Downsample(cmd, m_HDRImage.Image, m_ViewportWidth, m_ViewportHeight, m_MipLevels);
-			Upsample(cmd, m_HDRImage.Image, m_ViewportWidth, m_ViewportHeight, m_MipLevels);
-		}
-
-		if (m_ColorGradingEnabled)
-		{
-			ColorGrade(cmd, gx, gy);
-		}
-
-		ToneMap(cmd, gx, gy);
-
-		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, frame.TimestampQueryPool, 1);
-
-		TransitionImage(
-			cmd,
-			m_HDRImage.Image,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			m_MipLevels
-		);
+		SubmitCompute(frame, tiles, true);
 
-		TransitionImage(
-			cmd,
-			m_LDRImage.Image,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			1
-		);
+		ldrImage = m_GraphicsGraph.AcquireImage(m_LDRImage.Image, 1, m_ComputeQueueFamily, ResourceUsage::FRAGMENT_SAMPLED_READ,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+	}
+	else
+	{
+		ldrImage = m_GraphicsGraph.ImportImage(m_LDRImage.Image, 1);
 	}
 
-	TransitionImage(
-		cmd,
-		m_SwapchainImages[swapchainImageIndex],
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		1
-	);
+	// ImGui samples the display image even before anything is traced into it
+	m_GraphicsGraph.AddPass(true, { { ldrImage, ResourceUsage::FRAGMENT_SAMPLED_READ }, { swapchainImage, ResourceUsage::COLOR_ATTACHMENT } },
+		[this, swapchainImageIndex](VkCommandBuffer cmd) -> void
+		{
+			DrawImGui(cmd, m_SwapchainImageViews[swapchainImageIndex]);
+		});
 
-	DrawImGui(cmd, m_SwapchainImageViews[swapchainImageIndex]);
+	m_GraphicsGraph.AddPass(true, { { swapchainImage, ResourceUsage::PRESENT } });
+	m_GraphicsGraph.Execute({ &cmd, 1 });
 
-	TransitionImage(
-		cmd,
-		m_SwapchainImages[swapchainImageIndex],
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		1
-	);
 	vkEndCommandBuffer(cmd);
 
-	VkSemaphoreSubmitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
-	waitInfo.semaphore = frame.SwapchainSemaphore;
-	waitInfo.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
-	waitInfo.value = 0;
-
-	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
-	signalInfo.semaphore = frame.RenderSemaphore;
-	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
-	signalInfo.value = 0;
+	// Waiting for the last compute value even without new compute work makes every graphics value cover all earlier compute submissions
+	std::array<VkSemaphoreSubmitInfo, 2> waitInfos = {};
+	waitInfos[0] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	waitInfos[0].semaphore = frame.SwapchainSemaphore;
+	waitInfos[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	waitInfos[1] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	waitInfos[1].semaphore = m_ComputeTimeline;
+	waitInfos[1].stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	waitInfos[1].value = m_ComputeTimelineValue;
+
+	std::array<VkSemaphoreSubmitInfo, 2> signalInfos = {};
+	signalInfos[0] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfos[0].semaphore = frame.RenderSemaphore;
+	signalInfos[0].stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+	signalInfos[1] = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfos[1].semaphore = m_GraphicsTimeline;
+	signalInfos[1].stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+	signalInfos[1].value = ++m_GraphicsTimelineValue;
 
 	VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
 	cmdInfo.commandBuffer = cmd;
 
 	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
-	submitInfo.waitSemaphoreInfoCount = 1;
-	submitInfo.pWaitSemaphoreInfos = &waitInfo;
+	submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waitInfos.size());
+	submitInfo.pWaitSemaphoreInfos = waitInfos.data();
 	submitInfo.commandBufferInfoCount = 1;
 	submitInfo.pCommandBufferInfos = &cmdInfo;
-	submitInfo.signalSemaphoreInfoCount = 1;
-	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+	submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos.size());
+	submitInfo.pSignalSemaphoreInfos = signalInfos.data();
 
-	vkQueueSubmit2(m_GraphicsQueue, 1, &submitInfo, frame.RenderFence);
+	vkQueueSubmit2(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	frame.GraphicsTimelineValue = m_GraphicsTimelineValue;
 
 	VkPresentInfoKHR pinfo{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
 	pinfo.waitSemaphoreCount = 1;
@@ -398,6 +494,9 @@ void VulkanEngine::DrawFrame(const bool dispatchCompute)
 
 	m_FrameNumber++;
 
+	// Grown targets were created this frame, the new size applies from the next one on
+	ApplyViewportSize();
+
 	if (m_ShouldRecreateSwapchain)
 	{
 		int w = 0, h = 0;
@@ -407,64 +506,587 @@ void VulkanEngine::DrawFrame(const bool dispatchCompute)
 	}
 }
 
-void VulkanEngine::RecreateRenderTargets()
+void VulkanEngine::SubmitCompute(FrameData& frame, const std::span<const TraceTile> tiles, const bool display)
 {
-	vkDeviceWaitIdle(m_Device);
+	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	vkDestroyImageView(m_Device, m_LDRImage.ImageView, nullptr);
-	DestroyImage(m_LDRImage);
+	for (const VkCommandBuffer cmd : frame.ComputeCommandBuffers)
+	{
+		vkResetCommandBuffer(cmd, 0);
+		vkBeginCommandBuffer(cmd, &bi);
+	}
 
-	vkDestroyImageView(m_Device, m_HDRImage.ImageView, nullptr);
-	DestroyImage(m_HDRImage);
+	vkCmdResetQueryPool(frame.ComputeCommandBuffers[0], frame.TimestampQueryPool, 0, s_TimestampCount);
+	const uint64_t uploadValue = m_Uploads.RecordAcquires(frame.ComputeCommandBuffers[0]);
 
-	vkDestroyImageView(m_Device, m_AccumulationImage.ImageView, nullptr);
-	DestroyImage(m_AccumulationImage);
+	m_ComputeGraph.Reset();
+	AddComputePasses(frame.TimestampQueryPool, tiles, display);
+	RecordBufferWrites(frame, frame.ComputeCommandBuffers[0]);
+	m_ComputeGraph.Execute(frame.ComputeCommandBuffers);
+
+	frame.TracedPixels = 0;
+	for (const TraceTile& tile : tiles)
+		frame.TracedPixels += static_cast<uint64_t>(tile.Extent.x) * tile.Extent.y;
+
+	for (const VkCommandBuffer cmd : frame.ComputeCommandBuffers)
+		vkEndCommandBuffer(cmd);
+
+	std::array<VkCommandBufferSubmitInfo, 2> cmdInfos = {};
+	cmdInfos[0] = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfos[0].commandBuffer = frame.ComputeCommandBuffers[0];
+	cmdInfos[1] = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfos[1].commandBuffer = frame.ComputeCommandBuffers[1];
+
+	// Uploads the passes may read are done already, the wait only orders the ownership transfer
+	VkSemaphoreSubmitInfo uploadWaitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	uploadWaitInfo.semaphore = m_Uploads.GetTimeline();
+	uploadWaitInfo.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	uploadWaitInfo.value = uploadValue;
+
+	// Tracing starts right away and overlaps the previous frame's UI, only the display image writes wait for it
+	VkSemaphoreSubmitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	waitInfo.semaphore = m_GraphicsTimeline;
+	waitInfo.stageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	waitInfo.value = m_GraphicsTimelineValue;
 
-	for(auto view : m_MipmapImageViews)
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_ComputeTimeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = ++m_ComputeTimelineValue;
+
+	std::array<VkSubmitInfo2, 2> submitInfos = {};
+	submitInfos[0] = { VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfos[0].waitSemaphoreInfoCount = 1;
+	submitInfos[0].pWaitSemaphoreInfos = &uploadWaitInfo;
+	submitInfos[0].commandBufferInfoCount = 1;
+	submitInfos[0].pCommandBufferInfos = &cmdInfos[0];
+	submitInfos[1] = { VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfos[1].waitSemaphoreInfoCount = 1;
+	submitInfos[1].pWaitSemaphoreInfos = &waitInfo;
+	submitInfos[1].commandBufferInfoCount = 1;
+	submitInfos[1].pCommandBufferInfos = &cmdInfos[1];
+	submitInfos[1].signalSemaphoreInfoCount = 1;
+	submitInfos[1].pSignalSemaphoreInfos = &signalInfo;
+
+	vkQueueSubmit2(m_ComputeQueue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), VK_NULL_HANDLE);
+	frame.ComputeTimelineValue = m_ComputeTimelineValue;
+}
+
+void VulkanEngine::SubmitGraphicsSignal(FrameData& frame)
+{
+	// Retirement and the next compute submission key off the graphics timeline, so it keeps advancing without a UI
+	VkSemaphoreSubmitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	waitInfo.semaphore = m_ComputeTimeline;
+	waitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	waitInfo.value = m_ComputeTimelineValue;
+
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_GraphicsTimeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = ++m_GraphicsTimelineValue;
+
+	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfo.waitSemaphoreInfoCount = 1;
+	submitInfo.pWaitSemaphoreInfos = &waitInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	vkQueueSubmit2(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	frame.GraphicsTimelineValue = m_GraphicsTimelineValue;
+}
+
+void VulkanEngine::AddComputePasses(VkQueryPool timestampPool, const std::span<const TraceTile> tiles, const bool display)
+{
+	const glm::uvec2 renderExtent = GetRenderExtent();
+	const bool upscale = renderExtent != glm::uvec2(m_ViewportWidth, m_ViewportHeight);
+	const bool bloom = m_BloomEnabled && m_BloomMipLevels > 0;
+
+	// The HDR, scaled and bloom images are fully rewritten every frame, their old contents are discarded
+	const FrameResource hdrImage = m_ComputeGraph.ImportImage(m_HDRImage.Image, 1, true);
+	const FrameResource scaledImage = m_ComputeGraph.ImportImage(m_ScaledLDRImage.Image, 1, true);
+	// A readback requested together with a reset copies the old sums before they are cleared
+	const bool readBeforeClear = m_ReadbackRequested && !m_Readback && m_AccumulationNeedsClear;
+	const FrameResource accumulationImage = m_ComputeGraph.ImportImage(m_AccumulationImage.Image, 1, m_AccumulationNeedsClear && !readBeforeClear);
+	m_ComputeGraph.MarkOutput(accumulationImage);
+
+	// Written in the second command buffer after the previous UI is done with it. Discarding it needs no ownership transfer back.
+	const FrameResource ldrImage = m_ComputeGraph.ImportImage(m_LDRImage.Image, 1, true, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+	if (display)
+		m_ComputeGraph.ReleaseImage(ldrImage, m_GraphicsQueueFamily, ResourceUsage::FRAGMENT_SAMPLED_READ);
+
+	const auto writeTimestamp = [this, timestampPool](uint32_t query) -> void
 	{
-		vkDestroyImageView(m_Device, view, nullptr);
+		m_ComputeGraph.AddPass(true, {}, [timestampPool, query](VkCommandBuffer cmd) -> void
+			{
+				vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampPool, query);
+			});
+	};
+
+	writeTimestamp(0);
+
+	if (readBeforeClear)
+		AddReadbackPass(accumulationImage, renderExtent);
+
+	m_ComputeGraph.AddPass(m_AccumulationNeedsClear, { { accumulationImage, ResourceUsage::CLEAR } },
+		[this](VkCommandBuffer cmd) -> void
+		{
+			const VkClearColorValue clearColor = { { 0.f, 0.f, 0.f, 0.f } };
+			const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			vkCmdClearColorImage(cmd, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
+		});
+
+	m_AccumulationNeedsClear = false;
+
+	if (m_PendingRestore)
+		AddRestorePass(accumulationImage, renderExtent);
+
+	if (!m_PendingMerges.empty())
+		AddMergePasses(accumulationImage, renderExtent);
+
+	// Short dispatches per tile keep a frame preemptible, one whole image at a high bounce count can hit the device timeout
+	for (const TraceTile& tile : tiles)
+	{
+		const ResourceAccess access = m_AccumulationEnabled ?
+			ResourceAccess{ accumulationImage, ResourceUsage::COMPUTE_STORAGE_READ_WRITE } :
+			ResourceAccess{ hdrImage, ResourceUsage::COMPUTE_STORAGE_WRITE };
+
+		m_ComputeGraph.AddPass(true, { access },
+			[this, tile](VkCommandBuffer cmd) -> void
+			{
+				RayTrace(cmd, tile, false);
+			});
 	}
 
-	for (auto& descSet : m_DownsampleDescriptorSets)
+	if (m_ReadbackRequested && !m_Readback)
+		AddReadbackPass(accumulationImage, renderExtent);
+
+	// Accumulated tiles only add to the sums, the averages of the whole image are written once they are done
+	m_ComputeGraph.AddPass(m_AccumulationEnabled, { { accumulationImage, ResourceUsage::COMPUTE_STORAGE_READ }, { hdrImage, ResourceUsage::COMPUTE_STORAGE_WRITE } },
+		[this, renderExtent](VkCommandBuffer cmd) -> void
+		{
+			RayTrace(cmd, { glm::uvec2(0), renderExtent }, true);
+		});
+
+	writeTimestamp(1);
+
+	std::vector<ResourceAccess> postProcessAccesses =
+	{
+		{ hdrImage, ResourceUsage::COMPUTE_STORAGE_READ },
+		{ upscale ? scaledImage : ldrImage, ResourceUsage::COMPUTE_STORAGE_WRITE }
+	};
+
+	if (bloom)
 	{
-		vkFreeDescriptorSets(m_Device, m_MipmapsPool, 1, &descSet);
+		const FrameResource bloomImage = m_ComputeGraph.ImportImage(m_BloomImage.Image, m_BloomMipLevels, true);
+		const FrameResource bloomCounter = m_ComputeGraph.ImportBuffer(BloomCounterBuffer.Buffer);
+
+		m_ComputeGraph.AddPass(true, { { hdrImage, ResourceUsage::COMPUTE_SAMPLED_READ }, { bloomImage, ResourceUsage::COMPUTE_STORAGE_READ_WRITE },
+			{ bloomCounter, ResourceUsage::COMPUTE_STORAGE_READ_WRITE } },
+			[this, renderExtent](VkCommandBuffer cmd) -> void
+			{
+				Downsample(cmd, renderExtent.x, renderExtent.y);
+			});
+
+		m_ComputeGraph.AddPass(true, { { bloomImage, ResourceUsage::COMPUTE_SAMPLED_READ }, { bloomImage, ResourceUsage::COMPUTE_STORAGE_WRITE } },
+			[this, renderExtent](VkCommandBuffer cmd) -> void
+			{
+				const glm::uvec2 bloomExtent = glm::max(glm::uvec2(1), renderExtent / 2u);
+				Upsample(cmd, bloomExtent.x, bloomExtent.y, m_BloomMipLevels);
+			});
+
+		postProcessAccesses.push_back({ bloomImage, ResourceUsage::COMPUTE_SAMPLED_READ });
 	}
 
-	for (auto& descSet : m_UpsampleDescriptorSets)
+	writeTimestamp(2);
+
+	m_ComputeGraph.NextCommandBuffer();
+
+	// Bloom composite, LUT grading and tone mapping are fused into this one pass
+	m_ComputeGraph.AddPass(true, std::move(postProcessAccesses),
+		[this, renderExtent, bloom, upscale](VkCommandBuffer cmd) -> void
+		{
+			PostProcess(cmd, renderExtent.x, renderExtent.y, bloom, upscale);
+		});
+
+	writeTimestamp(3);
+
+	m_ComputeGraph.AddPass(upscale, { { scaledImage, ResourceUsage::COMPUTE_SAMPLED_READ }, { ldrImage, ResourceUsage::COMPUTE_STORAGE_WRITE } },
+		[this, renderExtent](VkCommandBuffer cmd) -> void
+		{
+			Upscale(cmd, renderExtent);
+		});
+
+	writeTimestamp(4);
+}
+
+void VulkanEngine::AddReadbackPass(FrameResource accumulationImage, glm::uvec2 extent)
+{
+	m_ReadbackRequested = false;
+
+	const VkDeviceSize size = static_cast<VkDeviceSize>(extent.x) * extent.y * sizeof(glm::vec4);
+	const AllocatedBuffer buffer = CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+	if (buffer.Buffer == VK_NULL_HANDLE)
+		return;
+
+	m_ComputeGraph.AddPass(true, { { accumulationImage, ResourceUsage::TRANSFER_READ } },
+		[this, buffer = buffer.Buffer, extent](VkCommandBuffer cmd) -> void
+		{
+			VkBufferImageCopy region = {};
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { extent.x, extent.y, 1 };
+			vkCmdCopyImageToBuffer(cmd, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+			// The timeline signal alone doesn't make the copy visible to the host
+			VkMemoryBarrier2 barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+			VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			dependencyInfo.memoryBarrierCount = 1;
+			dependencyInfo.pMemoryBarriers = &barrier;
+			vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+		});
+
+	// The pass goes into the next submission to the compute queue
+	m_Readback = AccumulationReadback{ buffer, extent, m_ComputeTimelineValue + 1 };
+}
+
+void VulkanEngine::AddRestorePass(FrameResource accumulationImage, glm::uvec2 extent)
+{
+	const AccumulationData data = std::move(*m_PendingRestore);
+	m_PendingRestore.reset();
+
+	if (data.Extent != extent || data.Sums.size() != static_cast<size_t>(extent.x) * extent.y)
 	{
-		vkFreeDescriptorSets(m_Device, m_MipmapsPool, 1, &descSet);
+		std::println("Accumulation of {}x{} doesn't match the render extent {}x{}", data.Extent.x, data.Extent.y, extent.x, extent.y);
+		return;
 	}
 
+	const std::span<const std::byte> bytes = std::as_bytes(std::span(data.Sums));
+	const AllocatedBuffer staging = CreateBuffer(bytes.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+	if (staging.Buffer == VK_NULL_HANDLE)
+		return;
+
+	void* mapped;
+	vmaMapMemory(m_Allocator, staging.Allocation, &mapped);
+	std::memcpy(mapped, bytes.data(), bytes.size());
+	vmaFlushAllocation(m_Allocator, staging.Allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(m_Allocator, staging.Allocation);
+
+	m_ComputeGraph.AddPass(true, { { accumulationImage, ResourceUsage::TRANSFER_WRITE } },
+		[this, buffer = staging.Buffer, extent](VkCommandBuffer cmd) -> void
+		{
+			VkBufferImageCopy region = {};
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { extent.x, extent.y, 1 };
+			vkCmdCopyBufferToImage(cmd, buffer, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		});
+
+	Retire([this, staging]() -> void
+		{
+			vmaDestroyBuffer(m_Allocator, staging.Buffer, staging.Allocation);
+		});
+}
+
+void VulkanEngine::AddMergePasses(FrameResource accumulationImage, glm::uvec2 extent)
+{
+	std::vector<PendingMerge> merges = std::move(m_PendingMerges);
+	m_PendingMerges.clear();
+
+	// Regions traced before the render extent changed don't belong to this accumulation
+	std::erase_if(merges, [extent](const PendingMerge& merge) -> bool
+		{
+			const bool fits = glm::all(glm::lessThanEqual(merge.Offset + merge.Data.Extent, extent)) &&
+				merge.Data.Sums.size() == static_cast<size_t>(merge.Data.Extent.x) * merge.Data.Extent.y;
+
+			if (!fits)
+				std::println("Merged region of {}x{} doesn't fit the render extent {}x{}", merge.Data.Extent.x, merge.Data.Extent.y, extent.x, extent.y);
+
+			return !fits;
+		});
+
+	size_t texelCount = 0;
+	for (const PendingMerge& merge : merges)
+		texelCount += merge.Data.Sums.size();
+
+	if (texelCount == 0)
+		return;
+
+	if (m_MergeBuffer.Info.size < texelCount * sizeof(glm::vec4))
+	{
+		// Rare, the buffer only grows with the largest band so far. The other frame may still merge from it.
+		WaitForTimeline(m_ComputeTimeline, m_ComputeTimelineValue);
+
+		Shader& mergeShader = m_Shaders.at(ShaderName::ACCUMULATION_MERGE);
+		GrowBuffer(m_MergeBuffer, texelCount * sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		mergeShader.Bind(1, DescriptorBinding(m_MergeBuffer));
+		UpdateDescriptorSets(mergeShader);
+	}
+
+	std::vector<std::byte> bytes;
+	bytes.reserve(texelCount * sizeof(glm::vec4));
+
+	uint32_t baseIndex = 0;
+
+	for (const PendingMerge& merge : merges)
+	{
+		const std::span<const std::byte> sums = std::as_bytes(std::span(merge.Data.Sums));
+		bytes.insert(bytes.end(), sums.begin(), sums.end());
+
+		const AccumulationMergeConstants constants = { merge.Offset, merge.Data.Extent, baseIndex };
+		baseIndex += static_cast<uint32_t>(merge.Data.Sums.size());
+
+		m_ComputeGraph.AddPass(true, { { accumulationImage, ResourceUsage::COMPUTE_STORAGE_READ_WRITE } },
+			[this, constants](VkCommandBuffer cmd) -> void
+			{
+				MergeAccumulationRegion(cmd, constants);
+			});
+	}
+
+	StageBufferWrite(m_MergeBuffer, bytes);
+}
+
+std::optional<AccumulationData> VulkanEngine::ConsumeAccumulationReadback()
+{
+	if (!m_Readback)
+		return std::nullopt;
+
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(m_Device, m_ComputeTimeline, &completedValue);
+
+	if (completedValue < m_Readback->ComputeValue)
+		return std::nullopt;
+
+	AccumulationData data;
+	data.Extent = m_Readback->Extent;
+	data.Sums.resize(static_cast<size_t>(data.Extent.x) * data.Extent.y);
+
+	void* mapped;
+	vmaMapMemory(m_Allocator, m_Readback->Buffer.Allocation, &mapped);
+	vmaInvalidateAllocation(m_Allocator, m_Readback->Buffer.Allocation, 0, VK_WHOLE_SIZE);
+	std::memcpy(data.Sums.data(), mapped, data.Sums.size() * sizeof(glm::vec4));
+	vmaUnmapMemory(m_Allocator, m_Readback->Buffer.Allocation);
+
+	vmaDestroyBuffer(m_Allocator, m_Readback->Buffer.Buffer, m_Readback->Buffer.Allocation);
+	m_Readback.reset();
+
+	return data;
+}
+
+std::optional<AccumulationData> VulkanEngine::ReadAccumulation()
+{
+	// A readback still in flight is older than the one recorded here
+	if (m_Readback)
+	{
+		WaitForTimeline(m_ComputeTimeline, m_Readback->ComputeValue);
+		[[maybe_unused]] const auto staleData = ConsumeAccumulationReadback();
+	}
+
+	if (m_AccumulationImage.Image == VK_NULL_HANDLE)
+		return std::nullopt;
+
+	// The frame's compute command buffers are free once its graphics submission, which waits for them, is done
+	FrameData& frame = GetCurrentFrame();
+	WaitForTimeline(m_GraphicsTimeline, frame.GraphicsTimelineValue);
+
+	const VkCommandBuffer cmd = frame.ComputeCommandBuffers[0];
+	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(cmd, 0);
+	vkBeginCommandBuffer(cmd, &bi);
+
+	m_ComputeGraph.Reset();
+	AddReadbackPass(m_ComputeGraph.ImportImage(m_AccumulationImage.Image, 1), GetRenderExtent());
+	m_ComputeGraph.Execute({ &cmd, 1 });
+
+	vkEndCommandBuffer(cmd);
+
+	VkCommandBufferSubmitInfo cmdInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+	cmdInfo.commandBuffer = cmd;
+
+	VkSemaphoreSubmitInfo signalInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+	signalInfo.semaphore = m_ComputeTimeline;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	signalInfo.value = ++m_ComputeTimelineValue;
+
+	VkSubmitInfo2 submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	vkQueueSubmit2(m_ComputeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	frame.ComputeTimelineValue = m_ComputeTimelineValue;
+	WaitForTimeline(m_ComputeTimeline, m_ComputeTimelineValue);
+
+	return ConsumeAccumulationReadback();
+}
+
+void VulkanEngine::UpdateRenderTargets()
+{
+	const bool grow = glm::any(glm::greaterThan(m_RequestedViewport, m_TargetCapacity));
+	const bool settled = std::chrono::steady_clock::now() - m_ResizeRequestTime >= s_ResizeDebounce;
+
+	if (!(grow && settled) && !m_RebuildRenderTargets)
+		return;
+
+	const glm::uvec2 requested = (m_RequestedViewport + s_TargetGranularity - 1u) / s_TargetGranularity * s_TargetGranularity;
+
+	// Bloom settings only change the per-frame targets, the accumulated samples stay. Growing is followed by a new
+	// viewport size that resets the accumulation anyway.
+	const bool keepAccumulation = !(grow && settled);
+
+	RetireRenderTargets(keepAccumulation);
+
+	if (!keepAccumulation)
+		m_TargetCapacity = glm::max(m_TargetCapacity, requested);
+
+	m_RebuildRenderTargets = false;
+
+	InitRenderTargets(keepAccumulation);
+
+	for (const ShaderName shaderName : { ShaderName::RAY_TRACING, ShaderName::POST_PROCESS, ShaderName::UPSCALE, ShaderName::DOWNSAMPLE, ShaderName::ACCUMULATION_MERGE })
+		RenewDescriptorSet(m_Shaders.at(shaderName));
+
+	InitBloomDescriptors();
+	BindRenderTargets();
+}
+
+void VulkanEngine::RetireRenderTargets(const bool keepAccumulation)
+{
+	std::vector<AllocatedImage> retired = { m_LDRImage, m_HDRImage, m_ScaledLDRImage, m_BloomImage };
+
+	if (!keepAccumulation)
+		retired.push_back(m_AccumulationImage);
+
+	// Frames still in flight may use the targets
+	Retire([this,
+		images = retired,
+		bloomViews = std::move(m_BloomMipViews),
+		upsampleSets = std::move(m_UpsampleDescriptorSets),
+		transientAllocation = m_TransientAllocation,
+		texture = m_RenderTextureData.GetTexID()]() mutable -> void
+		{
+			for (AllocatedImage& image : images)
+			{
+				vkDestroyImageView(m_Device, image.ImageView, nullptr);
+				DestroyImage(image);
+			}
+
+			for (const auto view : bloomViews)
+				vkDestroyImageView(m_Device, view, nullptr);
+
+			for (const auto descSet : upsampleSets)
+				m_DescriptorCache.Free(descSet);
+
+			vmaFreeMemory(m_Allocator, transientAllocation);
+
+			if (texture)
+				ImGui_ImplVulkan_RemoveTexture(reinterpret_cast<VkDescriptorSet>(texture));
+		});
+
+	for (const AllocatedImage& image : retired)
+	{
+		m_ComputeGraph.ForgetImage(image.Image);
+		m_GraphicsGraph.ForgetImage(image.Image);
+	}
+
+	m_LDRImage = {};
+
+	if (!keepAccumulation)
+		m_AccumulationImage = {};
+
+	m_HDRImage = {};
+	m_ScaledLDRImage = {};
+	m_BloomImage = {};
+	m_BloomMipViews.clear();
 	m_UpsampleDescriptorSets.clear();
-	m_DownsampleDescriptorSets.clear();
-	m_MipmapImageViews.clear();
+	m_BloomMipLevels = 0;
+	m_TransientAllocation = VK_NULL_HANDLE;
+}
 
-	InitRenderTargets();
-	InitMitmapsResources();
+void VulkanEngine::ApplyViewportSize()
+{
+	const glm::uvec2 viewport = glm::min(m_RequestedViewport, m_TargetCapacity);
+
+	if (viewport == glm::uvec2(m_ViewportWidth, m_ViewportHeight))
+		return;
+
+	m_ViewportWidth = viewport.x;
+	m_ViewportHeight = viewport.y;
+	m_ViewportResized = true;
+
+	ResetAccumulation();
+}
 
-	Shader& rtShader = m_Shaders[ShaderName::RAY_TRACING];
-	Shader& toneMappingShader = m_Shaders[ShaderName::TONE_MAPPING];
-	Shader& cgShader = m_Shaders[ShaderName::COLOR_GRADING];
+void VulkanEngine::RenewDescriptorSet(Shader& shader)
+{
+	const VkDescriptorSet descriptorSet = m_DescriptorCache.Allocate(shader.DescriptorLayout);
+
+	if (descriptorSet == VK_NULL_HANDLE)
+	{
+		std::println("Failed to allocate compute descriptor set");
+		return;
+	}
+
+	// Frames still in flight may have the old set bound
+	Retire([this, retiredSet = shader.DescriptorSet]() -> void
+		{
+			m_DescriptorCache.Free(retiredSet);
+		});
+
+	shader.DescriptorSet = descriptorSet;
+}
+
+void VulkanEngine::BindRenderTargets()
+{
+	Shader& rtShader = m_Shaders.at(ShaderName::RAY_TRACING);
+	Shader& postProcessShader = m_Shaders.at(ShaderName::POST_PROCESS);
+
+	rtShader.Bind(0, DescriptorBinding(m_HDRImage));
+	rtShader.Bind(1, DescriptorBinding(m_AccumulationImage));
 
-	rtShader.Bindings[0] = DescriptorBinding(m_HDRImage, m_RenderSampler);
-	rtShader.Bindings[1] = DescriptorBinding(m_AccumulationImage);
+	postProcessShader.Bind(1, DescriptorBinding(m_HDRImage));
+	postProcessShader.BindArrayElement(3, POST_PROCESS_OUTPUT_DISPLAY, DescriptorBinding(m_LDRImage));
+	postProcessShader.BindArrayElement(3, POST_PROCESS_OUTPUT_SCALED, DescriptorBinding(m_ScaledLDRImage));
 
-	toneMappingShader.Bindings[0] = DescriptorBinding(m_HDRImage);
-	toneMappingShader.Bindings[1] = DescriptorBinding(m_LDRImage);
+	Shader& upscaleShader = m_Shaders.at(ShaderName::UPSCALE);
+	upscaleShader.Bind(0, DescriptorBinding(m_ScaledLDRImage, m_RenderSampler));
+	upscaleShader.Bind(1, DescriptorBinding(m_LDRImage));
 
-	cgShader.Bindings[1] = DescriptorBinding(m_HDRImage);
+	Shader& mergeShader = m_Shaders.at(ShaderName::ACCUMULATION_MERGE);
+	mergeShader.Bind(0, DescriptorBinding(m_AccumulationImage));
+
+	// The bloom chain leaves every mip in GENERAL. Without a bloom image the bloom variant never runs.
+	if (!m_BloomMipViews.empty())
+	{
+		VkDescriptorImageInfo bloomInfo = {};
+		bloomInfo.imageView = m_BloomMipViews[0];
+		bloomInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		bloomInfo.sampler = m_RenderSampler;
+
+		postProcessShader.Bind(2, DescriptorBinding(bloomInfo));
+	}
 
 	UpdateDescriptorSets(rtShader);
-	UpdateDescriptorSets(toneMappingShader);
-	UpdateDescriptorSets(cgShader);
+	UpdateDescriptorSets(postProcessShader);
+	UpdateDescriptorSets(upscaleShader);
+	UpdateDescriptorSets(mergeShader);
 }
 
 void VulkanEngine::UpdateTimings()
 {
 	FrameData& frame = GetCurrentFrame();
-	std::array<uint64_t, 2> timestamps = {};
+	std::array<uint64_t, s_TimestampCount> timestamps = {};
 
-	VkResult result = vkGetQueryPoolResults(m_Device, frame.TimestampQueryPool, 0, 2,
+	VkResult result = vkGetQueryPoolResults(m_Device, frame.TimestampQueryPool, 0, s_TimestampCount,
 		sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
 		VK_QUERY_RESULT_64_BIT);
 
@@ -473,10 +1095,18 @@ void VulkanEngine::UpdateTimings()
 		VkPhysicalDeviceProperties props;
 		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &props);
 
-		uint64_t rayTracingElapsed = std::fabs(timestamps[1] - timestamps[0]);
-		float rayTracingMs = rayTracingElapsed * props.limits.timestampPeriod / 1000000.0f;
+		const auto elapsedMs = [&timestamps, &props](uint32_t from, uint32_t to) -> float
+		{
+			const uint64_t elapsed = timestamps[to] > timestamps[from] ? timestamps[to] - timestamps[from] : 0;
+			return static_cast<float>(elapsed) * props.limits.timestampPeriod / 1000000.0f;
+		};
 
-		m_RenderTime = rayTracingMs;
+		m_PassTimings.RayTracing = elapsedMs(0, 1);
+		m_PassTimings.Bloom = elapsedMs(1, 2);
+		m_PassTimings.PostProcess = elapsedMs(2, 3);
+		m_PassTimings.Upscale = elapsedMs(3, 4);
+		m_PassTimings.TracedPixels = frame.TracedPixels;
+		m_RenderTime = elapsedMs(0, 4);
 	}
 }
 
@@ -514,7 +1144,8 @@ void VulkanEngine::DrawImGui(const VkCommandBuffer cmd, const VkImageView target
 
 void VulkanEngine::RecreateSwapchain(uint32_t width, uint32_t height)
 {
-	vkDeviceWaitIdle(m_Device);
+	// Only the graphics queue touches the swapchain images
+	WaitForTimeline(m_GraphicsTimeline, m_GraphicsTimelineValue);
 	DestroySwapchain();
 	CreateSwapchain(width, height);
 	ResetAccumulation();
@@ -583,196 +1214,212 @@ void VulkanEngine::InitImGui()
 
 void VulkanEngine::InitShaders()
 {
-	const std::vector<DescriptorBinding> rtBindings =
-	{
-		DescriptorBinding(m_HDRImage, m_RenderSampler),
-		DescriptorBinding(m_AccumulationImage),
-		DescriptorBinding(UniformBuffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
-		DescriptorBinding(SphereBuffer),
-		DescriptorBinding(MaterialBuffer)
-	};
+	const std::filesystem::path pathToCompiled = m_PathToShaders / "compiled";
 
-	CreateShader(ShaderName::RAY_TRACING, rtBindings, nullptr, (m_PathToShaders / "compiled" / "ray_tracing.spv").string());
+	CreateShader(ShaderName::RAY_TRACING, pathToCompiled / "ray_tracing.spv");
+	CreateShader(ShaderName::POST_PROCESS, pathToCompiled / "post_process.spv");
+	CreateShader(ShaderName::DOWNSAMPLE, pathToCompiled / "downsample.spv");
+	CreateShader(ShaderName::UPSAMPLE, pathToCompiled / "upsample.spv");
+	CreateShader(ShaderName::UPSCALE, pathToCompiled / "upscale.spv");
+	CreateShader(ShaderName::ACCUMULATION_MERGE, pathToCompiled / "accumulation_merge.spv");
 
-	const std::vector<DescriptorBinding> toneMappingBindings =
-	{
-		DescriptorBinding(m_HDRImage, m_RenderSampler),
-		DescriptorBinding(m_LDRImage)
-	};
+	Shader& rtShader = m_Shaders.at(ShaderName::RAY_TRACING);
+	rtShader.Bind(2, DescriptorBinding(UniformBuffer));
+	BindSceneBuffers();
 
-	CreateShader(ShaderName::TONE_MAPPING, toneMappingBindings, nullptr, (m_PathToShaders / "compiled" / "tone_mapping.spv").string());
+	Shader& downsampleShader = m_Shaders.at(ShaderName::DOWNSAMPLE);
+	downsampleShader.Bind(2, DescriptorBinding(BloomCounterBuffer, sizeof(uint32_t)));
 
-	const std::vector<DescriptorBinding> colorGradeBindings =
-	{
-		DescriptorBinding(m_Luts.at(LUTType::CINEMATIC), m_RenderSampler, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
-		DescriptorBinding(m_HDRImage, m_RenderSampler),
-	};
+	Shader& mergeShader = m_Shaders.at(ShaderName::ACCUMULATION_MERGE);
+	mergeShader.Bind(1, DescriptorBinding(m_MergeBuffer));
 
-	CreateShader(ShaderName::COLOR_GRADING, colorGradeBindings, nullptr, (m_PathToShaders / "compiled" / "color_grading.spv").string());
+	Shader& postProcessShader = m_Shaders.at(ShaderName::POST_PROCESS);
+	postProcessShader.BindArrayElement(0, s_IdentityLutDescriptor, DescriptorBinding(m_IdentityLut, m_RenderSampler));
 
-	const Shader& rtShader = m_Shaders.at(ShaderName::RAY_TRACING);
-	const Shader& toneMappingShader = m_Shaders.at(ShaderName::TONE_MAPPING);
-	const Shader& colorGradingShader = m_Shaders.at(ShaderName::COLOR_GRADING);
-
-	UpdateDescriptorSets(rtShader);
-	UpdateDescriptorSets(toneMappingShader);
-	UpdateDescriptorSets(colorGradingShader);
+	InitBloomDescriptors();
+	BindRenderTargets();
 }
 
-void VulkanEngine::CreateShader(const ShaderName& shaderName,
-	const std::vector<DescriptorBinding>& bindings,
-	VkPushConstantRange* pushConstantRange,
-	const std::filesystem::path& path)
+void VulkanEngine::CreateShader(const ShaderName& shaderName, const std::filesystem::path& path)
 {
 	Shader shader;
-	shader.Bindings = bindings;
 
-	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
-	std::unordered_map<VkDescriptorType, uint32_t> descriptorCounts;
+	if (!BuildShader(path, shader))
+		return;
 
-	for (size_t i = 0; i < bindings.size(); ++i)
-	{
-		layoutBindings.emplace_back(
-			static_cast<uint32_t>(i),        
-			bindings[i].Type,                
-			1,                               
-			VK_SHADER_STAGE_COMPUTE_BIT      
-		);
-		descriptorCounts[bindings[i].Type]++;
-	}
+	shader.DescriptorSet = m_DescriptorCache.Allocate(shader.DescriptorLayout);
 
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	for (const auto& [type, count] : descriptorCounts)
+	if (shader.DescriptorSet == VK_NULL_HANDLE)
 	{
-		poolSizes.emplace_back(type, count);
-	}
-	
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = layoutBindings.data();
-
-	if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &shader.DescriptorLayout))
-	{
-		std::println("Failed to create compute descriptor set layout");
+		std::println("Failed to allocate compute descriptor set");
+		shader.Destroy(m_Device);
 		return;
 	}
 
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-	poolInfo.maxSets = 1;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
+	m_Shaders.insert_or_assign(shaderName, shader);
+}
 
-	if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &shader.DescriptorPool))
-	{
-		std::println("Failed to create compute descriptor pool");
-		return;
-	}
+bool VulkanEngine::BuildShader(const std::filesystem::path& path, Shader& outShader)
+{
+	return ComputeShader::Build(m_Device, m_DescriptorCache, path, outShader);
+}
 
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = shader.DescriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = &shader.DescriptorLayout;
+void VulkanEngine::DestroyShader(Shader& shader)
+{
+	shader.Destroy(m_Device);
+	m_DescriptorCache.Free(shader.DescriptorSet);
+	shader.DescriptorSet = VK_NULL_HANDLE;
+}
 
-	if (vkAllocateDescriptorSets(m_Device, &allocInfo, &shader.DescriptorSet))
-	{
-		std::println("Failed to allocate compute descriptor set");
+void VulkanEngine::BindSceneBuffers()
+{
+	Shader& rtShader = m_Shaders.at(ShaderName::RAY_TRACING);
+	const VkDeviceSize sphereCount = std::max(m_SphereCount, 1u);
+	const VkDeviceSize materialCount = std::max(m_MaterialCount, 1u);
+
+	rtShader.Bind(3, DescriptorBinding(SpherePositionBuffer, sphereCount * sizeof(glm::vec3)));
+	rtShader.Bind(4, DescriptorBinding(MaterialBuffer, materialCount * sizeof(Material)));
+	rtShader.Bind(5, DescriptorBinding(SphereRadiusBuffer, sphereCount * sizeof(float)));
+	rtShader.Bind(6, DescriptorBinding(SphereMaterialIndexBuffer, sphereCount * sizeof(uint32_t)));
+}
+
+void VulkanEngine::ResizeSceneBuffers(uint32_t sphereCount, uint32_t materialCount)
+{
+	if (sphereCount == m_SphereCount && materialCount == m_MaterialCount)
 		return;
-	}
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &shader.DescriptorLayout;
+	// Only happens when a scene is switched or reloaded, so waiting for the compute queue that reads them is cheaper than versioning the buffers
+	WaitForTimeline(m_ComputeTimeline, m_ComputeTimelineValue);
 
-	if (pushConstantRange != nullptr)
-	{
-		pipelineLayoutInfo.pPushConstantRanges = pushConstantRange;
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-	}
+	const VkDeviceSize sphereCapacity = std::max(sphereCount, 1u);
+	const VkDeviceSize materialCapacity = std::max(materialCount, 1u);
 
-	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &shader.PipelineLayout))
-	{
-		std::println("Failed to create compute pipeline layout");
+	GrowBuffer(SpherePositionBuffer, sphereCapacity * sizeof(glm::vec3), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	GrowBuffer(SphereRadiusBuffer, sphereCapacity * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	GrowBuffer(SphereMaterialIndexBuffer, sphereCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	GrowBuffer(MaterialBuffer, materialCapacity * sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+	m_SphereCount = sphereCount;
+	m_MaterialCount = materialCount;
+
+	BindSceneBuffers();
+	UpdateDescriptorSets(m_Shaders.at(ShaderName::RAY_TRACING));
+}
+
+void VulkanEngine::GrowBuffer(AllocatedBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	if (buffer.Info.size >= size)
 		return;
-	}
 
-	const std::vector<uint32_t> buffer = LoadShaderFromFile(path);
+	std::erase_if(m_PendingBufferWrites, [&buffer](const PendingBufferWrite& write) -> bool { return write.Buffer == buffer.Buffer; });
+
+	vmaDestroyBuffer(m_Allocator, buffer.Buffer, buffer.Allocation);
+	buffer = CreateBuffer(std::bit_ceil(size), usage, VMA_MEMORY_USAGE_CPU_TO_GPU);
+}
 
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = buffer.size() * sizeof(uint32_t);
-	createInfo.pCode = buffer.data();
+void VulkanEngine::StageBufferWrite(const AllocatedBuffer& buffer, std::span<const std::byte> bytes)
+{
+	if (bytes.empty())
+		return;
 
-	VkShaderModule computeShaderModule = {};
-	if (vkCreateShaderModule(m_Device, &createInfo, nullptr, &computeShaderModule))
+	if (bytes.size() > buffer.Info.size)
 	{
-		std::println("Failed to create compute shader module");
+		std::println("Staged write of {} bytes doesn't fit the buffer of {} bytes", bytes.size(), buffer.Info.size);
 		return;
 	}
 
-	VkPipelineShaderStageCreateInfo shaderStageInfo = {};
-	shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-	shaderStageInfo.module = computeShaderModule;
-	shaderStageInfo.pName = "main";
+	std::erase_if(m_PendingBufferWrites, [&buffer](const PendingBufferWrite& write) -> bool { return write.Buffer == buffer.Buffer; });
+	m_PendingBufferWrites.push_back({ buffer.Buffer, { bytes.begin(), bytes.end() } });
+}
+
+void VulkanEngine::RecordBufferWrites(FrameData& frame, VkCommandBuffer cmd)
+{
+	if (m_PendingBufferWrites.empty())
+		return;
+
+	VkDeviceSize stagingSize = 0;
+	for (const PendingBufferWrite& write : m_PendingBufferWrites)
+		stagingSize += write.Bytes.size();
 
-	VkComputePipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	pipelineInfo.stage = shaderStageInfo;
-	pipelineInfo.layout = shader.PipelineLayout;
+	// DrawFrame waited for the last compute submission of the frame, nothing reads its staging anymore
+	GrowBuffer(frame.StagingBuffer, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
 
-	if (vkCreateComputePipelines(m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shader.Pipeline))
+	void* mapped;
+	vmaMapMemory(m_Allocator, frame.StagingBuffer.Allocation, &mapped);
+
+	std::vector<std::pair<VkBuffer, VkBufferCopy>> copies;
+	copies.reserve(m_PendingBufferWrites.size());
+	VkDeviceSize offset = 0;
+
+	for (const PendingBufferWrite& write : m_PendingBufferWrites)
 	{
-		std::println("Failed to create compute pipeline");
-		vkDestroyShaderModule(m_Device, computeShaderModule, nullptr);
-		return;
+		std::memcpy(static_cast<std::byte*>(mapped) + offset, write.Bytes.data(), write.Bytes.size());
+		copies.push_back({ write.Buffer, { offset, 0, write.Bytes.size() } });
+		offset += write.Bytes.size();
 	}
 
-	vkDestroyShaderModule(m_Device, computeShaderModule, nullptr);
-
-	m_Shaders[shaderName] = shader;
+	vmaFlushAllocation(m_Allocator, frame.StagingBuffer.Allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(m_Allocator, frame.StagingBuffer.Allocation);
+	m_PendingBufferWrites.clear();
+
+	// The other frame's passes earlier on the queue may still read the old contents
+	VkMemoryBarrier2 writeBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+	writeBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+	writeBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	writeBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	writeBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	VkDependencyInfo dependencyInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &writeBarrier;
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
+
+	for (const auto& [buffer, copy] : copies)
+		vkCmdCopyBuffer(cmd, frame.StagingBuffer.Buffer, buffer, 1, &copy);
+
+	VkMemoryBarrier2 readBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+	readBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	readBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	readBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	readBarrier.dstAccessMask = VK_ACCESS_2_UNIFORM_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+	dependencyInfo.pMemoryBarriers = &readBarrier;
+	vkCmdPipelineBarrier2(cmd, &dependencyInfo);
 }
 
 void VulkanEngine::UpdateDescriptorSets(const Shader& shader) const
 {
-	std::vector<VkWriteDescriptorSet> descriptorWrites;
-
-	for (size_t i = 0; i < shader.Bindings.size(); ++i)
-	{
-		VkWriteDescriptorSet writeDescriptorSet = {};
-		writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorSet.dstSet = shader.DescriptorSet;
-		writeDescriptorSet.dstBinding = static_cast<uint32_t>(i);
-		writeDescriptorSet.descriptorType = shader.Bindings[i].Type;
-		writeDescriptorSet.descriptorCount = 1;
+	ComputeShader::UpdateDescriptorSets(m_Device, shader);
+}
 
-		if (shader.Bindings[i].Type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
-			shader.Bindings[i].Type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || 
-			shader.Bindings[i].Type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-		{
-			writeDescriptorSet.pImageInfo = &shader.Bindings[i].ImageInfo;
-		}
-		else
-		{
-			writeDescriptorSet.pBufferInfo = &shader.Bindings[i].BufferInfo;
-		}
+void VulkanEngine::UpdateDescriptorArrayElement(const Shader& shader, uint32_t binding, uint32_t element) const
+{
+	const VkDescriptorSetLayoutBinding* layoutBinding = shader.Reflection.FindBinding(binding);
+	const auto elements = shader.ArrayBindings.find(binding);
 
-		descriptorWrites.push_back(writeDescriptorSet);
+	if (!layoutBinding || element >= layoutBinding->descriptorCount || elements == shader.ArrayBindings.end() || element >= elements->second.size())
+	{
+		std::println("No array element {} at binding {}", element, binding);
+		return;
 	}
 
-	vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()),
-		descriptorWrites.data(), 0, nullptr);
+	VkWriteDescriptorSet writeDescriptorSet = {};
+	writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorSet.dstSet = shader.DescriptorSet;
+	writeDescriptorSet.dstBinding = binding;
+	writeDescriptorSet.dstArrayElement = element;
+	writeDescriptorSet.descriptorType = layoutBinding->descriptorType;
+	writeDescriptorSet.descriptorCount = 1;
+	writeDescriptorSet.pImageInfo = &elements->second[element];
+
+	vkUpdateDescriptorSets(m_Device, 1, &writeDescriptorSet, 0, nullptr);
 }
 
-void VulkanEngine::RayTrace(VkCommandBuffer cmd, uint32_t gx, uint32_t gy)
+void VulkanEngine::RayTrace(VkCommandBuffer cmd, const TraceTile& tile, const bool resolve)
 {
 	const Shader& rtShader = m_Shaders.at(ShaderName::RAY_TRACING);
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rtShader.Pipeline);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, rtShader.GetPipeline());
 	vkCmdBindDescriptorSets(
 		cmd,
 		VK_PIPELINE_BIND_POINT_COMPUTE,
@@ -780,219 +1427,220 @@ void VulkanEngine::RayTrace(VkCommandBuffer cmd, uint32_t gx, uint32_t gy)
 		0, 1, &rtShader.DescriptorSet,
 		0, nullptr
 	);
-	vkCmdDispatch(cmd, gx, gy, 1);
+
+	const RayTracingConstants constants = { tile.Offset, resolve, m_AccumulationSeed };
+	vkCmdPushConstants(cmd, rtShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	const glm::uvec3 groupCount = rtShader.GetGroupCount(tile.Extent.x, tile.Extent.y);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
+}
+
+void VulkanEngine::MergeAccumulationRegion(VkCommandBuffer cmd, const AccumulationMergeConstants& constants)
+{
+	const Shader& mergeShader = m_Shaders.at(ShaderName::ACCUMULATION_MERGE);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mergeShader.GetPipeline());
+	vkCmdBindDescriptorSets(
+		cmd,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		mergeShader.PipelineLayout,
+		0, 1, &mergeShader.DescriptorSet,
+		0, nullptr
+	);
+
+	vkCmdPushConstants(cmd, mergeShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	const glm::uvec3 groupCount = mergeShader.GetGroupCount(constants.Extent.x, constants.Extent.y);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
 }
 
-void VulkanEngine::ColorGrade(VkCommandBuffer cmd, uint32_t gx, uint32_t gy)
+void VulkanEngine::PostProcess(VkCommandBuffer cmd, uint32_t width, uint32_t height, bool bloom, bool upscale)
 {
-	const Shader& colorGradingShader = m_Shaders.at(ShaderName::COLOR_GRADING);
+	const Shader& postProcessShader = m_Shaders.at(ShaderName::POST_PROCESS);
+
+	uint32_t variant = 0;
+	if (bloom)
+		variant |= POST_PROCESS_BLOOM;
+	if (m_ColorGradingEnabled)
+		variant |= POST_PROCESS_COLOR_GRADING;
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, colorGradingShader.Pipeline);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, postProcessShader.GetPipeline(variant));
 	vkCmdBindDescriptorSets(
 		cmd,
 		VK_PIPELINE_BIND_POINT_COMPUTE,
-		colorGradingShader.PipelineLayout,
-		0, 1, &colorGradingShader.DescriptorSet,
+		postProcessShader.PipelineLayout,
+		0, 1, &postProcessShader.DescriptorSet,
 		0, nullptr
 	);
-	vkCmdDispatch(cmd, gx, gy, 1);
+
+	const PostProcessConstants constants =
+	{
+		GetLutBlend(),
+		m_Exposure,
+		m_BloomRadius,
+		upscale ? POST_PROCESS_OUTPUT_SCALED : POST_PROCESS_OUTPUT_DISPLAY,
+		{ width, height }
+	};
+	vkCmdPushConstants(cmd, postProcessShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	const glm::uvec3 groupCount = postProcessShader.GetGroupCount(width, height);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
 }
 
-void VulkanEngine::ToneMap(VkCommandBuffer cmd, uint32_t gx, uint32_t gy)
+void VulkanEngine::Upscale(VkCommandBuffer cmd, glm::uvec2 renderExtent)
 {
-	const Shader& toneMappingShader = m_Shaders.at(ShaderName::TONE_MAPPING);
+	const Shader& upscaleShader = m_Shaders.at(ShaderName::UPSCALE);
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, toneMappingShader.Pipeline);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, upscaleShader.GetPipeline());
 	vkCmdBindDescriptorSets(
 		cmd,
 		VK_PIPELINE_BIND_POINT_COMPUTE,
-		toneMappingShader.PipelineLayout,
-		0, 1, &toneMappingShader.DescriptorSet,
+		upscaleShader.PipelineLayout,
+		0, 1, &upscaleShader.DescriptorSet,
 		0, nullptr
 	);
-	vkCmdDispatch(cmd, gx, gy, 1);
+
+	const UpscaleConstants constants = { renderExtent, { m_ViewportWidth, m_ViewportHeight } };
+	vkCmdPushConstants(cmd, upscaleShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+	const glm::uvec3 groupCount = upscaleShader.GetGroupCount(m_ViewportWidth, m_ViewportHeight);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
 }
 
-void VulkanEngine::Upsample(VkCommandBuffer cmd, VkImage image, int32_t width, int32_t height, uint32_t mipLevels)
+void VulkanEngine::Upsample(VkCommandBuffer cmd, uint32_t width, uint32_t height, uint32_t mipLevels)
 {
-	Shader& upsampleShader = m_Shaders[ShaderName::UPSAMPLE];
+	const Shader& upsampleShader = m_Shaders.at(ShaderName::UPSAMPLE);
 
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+	// Every mip stays in GENERAL, a step only has to see the mip the step before wrote
+	VkMemoryBarrier2 barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
 
-	for (int32_t mip = mipLevels - 2; mip >= 0; mip--)
-	{
-		uint32_t mipWidth = glm::max(1u, static_cast<uint32_t>(width >> mip));
-		uint32_t mipHeight = glm::max(1u, static_cast<uint32_t>(height >> mip));
+	VkDependencyInfo dependencyInfo = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &barrier;
 
-		barrier.subresourceRange.baseMipLevel = mip;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, upsampleShader.GetPipeline());
 
-		vkCmdPipelineBarrier(cmd,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	// The post process kernel composites mip 0 onto the scene
+	for (int32_t mip = static_cast<int32_t>(mipLevels) - 2; mip >= 0; mip--)
+	{
+		const uint32_t mipWidth = glm::max(1u, width >> mip);
+		const uint32_t mipHeight = glm::max(1u, height >> mip);
+
+		if (mip != static_cast<int32_t>(mipLevels) - 2)
+			vkCmdPipelineBarrier2(cmd, &dependencyInfo);
 
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, upsampleShader.Pipeline);
 		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
 			upsampleShader.PipelineLayout,
 			0, 1, &m_UpsampleDescriptorSets[mip],
 			0, nullptr);
 
-		uint32_t gx = (mipWidth + 15) / 16;
-		uint32_t gy = (mipHeight + 15) / 16;
-		vkCmdDispatch(cmd, gx, gy, 1);
-
-		barrier.subresourceRange.baseMipLevel = mip;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		const BloomUpsampleConstants constants =
+		{
+			{ mipWidth, mipHeight },
+			glm::max(glm::uvec2(1), glm::uvec2(mipWidth, mipHeight) / 2u),
+			m_BloomRadius
+		};
+		vkCmdPushConstants(cmd, upsampleShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
 
-		vkCmdPipelineBarrier(cmd,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		const glm::uvec3 groupCount = upsampleShader.GetGroupCount(mipWidth, mipHeight);
+		vkCmdDispatch(cmd, groupCount.x, groupCount.y, groupCount.z);
 	}
-
-	TransitionImage(cmd, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, m_MipLevels);
 }
 
-void VulkanEngine::Downsample(VkCommandBuffer cmd, VkImage image, int32_t width, int32_t height, uint32_t mipLevels)
+void VulkanEngine::Downsample(VkCommandBuffer cmd, uint32_t width, uint32_t height)
 {
-	Shader& downsampleShader = m_Shaders[ShaderName::DOWNSAMPLE];
-
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
-
-	uint32_t mipWidth = width;
-	uint32_t mipHeight = height;
-
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(cmd,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-		0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-	int isBrightPass = 1;
-	for (uint32_t mip = 1; mip < mipLevels; mip++)
-	{
-		if (mip > 1)
-			isBrightPass = 0;
+	const Shader& downsampleShader = m_Shaders.at(ShaderName::DOWNSAMPLE);
 
-		vkCmdPushConstants(cmd, downsampleShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(int), &isBrightPass);
+	// Every workgroup covers a 64x64 block of the HDR image, i.e. 32x32 texels of bloom mip 0
+	const glm::uvec2 groupCount = { (width + s_BloomTileSize - 1) / s_BloomTileSize, (height + s_BloomTileSize - 1) / s_BloomTileSize };
 
-		mipWidth = glm::max(1u, mipWidth / 2);
-		mipHeight = glm::max(1u, mipHeight / 2);
+	const BloomDownsampleConstants constants = { m_BloomMipLevels, groupCount.x * groupCount.y, { width, height } };
 
-		barrier.subresourceRange.baseMipLevel = mip;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-
-		vkCmdPipelineBarrier(cmd,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, downsampleShader.Pipeline);
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
-			downsampleShader.PipelineLayout,
-			0, 1, &m_DownsampleDescriptorSets[mip - 1],
-			0, nullptr);
-
-		uint32_t gx = (mipWidth + 15) / 16;
-		uint32_t gy = (mipHeight + 15) / 16;
-		vkCmdDispatch(cmd, gx, gy, 1);
-
-		barrier.subresourceRange.baseMipLevel = mip;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(cmd,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			0, 0, nullptr, 0, nullptr, 1, &barrier);
-	}
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, downsampleShader.GetPipeline());
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+		downsampleShader.PipelineLayout,
+		0, 1, &downsampleShader.DescriptorSet,
+		0, nullptr);
+	vkCmdPushConstants(cmd, downsampleShader.PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(cmd, groupCount.x, groupCount.y, 1);
 }
 
 void VulkanEngine::InitBuffers()
 {
-	UniformBuffer = CreateBuffer(sizeof(UniformBufferData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	// Written through the staged writes, the frame in flight keeps reading the previous contents
+	UniformBuffer = CreateBuffer(sizeof(UniformBufferData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
 	constexpr size_t maxSpheres = 100;
-	SphereBuffer = CreateBuffer(maxSpheres * sizeof(SphereBufferData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	SpherePositionBuffer = CreateBuffer(maxSpheres * sizeof(glm::vec3), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	SphereRadiusBuffer = CreateBuffer(maxSpheres * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	SphereMaterialIndexBuffer = CreateBuffer(maxSpheres * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
 	constexpr size_t maxMaterials = 50;
-	MaterialBuffer = CreateBuffer(maxMaterials * sizeof(MaterialBufferData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	MaterialBuffer = CreateBuffer(maxMaterials * sizeof(Material), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Grows with the first merges, trace devices are optional
+	m_MergeBuffer = CreateBuffer(sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Only zeroed once, the last downsample workgroup of each frame resets it on the GPU
+	BloomCounterBuffer = CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	void* counterData;
+	vmaMapMemory(m_Allocator, BloomCounterBuffer.Allocation, &counterData);
+	memset(counterData, 0, sizeof(uint32_t));
+	vmaUnmapMemory(m_Allocator, BloomCounterBuffer.Allocation);
+	vmaFlushAllocation(m_Allocator, BloomCounterBuffer.Allocation, 0, sizeof(uint32_t));
 }
 
-void VulkanEngine::InitRenderTargets()
+void VulkanEngine::InitRenderTargets(const bool keepAccumulation)
 {
-	uint32_t width = m_ViewportWidth, height = m_ViewportHeight;
-
-	if (!width || !height)
-	{
-		width = 1080;
-		height = 720;
-	}
-	const VkExtent3D imageExtent =  
-	{
-		width,
-		height,
-		1
-	};
+	const VkExtent3D imageExtent = { m_TargetCapacity.x, m_TargetCapacity.y, 1 };
+	const VkExtent3D bloomExtent = { glm::max(1u, imageExtent.width / 2), glm::max(1u, imageExtent.height / 2), 1 };
 
 	m_LDRImage = CreateImage(imageExtent, VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT |
 		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 1);
+	CreateImageView(m_LDRImage, VK_IMAGE_VIEW_TYPE_2D, m_LDRImage.ImageFormat, 1);
 
-	if (m_LDRImage.ImageView == VK_NULL_HANDLE)
+	if (!keepAccumulation)
 	{
-		CreateImageView(m_LDRImage, VK_IMAGE_VIEW_TYPE_2D, m_LDRImage.ImageFormat, 1);
+		m_AccumulationImage = CreateImage(imageExtent, VK_IMAGE_TYPE_2D, VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
+		CreateImageView(m_AccumulationImage, VK_IMAGE_VIEW_TYPE_2D, m_AccumulationImage.ImageFormat, 1);
+
+		// The frame graph moves the new image out of UNDEFINED on its first use, nothing is submitted here
+		m_AccumulationNeedsClear = true;
 	}
 
-	m_MipLevels = static_cast<uint32_t>(glm::floor(glm::log2(glm::max(width, height)))) + 1;
+	m_BloomMipLevels = GetBloomMipLevels(bloomExtent);
 
-	m_HDRImage = CreateImage(imageExtent, VK_IMAGE_TYPE_2D, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT |
-		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, m_MipLevels);
+	// Rewritten every frame, so they share one allocation and alias wherever their passes allow it
+	std::vector<TransientImageInfo> transientInfos =
+	{
+		{ imageExtent, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			1, FramePass::RAY_TRACING, FramePass::POST_PROCESS },
+		{ imageExtent, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			1, FramePass::POST_PROCESS, FramePass::UPSCALE }
+	};
 
-	if (m_HDRImage.ImageView == VK_NULL_HANDLE)
+	if (m_BloomMipLevels > 0)
 	{
-		CreateImageView(m_HDRImage, VK_IMAGE_VIEW_TYPE_2D, m_HDRImage.ImageFormat, m_MipLevels);
+		transientInfos.push_back({ bloomExtent, s_BloomFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			m_BloomMipLevels, FramePass::BLOOM, FramePass::POST_PROCESS });
 	}
 
-	m_AccumulationImage = CreateImage(imageExtent, VK_IMAGE_TYPE_2D, VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
+	std::array<AllocatedImage, 3> transientImages = {};
+	m_TransientAllocation = CreateTransientImages(transientInfos, transientImages);
 
-	if (m_AccumulationImage.ImageView == VK_NULL_HANDLE)
-	{
-		CreateImageView(m_AccumulationImage, VK_IMAGE_VIEW_TYPE_2D, m_AccumulationImage.ImageFormat, 1);
-	}
+	m_HDRImage = transientImages[0];
+	m_ScaledLDRImage = transientImages[1];
+	m_BloomImage = transientImages[2];
+
+	CreateImageView(m_HDRImage, VK_IMAGE_VIEW_TYPE_2D, m_HDRImage.ImageFormat, 1);
+	CreateImageView(m_ScaledLDRImage, VK_IMAGE_VIEW_TYPE_2D, m_ScaledLDRImage.ImageFormat, 1);
+	InitBloomViews();
 
 	if (m_RenderSampler == VK_NULL_HANDLE) 
 	{
@@ -1012,231 +1660,352 @@ void VulkanEngine::InitRenderTargets()
 		vkCreateSampler(m_Device, &samplerInfo, nullptr, &m_RenderSampler);
 	}
 
-	vkResetCommandBuffer(m_ImmediateCommandBuffer, 0);
-	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	m_RenderTextureData.SetTexID(reinterpret_cast<ImTextureID>(ImGui_ImplVulkan_AddTexture(
+		m_RenderSampler,
+		m_LDRImage.ImageView,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	)));
+}
 
-	vkBeginCommandBuffer(m_ImmediateCommandBuffer, &bi);
+VmaAllocation VulkanEngine::CreateTransientImages(std::span<const TransientImageInfo> infos, std::span<AllocatedImage> outImages) const
+{
+	std::vector<VkMemoryRequirements> requirements(infos.size());
+	uint32_t memoryTypeBits = ~0u;
 
-	TransitionImage(m_ImmediateCommandBuffer, m_LDRImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
-	TransitionImage(m_ImmediateCommandBuffer, m_HDRImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_MipLevels);
-	TransitionImage(m_ImmediateCommandBuffer, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1);
+	for (size_t i = 0; i < infos.size(); i++)
+	{
+		const TransientImageInfo& info = infos[i];
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = info.Format;
+		imageInfo.extent = info.Extent;
+		imageInfo.mipLevels = info.MipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = info.Usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		outImages[i] = {};
+		outImages[i].ImageExtent = info.Extent;
+		outImages[i].ImageFormat = info.Format;
+
+		vkCreateImage(m_Device, &imageInfo, nullptr, &outImages[i].Image);
+		vkGetImageMemoryRequirements(m_Device, outImages[i].Image, &requirements[i]);
+		memoryTypeBits &= requirements[i].memoryTypeBits;
+	}
 
-	vkEndCommandBuffer(m_ImmediateCommandBuffer);
-	vkResetFences(m_Device, 1, &m_ImmediateFence);
+	VkMemoryRequirements combined = {};
+	const std::vector<VkDeviceSize> offsets = PackByLifetime(infos, requirements, combined);
+	combined.memoryTypeBits = memoryTypeBits;
 
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_ImmediateCommandBuffer;
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-	vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_ImmediateFence);
-	vkQueueWaitIdle(m_GraphicsQueue);
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	const VkResult result = memoryTypeBits != 0 ? vmaAllocateMemory(m_Allocator, &combined, &allocInfo, &allocation, nullptr) : VK_ERROR_FEATURE_NOT_PRESENT;
 
-	m_RenderTextureData.SetTexID(reinterpret_cast<ImTextureID>(ImGui_ImplVulkan_AddTexture(
-		m_RenderSampler,
-		m_LDRImage.ImageView,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-	)));
+	// No memory type suits every image, they get allocations of their own
+	if (result != VK_SUCCESS)
+	{
+		std::println("Transient render targets can't share memory: {}", static_cast<int>(result));
+
+		for (size_t i = 0; i < infos.size(); i++)
+		{
+			vkDestroyImage(m_Device, outImages[i].Image, nullptr);
+			outImages[i] = CreateImage(infos[i].Extent, VK_IMAGE_TYPE_2D, infos[i].Format, infos[i].Usage, infos[i].MipLevels);
+		}
+
+		return VK_NULL_HANDLE;
+	}
+
+	for (size_t i = 0; i < infos.size(); i++)
+		vmaBindImageMemory2(m_Allocator, allocation, offsets[i], outImages[i].Image, nullptr);
+
+	return allocation;
 }
 
 void VulkanEngine::InitLuts()
 {
-	VkExtent3D lutExtent = { 33, 33, 33 };
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(m_PathToLuts, error))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == CubeLutLoader::s_Extension)
+			m_Luts.push_back({ .Path = entry.path() });
+	}
+
+	std::ranges::sort(m_Luts, {}, &LutSlot::Path);
+
+	for (const LutSlot& slot : m_Luts)
+	{
+		m_LutNames.push_back(slot.Path.stem().string());
+	}
+
+	// Bound until the selected table has streamed in, so color grading never samples a missing image.
+	// The only upload anything waits for, it is bound from the first frame on.
+	if (const std::optional<uint64_t> identityUpload = UploadLut(CubeLutLoader::MakeIdentity(2), m_IdentityLut))
+	{
+		m_Uploads.Wait(*identityUpload);
+	}
+	else
+	{
+		// The image stays bound so descriptors remain valid, it is never sampled with grading off
+		std::println("Couldn't upload the identity LUT, color grading is disabled");
+		m_ColorGradingEnabled = false;
+	}
 
-	AllocatedImage cinematicLut = CreateImage(lutExtent, VK_IMAGE_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
-	CreateImageView(cinematicLut, VK_IMAGE_VIEW_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+	for (uint32_t descriptor = s_LutDescriptorCount - 1; descriptor > s_IdentityLutDescriptor; descriptor--)
+	{
+		m_FreeLutDescriptors.push_back(descriptor);
+	}
+
+	const auto defaultLut = std::ranges::find(m_LutNames, s_DefaultLutName);
+	m_SelectedLut = defaultLut != m_LutNames.end() ? static_cast<uint32_t>(defaultLut - m_LutNames.begin()) : 0;
+
+	if (!m_Luts.empty())
+		RequestLut(m_SelectedLut);
+}
 
-	AllocatedImage dayNightLut = CreateImage(lutExtent, VK_IMAGE_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
-	CreateImageView(dayNightLut, VK_IMAGE_VIEW_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+void VulkanEngine::RequestLut(uint32_t lutIndex)
+{
+	LutSlot& slot = m_Luts[lutIndex];
 
-	AllocatedImage cineDramaLut = CreateImage(lutExtent, VK_IMAGE_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
-	CreateImageView(cineDramaLut, VK_IMAGE_VIEW_TYPE_3D, VK_FORMAT_R32G32B32A32_SFLOAT, 1);
+	if (slot.IsResident() || slot.IsLoading() || slot.IsUploading())
+		return;
 
-	CreateLUT(cinematicLut, m_PathToLuts / "cinematic.cube", LUTType::CINEMATIC);
-	CreateLUT(dayNightLut, m_PathToLuts / "day-night.cube", LUTType::DAY_NIGHT);
-	CreateLUT(cineDramaLut, m_PathToLuts / "cinedrama.cube", LUTType::CINEDRAMA);
+	slot.PendingLoad = std::async(std::launch::async, [path = slot.Path, cacheDirectory = m_PathToLuts / "cache"]() -> std::optional<CubeLut>
+		{
+			return CubeLutLoader::Load(path, cacheDirectory);
+		});
 }
 
-void VulkanEngine::CreateLUT(AllocatedImage& lutImage, const std::filesystem::path& pathToLut, LUTType type)
+void VulkanEngine::UpdateLuts()
 {
-	std::vector<float> lutData = LoadLUT(pathToLut);
+	Shader& postProcessShader = m_Shaders.at(ShaderName::POST_PROCESS);
 
-	const size_t bufferSize = lutData.size() * sizeof(float);
+	for (uint32_t i = 0; i < m_Luts.size(); i++)
+	{
+		LutSlot& slot = m_Luts[i];
 
-	const AllocatedBuffer stagingBuffer = CreateBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_ONLY
-	);
+		// The descriptor is written once the upload is done, until then the table isn't resident and the previous one stays on screen
+		if (slot.IsUploading() && m_Uploads.IsComplete(slot.UploadValue))
+		{
+			slot.UploadValue = 0;
+			postProcessShader.BindArrayElement(0, slot.DescriptorIndex, DescriptorBinding(slot.Image, m_RenderSampler));
+			UpdateDescriptorArrayElement(postProcessShader, 0, slot.DescriptorIndex);
+		}
 
-	void* data;
-	vkMapMemory(m_Device, stagingBuffer.Allocation->GetMemory(), 0, bufferSize, 0, &data);
-	memcpy(data, lutData.data(), bufferSize);
-	vkUnmapMemory(m_Device, stagingBuffer.Allocation->GetMemory());
-	vmaFlushAllocation(m_Allocator, stagingBuffer.Allocation, 0, bufferSize);
+		// Finished loads wait for a descriptor to be recycled rather than overwrite one a frame in flight may sample
+		if (!slot.IsLoading() || m_FreeLutDescriptors.empty() || slot.PendingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
 
-	VkBufferImageCopy bufferImageCopy = {};
-	bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	bufferImageCopy.imageSubresource.layerCount = 1;
-	bufferImageCopy.imageExtent = {33, 33, 33};
+		const std::optional<CubeLut> lut = slot.PendingLoad.get();
 
-	VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		if (!lut)
+		{
+			std::println("Couldn't load LUT {}, keeping the current table", m_LutNames[i]);
+			continue;
+		}
+
+		const std::optional<uint64_t> uploadValue = UploadLut(*lut, slot.Image);
 
-	vkResetCommandBuffer(m_ImmediateCommandBuffer, 0);
-	vkBeginCommandBuffer(m_ImmediateCommandBuffer, &bi);
+		// Nothing references the image yet, a later request loads the table again
+		if (!uploadValue)
+		{
+			std::println("Couldn't upload LUT {}, keeping the current table", m_LutNames[i]);
+			vkDestroyImageView(m_Device, slot.Image.ImageView, nullptr);
+			DestroyImage(slot.Image);
+			slot.Image = {};
+			continue;
+		}
 
-	TransitionImage(m_ImmediateCommandBuffer, lutImage.Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
-	vkCmdCopyBufferToImage(m_ImmediateCommandBuffer, stagingBuffer.Buffer, lutImage.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
-	TransitionImage(m_ImmediateCommandBuffer, lutImage.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, 1);
+		slot.UploadValue = *uploadValue;
+		slot.DescriptorIndex = m_FreeLutDescriptors.back();
+		m_FreeLutDescriptors.pop_back();
+	}
 
-	vkEndCommandBuffer(m_ImmediateCommandBuffer);
-	vkResetFences(m_Device, 1, &m_ImmediateFence);
+	const auto now = std::chrono::steady_clock::now();
+	const float elapsed = std::chrono::duration<float>(now - m_LastLutUpdate).count();
+	m_LastLutUpdate = now;
 
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_ImmediateCommandBuffer;
+	if (m_SelectedLut >= m_Luts.size())
+		return;
 
-	vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_ImmediateFence);
-	vkQueueWaitIdle(m_GraphicsQueue);
+	m_Luts[m_SelectedLut].LastUsedFrame = m_FrameNumber;
 
-	vmaDestroyBuffer(m_Allocator, stagingBuffer.Buffer, stagingBuffer.Allocation);
+	// The fade only starts once the target is resident, until then the source table stays on screen
+	if (m_Luts[m_SelectedLut].IsResident() && m_LutBlend < 1.f)
+		m_LutBlend = m_LutTransitionSeconds > 0.f ? std::min(1.f, m_LutBlend + elapsed / m_LutTransitionSeconds) : 1.f;
 
-	m_Luts[type] = lutImage;
+	EvictLuts();
 }
 
-void VulkanEngine::InitMitmapsResources()
+void VulkanEngine::EvictLuts()
 {
-	Shader* downsampleShader = nullptr;
+	auto residentCount = static_cast<uint32_t>(std::ranges::count_if(m_Luts, &LutSlot::IsResident));
 
-	if (!m_Shaders.contains(ShaderName::DOWNSAMPLE))
+	while (residentCount > s_MaxResidentLuts)
 	{
-		VkDescriptorImageInfo dmmySrc = {};
-		dmmySrc.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		dmmySrc.sampler = m_RenderSampler;
+		LutSlot* oldest = nullptr;
 
-		VkDescriptorImageInfo dmmyDst = {};
-		dmmyDst.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-
-		std::vector<DescriptorBinding> downsampleBindings =
+		for (uint32_t i = 0; i < m_Luts.size(); i++)
 		{
-			DescriptorBinding(dmmySrc, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
-			DescriptorBinding(dmmyDst)
-		};
+			LutSlot& slot = m_Luts[i];
+			const bool inUse = i == m_SelectedLut || (i == m_LutBlendSource && m_LutBlend < 1.f);
 
-		VkPushConstantRange brightPassPushConstant = {};
-		brightPassPushConstant.offset = 0;
-		brightPassPushConstant.size = sizeof(int);
-		brightPassPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			if (slot.IsResident() && !inUse && (!oldest || slot.LastUsedFrame < oldest->LastUsedFrame))
+				oldest = &slot;
+		}
+
+		if (!oldest)
+			return;
 
-		CreateShader(ShaderName::DOWNSAMPLE, downsampleBindings, &brightPassPushConstant, (m_PathToShaders / "compiled" / "downsample.spv").string());
+		// Descriptor sets renewed from here on must not write the destroyed view
+		m_Shaders.at(ShaderName::POST_PROCESS).BindArrayElement(0, oldest->DescriptorIndex, DescriptorBinding(VkDescriptorImageInfo{}));
+
+		// Frames still in flight may sample the table
+		Retire([this, image = oldest->Image, descriptor = oldest->DescriptorIndex]() mutable -> void
+			{
+				vkDestroyImageView(m_Device, image.ImageView, nullptr);
+				DestroyImage(image);
+				m_FreeLutDescriptors.push_back(descriptor);
+			});
+
+		m_Uploads.ForgetImage(oldest->Image.Image);
+		oldest->Image = {};
+		residentCount--;
 	}
+}
+
+uint32_t VulkanEngine::GetLutDescriptor(uint32_t lutIndex) const
+{
+	return lutIndex < m_Luts.size() && m_Luts[lutIndex].IsResident() ? m_Luts[lutIndex].DescriptorIndex : s_IdentityLutDescriptor;
+}
 
-	downsampleShader = &m_Shaders.at(ShaderName::DOWNSAMPLE);
+LutBlendConstants VulkanEngine::GetLutBlend() const
+{
+	const uint32_t source = GetLutDescriptor(m_LutBlendSource);
+
+	if (m_SelectedLut >= m_Luts.size() || !m_Luts[m_SelectedLut].IsResident())
+		return { source, source, 0.f };
+
+	const uint32_t target = m_Luts[m_SelectedLut].DescriptorIndex;
+
+	// Once the fade is done the source may be evicted, so it must not be referenced anymore
+	if (m_LutBlend >= 1.f)
+		return { target, target, 1.f };
+
+	return { source, target, m_LutBlend };
+}
+
+std::optional<uint64_t> VulkanEngine::UploadLut(const CubeLut& lut, AllocatedImage& outImage)
+{
+	const VkFormat format = ToVkFormat(lut.Format);
+	const VkExtent3D lutExtent = { lut.Size, lut.Size, lut.Size };
 
-	if (!m_Shaders.contains(ShaderName::UPSAMPLE))
+	outImage = CreateImage(lutExtent, VK_IMAGE_TYPE_3D, format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 1);
+	CreateImageView(outImage, VK_IMAGE_VIEW_TYPE_3D, format, 1);
+
+	return m_Uploads.UploadImage(outImage, lut.Texels);
+}
+
+uint32_t VulkanEngine::GetBloomMipLevels(VkExtent3D bloomExtent) const
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_PhysicalDevice, s_BloomFormat, &formatProperties);
+
+	constexpr VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures)
 	{
-		VkDescriptorImageInfo dmmySrc = {};
-		dmmySrc.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		dmmySrc.sampler = m_RenderSampler;
+		std::println("B10G11R11 storage images are not supported, bloom is disabled");
+		return 0;
+	}
 
-		VkDescriptorImageInfo dmmyDst = {};
-		dmmyDst.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	const uint32_t largestSide = glm::max(bloomExtent.width, bloomExtent.height);
+	const uint32_t fullChain = static_cast<uint32_t>(glm::floor(glm::log2(static_cast<float>(largestSide)))) + 1;
 
-		std::vector<DescriptorBinding> upsampleBindings =
-		{
-			DescriptorBinding(dmmySrc, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
-			DescriptorBinding(dmmyDst)
-		};
+	// The last downsample workgroup reduces a single 64x64 block of mip 5, larger viewports stop at the mips every workgroup builds
+	if ((largestSide >> (s_WorkgroupBloomMips - 1)) > s_BloomTileSize)
+		return std::min({ fullChain, m_BloomMaxDepth, s_WorkgroupBloomMips });
+
+	return std::min({ fullChain, m_BloomMaxDepth, s_MaxBloomMips });
+}
 
-		CreateShader(ShaderName::UPSAMPLE, upsampleBindings, nullptr, (m_PathToShaders / "compiled" / "upsample.spv").string());
+void VulkanEngine::InitBloomViews()
+{
+	if (m_BloomImage.Image == VK_NULL_HANDLE)
+	{
+		m_BloomMipLevels = 0;
+		return;
 	}
 
-	m_MipmapImageViews.resize(m_MipLevels);
+	m_BloomMipViews.resize(m_BloomMipLevels);
 
-	for (uint32_t mip = 0; mip < m_MipLevels; mip++)
+	for (uint32_t mip = 0; mip < m_BloomMipLevels; mip++)
 	{
 		VkImageViewCreateInfo viewInfo = {};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		viewInfo.image = m_HDRImage.Image;
+		viewInfo.image = m_BloomImage.Image;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		viewInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		viewInfo.format = s_BloomFormat;
 		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		viewInfo.subresourceRange.baseMipLevel = mip;
 		viewInfo.subresourceRange.levelCount = 1;
 		viewInfo.subresourceRange.layerCount = 1;
-		vkCreateImageView(m_Device, &viewInfo, nullptr, &m_MipmapImageViews[mip]);
+		vkCreateImageView(m_Device, &viewInfo, nullptr, &m_BloomMipViews[mip]);
 	}
+}
 
-	VkDescriptorPoolSize poolSizes[] = {
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_MipLevels - 1 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_MipLevels - 1 }
-	};
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = (m_MipLevels - 1) * 2;
-	poolInfo.poolSizeCount = 2;
-	poolInfo.pPoolSizes = poolSizes;
-	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-
-	vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_MipmapsPool);
+void VulkanEngine::InitBloomDescriptors()
+{
+	Shader& downsampleShader = m_Shaders.at(ShaderName::DOWNSAMPLE);
+	const Shader& upsampleShader = m_Shaders.at(ShaderName::UPSAMPLE);
 
-	std::vector<VkDescriptorSetLayout> layouts(m_MipLevels - 1, downsampleShader->DescriptorLayout);
+	VkDescriptorImageInfo sourceInfo = {};
+	sourceInfo.imageView = m_HDRImage.ImageView;
+	sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	sourceInfo.sampler = m_RenderSampler;
 
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = m_MipmapsPool;
-	allocInfo.descriptorSetCount = m_MipLevels - 1;
-	allocInfo.pSetLayouts = layouts.data();
+	downsampleShader.Bind(0, DescriptorBinding(sourceInfo));
 
-	m_DownsampleDescriptorSets.resize(m_MipLevels - 1);
-	m_UpsampleDescriptorSets.resize(m_MipLevels - 1);
+	// Views of a previous, deeper pyramid must not be written again, the array is partially bound
+	downsampleShader.ArrayBindings.erase(1);
 
-	vkAllocateDescriptorSets(m_Device, &allocInfo, m_DownsampleDescriptorSets.data());
-	vkAllocateDescriptorSets(m_Device, &allocInfo, m_UpsampleDescriptorSets.data());
+	if (m_BloomMipViews.empty())
+		return;
 
-	for (uint32_t mip = 1; mip < m_MipLevels; mip++)
+	for (uint32_t mip = 0; mip < m_BloomMipLevels; mip++)
 	{
-		VkDescriptorImageInfo srcInfo = {};
-		srcInfo.imageView = m_MipmapImageViews[mip - 1];
-		srcInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		srcInfo.sampler = m_RenderSampler;
-
-		VkDescriptorImageInfo dstInfo = {};
-		dstInfo.imageView = m_MipmapImageViews[mip];
-		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		VkDescriptorImageInfo mipInfo = {};
+		mipInfo.imageView = m_BloomMipViews[mip];
+		mipInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-		VkWriteDescriptorSet writes[2] = {};
+		downsampleShader.BindArrayElement(1, mip, DescriptorBinding(mipInfo));
+	}
 
-		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[0].dstSet = m_DownsampleDescriptorSets[mip - 1];
-		writes[0].dstBinding = 0;
-		writes[0].descriptorCount = 1;
-		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writes[0].pImageInfo = &srcInfo;
+	UpdateDescriptorSets(downsampleShader);
 
-		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[1].dstSet = m_DownsampleDescriptorSets[mip - 1];
-		writes[1].dstBinding = 1;
-		writes[1].descriptorCount = 1;
-		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-		writes[1].pImageInfo = &dstInfo;
+	m_UpsampleDescriptorSets.resize(m_BloomMipLevels - 1);
 
-		vkUpdateDescriptorSets(m_Device, 2, writes, 0, nullptr);
+	for (uint32_t i = 0; i < m_BloomMipLevels - 1; i++)
+	{
+		m_UpsampleDescriptorSets[i] = m_DescriptorCache.Allocate(upsampleShader.DescriptorLayout);
 	}
 
-	for (int32_t mip = m_MipLevels - 2; mip >= 0; mip--)
+	for (int32_t mip = m_BloomMipLevels - 2; mip >= 0; mip--)
 	{
 		VkDescriptorImageInfo srcInfo = {};
-		srcInfo.imageView = m_MipmapImageViews[mip + 1];
-		srcInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		srcInfo.imageView = m_BloomMipViews[mip + 1];
+		srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 		srcInfo.sampler = m_RenderSampler;
 
 		VkDescriptorImageInfo dstInfo = {};
-		dstInfo.imageView = m_MipmapImageViews[mip];
+		dstInfo.imageView = m_BloomMipViews[mip];
 		dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
 		VkWriteDescriptorSet writes[2] = {};
@@ -1261,11 +2030,6 @@ void VulkanEngine::InitMitmapsResources()
 
 void VulkanEngine::InitSyncStructures()
 {
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCreateInfo.pNext = nullptr;
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphoreCreateInfo.pNext = nullptr;
@@ -1273,16 +2037,25 @@ void VulkanEngine::InitSyncStructures()
 
 	for (uint32_t i = 0; i < m_Frames.size(); i++)
 	{
-		vkCreateFence(m_Device, &fenceCreateInfo, nullptr, &m_Frames[i].RenderFence);
 		vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &m_Frames[i].SwapchainSemaphore);
 		vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &m_Frames[i].RenderSemaphore);
 	}
 
-	vkCreateFence(m_Device, &fenceCreateInfo, nullptr, &m_ImmediateFence);
+	VkSemaphoreTypeCreateInfo timelineCreateInfo = {};
+	timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo timelineSemaphoreInfo = semaphoreCreateInfo;
+	timelineSemaphoreInfo.pNext = &timelineCreateInfo;
+
+	vkCreateSemaphore(m_Device, &timelineSemaphoreInfo, nullptr, &m_ComputeTimeline);
+	vkCreateSemaphore(m_Device, &timelineSemaphoreInfo, nullptr, &m_GraphicsTimeline);
 
 	m_MainDeletionQueue.PushFunction([&]() -> void 
 		{
-			vkDestroyFence(m_Device, m_ImmediateFence, nullptr);
+			vkDestroySemaphore(m_Device, m_ComputeTimeline, nullptr);
+			vkDestroySemaphore(m_Device, m_GraphicsTimeline, nullptr);
 		});
 }
 
@@ -1308,31 +2081,35 @@ void VulkanEngine::InitCommands()
 		vkAllocateCommandBuffers(m_Device, &cmdAllocInfo, &m_Frames[i].MainCommandBuffer);
 	}
 
-	vkCreateCommandPool(m_Device, &commandPoolInfo, nullptr, &m_ImmediateCommandPool);
+	commandPoolInfo.queueFamilyIndex = m_ComputeQueueFamily;
 
-	VkCommandBufferAllocateInfo cmdAllocInfo{};
-	cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cmdAllocInfo.pNext = nullptr;
-	cmdAllocInfo.commandPool = m_ImmediateCommandPool;
-	cmdAllocInfo.commandBufferCount = 1;
-	cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	for (uint32_t i = 0; i < m_Frames.size(); i++)
+	{
+		vkCreateCommandPool(m_Device, &commandPoolInfo, nullptr, &m_Frames[i].ComputeCommandPool);
 
-	vkAllocateCommandBuffers(m_Device, &cmdAllocInfo, &m_ImmediateCommandBuffer);
+		VkCommandBufferAllocateInfo cmdAllocInfo{};
+		cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdAllocInfo.pNext = nullptr;
+		cmdAllocInfo.commandPool = m_Frames[i].ComputeCommandPool;
+		cmdAllocInfo.commandBufferCount = static_cast<uint32_t>(m_Frames[i].ComputeCommandBuffers.size());
+		cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-	m_MainDeletionQueue.PushFunction([&]() -> void
-	{
-		vkDestroyCommandPool(m_Device, m_ImmediateCommandPool, nullptr);
-	});
+		vkAllocateCommandBuffers(m_Device, &cmdAllocInfo, m_Frames[i].ComputeCommandBuffers.data());
+	}
 }
 
-void VulkanEngine::SwitchLuts(LUTType type)
+void VulkanEngine::SwitchLuts(uint32_t lutIndex)
 {
-	vkDeviceWaitIdle(m_Device);
+	if (lutIndex >= m_Luts.size() || lutIndex == m_SelectedLut)
+		return;
 
-	Shader& colorGradingShader = m_Shaders[ShaderName::COLOR_GRADING];
-	colorGradingShader.Bindings[0] = DescriptorBinding(m_Luts.at(type), m_RenderSampler, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	// Fade from whichever table dominates the image right now, switching mid-fade never jumps
+	const bool targetShown = m_Luts[m_SelectedLut].IsResident() && m_LutBlend >= 0.5f;
+	m_LutBlendSource = targetShown ? m_SelectedLut : m_LutBlendSource;
 
-	UpdateDescriptorSets(colorGradingShader);
+	m_SelectedLut = lutIndex;
+	m_LutBlend = 0.f;
+	RequestLut(lutIndex);
 }
 
 void VulkanEngine::InitSwapchain()
@@ -1363,27 +2140,13 @@ void VulkanEngine::InitDevices()
 
 	m_Instance = vkbInstance.instance;
 	m_DebugMessenger = vkbInstance.debug_messenger;
+	m_BootstrapInstance = vkbInstance;
 
 	glfwCreateWindowSurface(m_Instance, m_Window.get(), nullptr, &m_Surface);
 
-	VkPhysicalDeviceVulkan13Features features{};
-
-	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
-	features.dynamicRendering = true;
-	features.synchronization2 = true;
-
-	VkPhysicalDeviceVulkan12Features features12{};
-	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
-	features12.bufferDeviceAddress = true;
-	features12.descriptorIndexing = true;
-	features12.hostQueryReset = true;
-
-	vkb::PhysicalDeviceSelector selector(vkbInstance);
+	vkb::PhysicalDeviceSelector selector = CreateDeviceSelector(vkbInstance);
 	vkb::PhysicalDevice physicalDevice =
-		selector.set_minimum_version(1, 3)
-		.set_surface(m_Surface)
-		.set_required_features_13(features)
-		.set_required_features_12(features12)
+		selector.set_surface(m_Surface)
 		.select()
 		.value();
 
@@ -1395,6 +2158,24 @@ void VulkanEngine::InitDevices()
 	m_PhysicalDevice = physicalDevice.physical_device;
 
 	m_GraphicsQueue = vkbDevice.get_queue(vkb::QueueType::graphics).value();
+	m_GraphicsQueueFamily = vkbDevice.get_queue_index(vkb::QueueType::graphics).value();
+
+	// Without a family apart from graphics the compute passes go through the graphics queue, the synchronization stays the same
+	if (const auto computeFamily = vkbDevice.get_queue_index(vkb::QueueType::compute))
+	{
+		m_ComputeQueue = vkbDevice.get_queue(vkb::QueueType::compute).value();
+		m_ComputeQueueFamily = computeFamily.value();
+	}
+	else
+	{
+		m_ComputeQueue = m_GraphicsQueue;
+		m_ComputeQueueFamily = m_GraphicsQueueFamily;
+	}
+
+	m_ComputeGraph.Init(m_ComputeQueueFamily);
+	m_GraphicsGraph.Init(m_GraphicsQueueFamily);
+
+	m_DescriptorCache.Init(m_Device);
 
 	VmaAllocatorCreateInfo allocatorCreateInfo{};
 	allocatorCreateInfo.physicalDevice = m_PhysicalDevice;
@@ -1408,6 +2189,54 @@ void VulkanEngine::InitDevices()
 		{
 			vmaDestroyAllocator(m_Allocator);
 		});
+
+	// A transfer-only family copies without taking time from either queue, uploads only feed the compute passes
+	const auto transferFamily = vkbDevice.get_queue_index(vkb::QueueType::transfer);
+	const VkQueue transferQueue = transferFamily ? vkbDevice.get_queue(vkb::QueueType::transfer).value() : m_ComputeQueue;
+
+	m_Uploads.Init(m_Device, m_Allocator, transferQueue, transferFamily ? transferFamily.value() : m_ComputeQueueFamily, m_ComputeQueueFamily,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+	m_MainDeletionQueue.PushFunction([&]() -> void
+		{
+			m_Uploads.Cleanup();
+		});
+}
+
+std::vector<std::unique_ptr<TraceDevice>> VulkanEngine::CreateTraceDevices(const bool includeSoftware) const
+{
+	std::vector<std::unique_ptr<TraceDevice>> devices;
+
+	// Trace devices never present, any device with the features of the engine qualifies
+	vkb::PhysicalDeviceSelector selector = CreateDeviceSelector(m_BootstrapInstance);
+	const auto candidates = selector.require_present(false).select_devices();
+
+	if (!candidates)
+	{
+		std::println("Failed to enumerate trace devices: {}", candidates.error().message());
+		return devices;
+	}
+
+	for (const vkb::PhysicalDevice& physicalDevice : candidates.value())
+	{
+		if (physicalDevice.physical_device == m_PhysicalDevice)
+			continue;
+
+		if (physicalDevice.properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU && !includeSoftware)
+			continue;
+
+		auto device = std::make_unique<TraceDevice>();
+
+		if (!device->Init(m_Instance, physicalDevice, m_PathToShaders / "compiled" / "ray_tracing.spv"))
+		{
+			device->Cleanup();
+			continue;
+		}
+
+		devices.push_back(std::move(device));
+	}
+
+	return devices;
 }
 
 AllocatedImage VulkanEngine::CreateImage(VkExtent3D size, VkImageType type, VkFormat format, VkImageUsageFlags usage, uint32_t mipLevels) const
@@ -1534,12 +2363,12 @@ void VulkanEngine::CreateTimestampQueryPool()
 	VkQueryPoolCreateInfo queryPoolInfo{};
 	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
 	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
-	queryPoolInfo.queryCount = 2;
+	queryPoolInfo.queryCount = s_TimestampCount;
 
 	for (auto& frame : m_Frames)
 	{
 		vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &frame.TimestampQueryPool);
-		vkResetQueryPool(m_Device, frame.TimestampQueryPool, 0, 2);
+		vkResetQueryPool(m_Device, frame.TimestampQueryPool, 0, s_TimestampCount);
 	}
 }
 
@@ -1548,6 +2377,21 @@ FrameData& VulkanEngine::GetCurrentFrame()
 	return m_Frames[m_FrameNumber % m_Frames.size()];
 }
 
+void VulkanEngine::WaitForTimeline(VkSemaphore timeline, uint64_t value) const
+{
+	VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timeline;
+	waitInfo.pValues = &value;
+
+	vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX);
+}
+
+void VulkanEngine::Retire(std::function<void()>&& deletor)
+{
+	m_RetireQueue.PushFunction(m_GraphicsTimelineValue + 1, std::move(deletor));
+}
+
 void VulkanEngine::DestroyImage(AllocatedImage& image) const
 {
 	if (image.Image != VK_NULL_HANDLE) 
@@ -1558,47 +2402,13 @@ void VulkanEngine::DestroyImage(AllocatedImage& image) const
 	}
 }
 
-void VulkanEngine::ResetAccumulation() const
-{
-	const VkCommandBuffer cmd = m_ImmediateCommandBuffer;
-	vkResetCommandBuffer(cmd, 0);
-
-	constexpr VkCommandBufferBeginInfo beginInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.pNext = nullptr,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-		.pInheritanceInfo = nullptr
-	};
-
-	vkBeginCommandBuffer(cmd, &beginInfo);
-
-	constexpr VkClearColorValue clearColor = { {0.0f, 0.0f, 0.0f, 0.0f } };
-
-	constexpr VkImageSubresourceRange range
-	{
-		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-		.baseMipLevel = 0,
-		.levelCount = 1,
-		.baseArrayLayer = 0,
-		.layerCount = 1
-	};
-
-	vkCmdClearColorImage(cmd, m_AccumulationImage.Image, VK_IMAGE_LAYOUT_GENERAL, &clearColor, 1, &range);
-
-	vkEndCommandBuffer(cmd);
-
-	vkResetFences(m_Device, 1, &m_ImmediateFence);
-	VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmd;
-	vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_ImmediateFence);
-	vkWaitForFences(m_Device, 1, &m_ImmediateFence, VK_TRUE, UINT64_MAX);
-}
-
 void VulkanEngine::DestroySwapchain()
 {
 	vkDestroySwapchainKHR(m_Device, m_Swapchain, nullptr);
+
+	for (const VkImage swapchainImage : m_SwapchainImages)
+		m_GraphicsGraph.ForgetImage(swapchainImage);
+
 	for (auto& swapchainImageView : m_SwapchainImageViews)
 	{
 		vkDestroyImageView(m_Device, swapchainImageView, nullptr);
@@ -1611,63 +2421,69 @@ void VulkanEngine::Cleanup()
 {
 	if (IsInitialized)
 	{
+		if (m_ShaderReloadFuture.valid())
+		{
+			for (auto& shader : m_ShaderReloadFuture.get() | std::views::values)
+			{
+				shader.Destroy(m_Device);
+			}
+		}
+
 		vkDeviceWaitIdle(m_Device);
 
+		if (m_Readback)
+			vmaDestroyBuffer(m_Allocator, m_Readback->Buffer.Buffer, m_Readback->Buffer.Allocation);
+
+		RetireRenderTargets();
+		m_RetireQueue.Flush(std::numeric_limits<uint64_t>::max());
+
 		vkDestroySampler(m_Device, m_RenderSampler, nullptr);
 
-		for (const auto& shader : m_Shaders)
+		for (auto& shader : m_Shaders | std::views::values)
 		{
-			shader.second.Destroy(m_Device);
+			DestroyShader(shader);
 		}
 
 		for (const auto& frame : m_Frames)
 		{
 			vkDestroyCommandPool(m_Device, frame.CommandPool, nullptr);
-			vkDestroyFence(m_Device, frame.RenderFence, nullptr);
+			vkDestroyCommandPool(m_Device, frame.ComputeCommandPool, nullptr);
 			vkDestroySemaphore(m_Device, frame.RenderSemaphore, nullptr);
 			vkDestroySemaphore(m_Device, frame.SwapchainSemaphore, nullptr);
 			vkDestroyQueryPool(m_Device, frame.TimestampQueryPool, nullptr);
+			vmaDestroyBuffer(m_Allocator, frame.StagingBuffer.Buffer, frame.StagingBuffer.Allocation);
 		}
 
 		vmaDestroyBuffer(m_Allocator, UniformBuffer.Buffer, UniformBuffer.Allocation);
-		vmaDestroyBuffer(m_Allocator, SphereBuffer.Buffer, SphereBuffer.Allocation);
+		vmaDestroyBuffer(m_Allocator, SpherePositionBuffer.Buffer, SpherePositionBuffer.Allocation);
+		vmaDestroyBuffer(m_Allocator, SphereRadiusBuffer.Buffer, SphereRadiusBuffer.Allocation);
+		vmaDestroyBuffer(m_Allocator, SphereMaterialIndexBuffer.Buffer, SphereMaterialIndexBuffer.Allocation);
 		vmaDestroyBuffer(m_Allocator, MaterialBuffer.Buffer, MaterialBuffer.Allocation);
+		vmaDestroyBuffer(m_Allocator, BloomCounterBuffer.Buffer, BloomCounterBuffer.Allocation);
+		vmaDestroyBuffer(m_Allocator, m_MergeBuffer.Buffer, m_MergeBuffer.Allocation);
 
-		vkDestroyImageView(m_Device, m_LDRImage.ImageView, nullptr);
-		vkDestroyImageView(m_Device, m_HDRImage.ImageView, nullptr);
-		vkDestroyImageView(m_Device, m_AccumulationImage.ImageView, nullptr);
-
-		for(auto& lut : m_Luts | std::views::values)
+		for (LutSlot& lut : m_Luts)
 		{
-			vkDestroyImageView(m_Device, lut.ImageView, nullptr);
-			DestroyImage(lut);
-		}
+			if (lut.IsLoading())
+				lut.PendingLoad.wait();
 
-		for (const auto& mipView : m_MipmapImageViews)
-		{
-			vkDestroyImageView(m_Device, mipView, nullptr);
+			if (lut.Image.Image != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(m_Device, lut.Image.ImageView, nullptr);
+				DestroyImage(lut.Image);
+			}
 		}
 
-		DestroyImage(m_LDRImage);
-		DestroyImage(m_HDRImage);
-		DestroyImage(m_AccumulationImage);
+		vkDestroyImageView(m_Device, m_IdentityLut.ImageView, nullptr);
+		DestroyImage(m_IdentityLut);
+
+		m_DescriptorCache.Cleanup();
 
 		m_MainDeletionQueue.Flush();
 
 		DestroySwapchain();
 
-		for(auto& descSet : m_DownsampleDescriptorSets)
-		{
-			vkFreeDescriptorSets(m_Device, m_MipmapsPool, 1, &descSet);
-		}
-
-		for (auto& descSet : m_UpsampleDescriptorSets)
-		{
-			vkFreeDescriptorSets(m_Device, m_MipmapsPool, 1, &descSet);
-		}
-
 		vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
-		vkDestroyDescriptorPool(m_Device, m_MipmapsPool, nullptr);
 		vkDestroyDescriptorPool(m_Device, m_ImGuiPool, nullptr);
 
 		vkDestroyDevice(m_Device, nullptr);
@@ -1675,7 +2491,8 @@ void VulkanEngine::Cleanup()
 		vkb::destroy_debug_utils_messenger(m_Instance, m_DebugMessenger, nullptr);
 		vkDestroyInstance(m_Instance, nullptr);
 
-		m_FileWatcher.Stop();
+		m_FileWatcher->Stop();
+		m_FileWatcherFuture.wait();
 		IsInitialized = false;
 	}
 }
\ No newline at end of file
@@ -9,6 +9,10 @@
 #include <fstream>
 #include <future>
 #include <thread>
+#include <mutex>
+#include <limits>
+#include <string_view>
+#include <optional>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -22,6 +26,11 @@
 
 #include "VkBootstrap.h"
 #include "VulkanTypes.h"
+#include "ComputeShader.h"
+#include "DescriptorCache.h"
+#include "FrameGraph.h"
+#include "TraceDevice.h"
+#include "UploadManager.h"
 #include "../FileWatcher.h"
 
 
@@ -31,27 +40,82 @@ public:
 	VulkanEngine() = default;
 
 	void Init(const std::shared_ptr<GLFWwindow>& window); 
-	void DrawFrame(bool dispatchCompute = false);
+	// Traces the tiles back to back, while accumulating each adds one sample to its pixels. Without presentation only
+	// the accumulation passes run, the window keeps showing the last presented frame.
+	void DrawFrame(bool dispatchCompute, std::span<const TraceTile> tiles, bool present = true);
 	void OnWindowResize(uint32_t width, uint32_t height);
 	void SetViewportSize(uint32_t width, uint32_t height);
 	void ReloadShaders();
+	[[nodiscard]] bool ConsumeShadersReloaded() { return m_ShadersReloaded.exchange(false); }
 
 	[[nodiscard]] ImTextureID GetRenderTextureID() const { return m_RenderTextureData.GetTexID(); }
+	// The viewport covers the top left part of the pooled targets, the texture is drawn with this as its max UV
+	[[nodiscard]] ImVec2 GetRenderTextureUV() const;
+	[[nodiscard]] bool ConsumeViewportResized() { return std::exchange(m_ViewportResized, false); }
 	[[nodiscard]] VmaAllocator GetAllocator() const { return m_Allocator; }
 	[[nodiscard]] float GetRenderTime() const { return m_RenderTime; }
+	[[nodiscard]] const PassTimings& GetPassTimings() const { return m_PassTimings; }
 
+	void SetAccumulationEnabled(bool enabled) { m_AccumulationEnabled = enabled; }
 	void SetBloomEnabled(bool enabled) { m_BloomEnabled = enabled; }
 	void SetColorGradingEnabled(bool enabled) { m_ColorGradingEnabled = enabled; }
-
-	void SwitchLuts(LUTType type);
-
-	void ResetAccumulation() const;
+	void SetExposure(float exposure) { m_Exposure = exposure; }
+	void SetBloomRadius(float radius) { m_BloomRadius = radius; }
+
+	// Renders into the top left corner of the full viewport sized targets, so the scale can change every frame
+	// without reallocating. Below 1 the post process output is upscaled to the viewport.
+	void SetRenderScale(float scale) { m_RenderScale = glm::clamp(scale, s_MinRenderScale, 1.f); }
+	[[nodiscard]] float GetRenderScale() const { return m_RenderScale; }
+	[[nodiscard]] glm::uvec2 GetRenderExtent() const;
+	// Rebuilds the bloom pyramid at the start of the next frame
+	void SetBloomMaxDepth(uint32_t depth) { m_BloomMaxDepth = depth; m_RebuildRenderTargets = true; }
+
+	// Only the selected table is resident up front, others stream in on a worker thread when they are picked.
+	// Switching cross-fades from the current table once the new one is resident.
+	void SwitchLuts(uint32_t lutIndex);
+	void SetLutTransitionTime(float seconds) { m_LutTransitionSeconds = seconds; }
+	[[nodiscard]] std::span<const std::string> GetLutNames() const { return m_LutNames; }
+	[[nodiscard]] uint32_t GetSelectedLut() const { return m_SelectedLut; }
+	[[nodiscard]] bool IsLutStreaming() const { return m_SelectedLut < m_Luts.size() && !m_Luts[m_SelectedLut].IsResident(); }
+
+	// Grows the scene buffers when needed and binds exactly the used range, so the shader sees the real counts
+	void ResizeSceneBuffers(uint32_t sphereCount, uint32_t materialCount);
+	// Replaces the start of a buffer the compute passes read. The bytes are copied on the compute queue ahead of the
+	// next traced frame, frames still in flight keep reading the previous contents.
+	void StageBufferWrite(const AllocatedBuffer& buffer, std::span<const std::byte> bytes);
+
+	// Recorded into the next frame, nothing waits for the device
+	void ResetAccumulation() { m_AccumulationNeedsClear = true; m_PendingRestore.reset(); m_PendingMerges.clear(); }
+	// Blocks until the GPU finished every submitted frame
+	void WaitForFrames() const { WaitForTimeline(m_GraphicsTimeline, m_GraphicsTimelineValue); }
+
+	// Random sequence of the accumulation, renders of the same image with different seeds can be merged
+	void SetAccumulationSeed(uint32_t seed) { m_AccumulationSeed = seed; }
+	// Copies the accumulated sums of the render extent to the host after the tiles of the next traced frame
+	void RequestAccumulationReadback() { m_ReadbackRequested = true; }
+	// Sums of the last requested readback once the GPU wrote them
+	[[nodiscard]] std::optional<AccumulationData> ConsumeAccumulationReadback();
+	// Reads the sums back right away and waits for them, e.g. for a last checkpoint before shutting down
+	[[nodiscard]] std::optional<AccumulationData> ReadAccumulation();
+	// Replaces the accumulated sums before the tiles of the next traced frame, the extent has to match the render extent
+	void RestoreAccumulation(AccumulationData data) { m_PendingRestore = std::move(data); }
+	// Adds sums traced on a trace device to the region at offset before the tiles of the next traced frame
+	void MergeAccumulation(AccumulationData data, glm::uvec2 offset) { m_PendingMerges.push_back({ offset, std::move(data) }); }
+	[[nodiscard]] bool HasPendingMerges() const { return !m_PendingMerges.empty(); }
+
+	// One trace device on every other physical device that has the features of the engine. Software devices like
+	// lavapipe only with includeSoftware, they take CPU time from the threads feeding the GPUs. The devices share the
+	// instance of the engine and have to be cleaned up before it.
+	[[nodiscard]] std::vector<std::unique_ptr<TraceDevice>> CreateTraceDevices(bool includeSoftware) const;
 	void Cleanup();
 public:
 	bool IsInitialized = false;
 	AllocatedBuffer UniformBuffer;
-	AllocatedBuffer SphereBuffer;
+	AllocatedBuffer SpherePositionBuffer;
+	AllocatedBuffer SphereRadiusBuffer;
+	AllocatedBuffer SphereMaterialIndexBuffer;
 	AllocatedBuffer MaterialBuffer;
+	AllocatedBuffer BloomCounterBuffer;
 private:
 	[[nodiscard]] AllocatedImage CreateImage(VkExtent3D size, VkImageType type, VkFormat format, VkImageUsageFlags usage, uint32_t mipLevels) const;
 	[[nodiscard]] AllocatedBuffer CreateBuffer(size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) const;
@@ -59,7 +123,15 @@ private:
 	void CreateImageView(AllocatedImage& image, VkImageViewType type, const VkFormat format, uint32_t mipLevels) const;
 
 	void RecreateSwapchain(uint32_t width, uint32_t height);
-	void RecreateRenderTargets();
+	// Reallocates the targets once a larger viewport has settled, or when the bloom depth changed
+	void UpdateRenderTargets();
+	// Destroys the targets once the frames in flight are done with them, the accumulation can stay in place
+	void RetireRenderTargets(bool keepAccumulation = false);
+	void ApplyViewportSize();
+	// Swaps in a freshly allocated set, frames in flight keep the old one bound until their fence
+	void RenewDescriptorSet(Shader& shader);
+	// Images packed into one allocation, images whose passes don't overlap share memory
+	[[nodiscard]] VmaAllocation CreateTransientImages(std::span<const TransientImageInfo> infos, std::span<AllocatedImage> outImages) const;
 
 	void DrawImGui(VkCommandBuffer cmd, VkImageView targetImageView) const;
 
@@ -69,28 +141,60 @@ private:
 	void InitSyncStructures();
 	void InitImGui();
 	void InitShaders();
-	void InitRenderTargets();
+	void InitRenderTargets(bool keepAccumulation = false);
 	void InitBuffers();
-	void InitMitmapsResources();
+	[[nodiscard]] uint32_t GetBloomMipLevels(VkExtent3D bloomExtent) const;
+	void InitBloomViews();
+	void InitBloomDescriptors();
 	void InitLuts();
-
-	void CreateLUT(AllocatedImage& lutImage, const std::filesystem::path& pathToLut, LUTType type);
-
-	void RayTrace(VkCommandBuffer cmd, uint32_t gx, uint32_t gy);
-	void Upsample(VkCommandBuffer cmd, VkImage image, int32_t width, int32_t height, uint32_t mipLevels);
-	void Downsample(VkCommandBuffer cmd, VkImage image, int32_t width, int32_t height, uint32_t mipLevels);
-	void ToneMap(VkCommandBuffer cmd, uint32_t gx, uint32_t gy);
-	void ColorGrade(VkCommandBuffer cmd, uint32_t gx, uint32_t gy);
-
+	void RequestLut(uint32_t lutIndex);
+	void UpdateLuts();
+	void EvictLuts();
+	[[nodiscard]] uint32_t GetLutDescriptor(uint32_t lutIndex) const;
+	[[nodiscard]] LutBlendConstants GetLutBlend() const;
+	// Returns the upload value the table is ready at
+	// Empty if the upload couldn't be staged, the image is created either way
+	[[nodiscard]] std::optional<uint64_t> UploadLut(const CubeLut& lut, AllocatedImage& outImage);
+
+	// Records and submits the compute passes of the frame to the compute queue, with display the display image is released to the graphics queue
+	void SubmitCompute(FrameData& frame, std::span<const TraceTile> tiles, bool display);
+	// Declares the compute passes of the frame with the resources they touch, the graph places the barriers.
+	// Without display the post processing chain has no consumer and is culled.
+	void AddComputePasses(VkQueryPool timestampPool, std::span<const TraceTile> tiles, bool display);
+	// Only orders the graphics timeline behind the compute work of a frame that isn't presented
+	void SubmitGraphicsSignal(FrameData& frame);
+	// Copies the accumulation image into a host buffer that the compute timeline value of the recorded submission makes readable
+	void AddReadbackPass(FrameResource accumulationImage, glm::uvec2 extent);
+	void AddRestorePass(FrameResource accumulationImage, glm::uvec2 extent);
+	// Adds the pending merges to the accumulation, one pass each since their regions may overlap
+	void AddMergePasses(FrameResource accumulationImage, glm::uvec2 extent);
+	// Traces the tile, or with resolve averages the accumulated samples of the tile into the HDR image
+	void RayTrace(VkCommandBuffer cmd, const TraceTile& tile, bool resolve);
+	void MergeAccumulationRegion(VkCommandBuffer cmd, const AccumulationMergeConstants& constants);
+	void Upsample(VkCommandBuffer cmd, uint32_t width, uint32_t height, uint32_t mipLevels);
+	// Builds every bloom mip from the HDR image in a single dispatch, see downsample.comp
+	void Downsample(VkCommandBuffer cmd, uint32_t width, uint32_t height);
+	// Bloom composite, LUT grading, exposure, ACES and gamma in one pass from HDR to LDR
+	void PostProcess(VkCommandBuffer cmd, uint32_t width, uint32_t height, bool bloom, bool upscale);
+	void Upscale(VkCommandBuffer cmd, glm::uvec2 renderExtent);
+
+	void BindRenderTargets();
+	void BindSceneBuffers();
+	// Writes still staged for the old buffer are dropped
+	void GrowBuffer(AllocatedBuffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage);
+	// Copies the staged writes through the staging of the frame, ordered behind the reads of earlier submissions
+	void RecordBufferWrites(FrameData& frame, VkCommandBuffer cmd);
 	void UpdateDescriptorSets(const Shader& shader) const;
+	void UpdateDescriptorArrayElement(const Shader& shader, uint32_t binding, uint32_t element) const;
 
 	void CreateTimestampQueryPool();
 	void UpdateTimings();
 
-	void CreateShader(const ShaderName& shaderName,
-		const std::vector<DescriptorBinding>& bindings,
-		VkPushConstantRange* pushConstantRange,
-		const std::filesystem::path& path);
+	void CreateShader(const ShaderName& shaderName, const std::filesystem::path& path);
+	[[nodiscard]] bool BuildShader(const std::filesystem::path& path, Shader& outShader);
+	void UpdateShaderReload();
+	void SwapShader(ShaderName shaderName, Shader& newShader);
+	void DestroyShader(Shader& shader);
 
 	void CreateSwapchain(uint32_t width, uint32_t height);
 	void DestroySwapchain();
@@ -99,9 +203,14 @@ private:
 	void MonitorShaders();
 
 	FrameData& GetCurrentFrame();
+	void WaitForTimeline(VkSemaphore timeline, uint64_t value) const;
+	// Runs the deletor once everything submitted so far is done, the next graphics submission waits for all compute work before it
+	void Retire(std::function<void()>&& deletor);
 private:
 	std::shared_ptr<GLFWwindow> m_Window;
 	VkInstance m_Instance;
+	// Kept to select the trace devices later on
+	vkb::Instance m_BootstrapInstance;
 	VkPhysicalDevice m_PhysicalDevice;
 	VkDevice m_Device;
 	VkSurfaceKHR m_Surface;
@@ -109,6 +218,16 @@ private:
 	uint32_t m_ViewportWidth = 0;
 	uint32_t m_ViewportHeight = 0;
 
+	// Targets are pooled at a coarse capacity and never shrink, a viewport that fits is rendered into their top left corner.
+	// Growing waits until the requested size has been stable for a moment, meanwhile the viewport is clamped and stretched.
+	static constexpr uint32_t s_TargetGranularity = 256;
+	static constexpr std::chrono::milliseconds s_ResizeDebounce{ 150 };
+	glm::uvec2 m_TargetCapacity = { 1280, 768 };
+	glm::uvec2 m_RequestedViewport = { 0, 0 };
+	std::chrono::steady_clock::time_point m_ResizeRequestTime;
+	bool m_RebuildRenderTargets = false;
+	bool m_ViewportResized = false;
+
 	VkSwapchainKHR m_Swapchain;
 	VkFormat m_SwapchainImageFormat;
 	VkExtent2D m_SwapchainExtent;
@@ -121,26 +240,108 @@ private:
 
 	VkQueue m_GraphicsQueue;
 	uint32_t m_GraphicsQueueFamily = 0;
+	// A family without graphics if the device has one, so tracing runs next to the UI. Otherwise the graphics queue.
+	VkQueue m_ComputeQueue;
+	uint32_t m_ComputeQueueFamily = 0;
+
+	// Values of the last submission on each queue. The graphics queue waits for the display image,
+	// the compute queue waits until the previous UI stopped sampling it before writing it again.
+	VkSemaphore m_ComputeTimeline;
+	uint64_t m_ComputeTimelineValue = 0;
+	VkSemaphore m_GraphicsTimeline;
+	uint64_t m_GraphicsTimelineValue = 0;
 
 	VmaAllocator m_Allocator;
 
 	AllocatedImage m_LDRImage;
 	AllocatedImage m_HDRImage;
 	AllocatedImage m_AccumulationImage;
-
-	std::unordered_map<LUTType, AllocatedImage> m_Luts;
-
-	std::vector<VkImageView> m_MipmapImageViews;
-	std::vector<VkDescriptorSet> m_DownsampleDescriptorSets;
+	// Post process output at the render resolution, read by the upscale pass
+	AllocatedImage m_ScaledLDRImage;
+	// Backs the HDR, scaled and bloom images, which are rewritten every frame
+	VmaAllocation m_TransientAllocation = VK_NULL_HANDLE;
+	bool m_AccumulationNeedsClear = true;
+	bool m_AccumulationEnabled = false;
+	uint32_t m_AccumulationSeed = 0;
+
+	// Copy of the accumulation image on its way to the host
+	struct AccumulationReadback
+	{
+		AllocatedBuffer Buffer;
+		glm::uvec2 Extent;
+		uint64_t ComputeValue;
+	};
+
+	std::optional<AccumulationReadback> m_Readback;
+	bool m_ReadbackRequested = false;
+	std::optional<AccumulationData> m_PendingRestore;
+
+	struct PendingMerge
+	{
+		glm::uvec2 Offset;
+		AccumulationData Data;
+	};
+
+	std::vector<PendingMerge> m_PendingMerges;
+	// Sums of the merges of a frame back to back, written through the staged writes
+	AllocatedBuffer m_MergeBuffer;
+
+	struct PendingBufferWrite
+	{
+		VkBuffer Buffer;
+		std::vector<std::byte> Bytes;
+	};
+
+	// At most one per buffer, a later write replaces the earlier one
+	std::vector<PendingBufferWrite> m_PendingBufferWrites;
+
+	static constexpr float s_MinRenderScale = 0.5f;
+	float m_RenderScale = 1.f;
+
+	// A few tables stay resident so switching back and forth doesn't reload, everything else is evicted.
+	// Descriptors of evicted tables are recycled once the frames in flight are done, so the array holds more slots than resident tables.
+	static constexpr uint32_t s_MaxResidentLuts = 4;
+	static constexpr uint32_t s_LutDescriptorCount = 8; // MAX_LUTS in post_process.comp
+	static constexpr uint32_t s_IdentityLutDescriptor = 0;
+	static constexpr uint32_t s_NoLut = std::numeric_limits<uint32_t>::max();
+	static constexpr std::string_view s_DefaultLutName = "cinematic";
+
+	std::vector<LutSlot> m_Luts;
+	std::vector<std::string> m_LutNames;
+	std::vector<uint32_t> m_FreeLutDescriptors;
+	AllocatedImage m_IdentityLut;
+
+	uint32_t m_SelectedLut = 0;
+	uint32_t m_LutBlendSource = s_NoLut;
+	float m_LutBlend = 1.f;
+	float m_LutTransitionSeconds = 0.5f;
+	std::chrono::steady_clock::time_point m_LastLutUpdate = std::chrono::steady_clock::now();
+
+	uint32_t m_SphereCount = 0;
+	uint32_t m_MaterialCount = 0;
+
+	// Half resolution pyramid in its own packed float format, the HDR image keeps a single mip.
+	// Zero levels means the format isn't usable as a storage image and bloom is skipped.
+	AllocatedImage m_BloomImage;
+	std::vector<VkImageView> m_BloomMipViews;
 	std::vector<VkDescriptorSet> m_UpsampleDescriptorSets;
-	VkDescriptorPool m_MipmapsPool;
-	uint32_t m_MipLevels = 0;
+	uint32_t m_BloomMipLevels = 0;
+	uint32_t m_BloomMaxDepth = s_DefaultBloomDepth;
+	float m_BloomRadius = 1.f;
 
-	VkFence m_ImmediateFence;
-	VkCommandBuffer m_ImmediateCommandBuffer;
-	VkCommandPool m_ImmediateCommandPool;
+	// MAX_MIPS and WORKGROUP_MIPS in downsample.comp, a workgroup reduces a 64x64 block of the HDR image to one texel of bloom mip 5
+	static constexpr uint32_t s_MaxBloomMips = 12;
+	static constexpr uint32_t s_WorkgroupBloomMips = 6;
+	static constexpr uint32_t s_BloomTileSize = 64;
+	static constexpr uint32_t s_DefaultBloomDepth = 7;
+	static constexpr VkFormat s_BloomFormat = VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+
+	UploadManager m_Uploads;
 
 	std::unordered_map<ShaderName, Shader> m_Shaders;
+	DescriptorCache m_DescriptorCache;
+	FrameGraph m_ComputeGraph;
+	FrameGraph m_GraphicsGraph;
 
 	VkDebugUtilsMessengerEXT m_DebugMessenger;
 
@@ -148,20 +349,30 @@ private:
 	ImTextureData m_RenderTextureData;
 	VkSampler m_RenderSampler;
 
+	// Start of the frame, then the end of ray tracing, bloom, post processing and upscaling
+	static constexpr uint32_t s_TimestampCount = 5;
+
 	float m_RenderTime;
+	PassTimings m_PassTimings;
 
 	DeletionQueue m_MainDeletionQueue;
+	// Keyed by graphics timeline values
+	TimelineDeletionQueue m_RetireQueue;
 
-	FileWatcher m_FileWatcher;
+	std::unique_ptr<FileWatcher> m_FileWatcher;
 	std::future<void> m_FileWatcherFuture;
 
+	std::mutex m_ShaderReloadMutex;
 	std::vector<std::string> m_ChangedShaderFiles;
 	std::atomic<bool> m_ShadersNeedReload = false;
+	std::atomic<bool> m_ShadersReloaded = false;
+	std::future<std::vector<std::pair<ShaderName, Shader>>> m_ShaderReloadFuture;
 
 	std::filesystem::path m_PathToShaders = std::filesystem::current_path().parent_path() / "shaders";
 	std::filesystem::path m_PathToLuts = std::filesystem::current_path().parent_path() / "luts";
 
 	bool m_BloomEnabled = true;
 	bool m_ColorGradingEnabled = true;
+	float m_Exposure = 1.5f;
 	bool m_ShouldRecreateSwapchain = false;
 };
\ No newline at end of file
@@ -1,29 +1,32 @@
 #pragma once
 
+#include <array>
 #include <deque>
+#include <filesystem>
 #include <functional>
+#include <future>
+#include <map>
+#include <optional>
 #include <ranges>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 #include <glm.hpp>
 
+#include "ShaderReflection.h"
+#include "../Material.h"
+#include "../CubeLut.h"
+
 enum class ShaderName : uint8_t
 {
 	NONE,
 	RAY_TRACING,
 	DOWNSAMPLE,
 	UPSAMPLE,
-	TONE_MAPPING,
-	COLOR_GRADING
-};
-
-enum class LUTType : uint8_t
-{
-	NONE,
-	CINEMATIC,
-	DAY_NIGHT,
-	CINEDRAMA
+	POST_PROCESS,
+	UPSCALE,
+	ACCUMULATION_MERGE
 };
 
 struct DeletionQueue
@@ -39,24 +42,31 @@ struct DeletionQueue
 		{
 			func();
 		}
+
+		Deletors.clear();
 	}
 
 	std::deque<std::function<void()>> Deletors;
 };
 
-
-struct FrameData
+// Deletors run once a timeline semaphore reached the value they were pushed with, values are pushed in increasing order
+struct TimelineDeletionQueue
 {
-	VkCommandPool CommandPool;
-	VkCommandBuffer MainCommandBuffer;
-
-	VkSemaphore SwapchainSemaphore;
-	VkSemaphore RenderSemaphore;
-	VkFence RenderFence;
+	void PushFunction(uint64_t value, std::function<void()>&& function)
+	{
+		Deletors.emplace_back(value, std::move(function));
+	}
 
-	VkQueryPool TimestampQueryPool;
+	void Flush(uint64_t completedValue)
+	{
+		while (!Deletors.empty() && Deletors.front().first <= completedValue)
+		{
+			Deletors.front().second();
+			Deletors.pop_front();
+		}
+	}
 
-	DeletionQueue DataDeletionQueue;
+	std::deque<std::pair<uint64_t, std::function<void()>>> Deletors;
 };
 
 
@@ -67,6 +77,31 @@ struct AllocatedBuffer
 	VmaAllocationInfo Info;
 };
 
+
+struct FrameData
+{
+	VkCommandPool CommandPool;
+	VkCommandBuffer MainCommandBuffer;
+
+	// Recorded for the compute queue, [0] traces and [1] writes the display image once the UI stopped sampling it
+	VkCommandPool ComputeCommandPool;
+	std::array<VkCommandBuffer, 2> ComputeCommandBuffers;
+
+	VkSemaphore SwapchainSemaphore;
+	VkSemaphore RenderSemaphore;
+	// Graphics timeline value of the frame's last submission, its command buffers are free again once it is reached
+	uint64_t GraphicsTimelineValue = 0;
+
+	VkQueryPool TimestampQueryPool;
+	// Pixel samples traced by the frame's compute submission, the ray tracing timestamps cover all of them
+	uint64_t TracedPixels = 0;
+
+	// Compute timeline value of the frame's last compute submission, its command buffers and staging are free again once it is reached
+	uint64_t ComputeTimelineValue = 0;
+	// Host writes of buffers the compute passes read, copied on the compute queue ahead of the frame's passes
+	AllocatedBuffer StagingBuffer = {};
+};
+
 struct AllocatedImage
 {
 	VkImage Image;
@@ -76,6 +111,137 @@ struct AllocatedImage
 	VkFormat ImageFormat;
 };
 
+// Order of the passes in a frame, transient images are only alive between their first and last pass
+enum class FramePass : uint8_t
+{
+	RAY_TRACING,
+	BLOOM,
+	POST_PROCESS,
+	UPSCALE
+};
+
+struct TransientImageInfo
+{
+	VkExtent3D Extent;
+	VkFormat Format;
+	VkImageUsageFlags Usage;
+	uint32_t MipLevels;
+	FramePass FirstPass;
+	FramePass LastPass;
+};
+
+// One .cube file from the LUT directory, its image only exists while the table is resident
+struct LutSlot
+{
+	std::filesystem::path Path;
+	AllocatedImage Image{};
+	uint32_t DescriptorIndex = 0;
+	std::future<std::optional<CubeLut>> PendingLoad;
+	// Upload value the image is ready at, zero once the image is bound
+	uint64_t UploadValue = 0;
+	uint64_t LastUsedFrame = 0;
+
+	[[nodiscard]] bool IsResident() const { return Image.Image != VK_NULL_HANDLE && !IsUploading(); }
+	[[nodiscard]] bool IsLoading() const { return PendingLoad.valid(); }
+	[[nodiscard]] bool IsUploading() const { return UploadValue != 0; }
+};
+
+// Color grading samples LUTs[FromLut] and LUTs[ToLut] and mixes them by Weight
+struct LutBlendConstants
+{
+	uint32_t FromLut;
+	uint32_t ToLut;
+	float Weight;
+};
+
+// Region of the render extent traced by one dispatch
+struct TraceTile
+{
+	glm::uvec2 Offset;
+	glm::uvec2 Extent;
+};
+
+// Push constants of ray_tracing.comp
+struct RayTracingConstants
+{
+	glm::uvec2 TileOffset;
+	uint32_t Resolve;
+	uint32_t Seed;
+};
+
+// Push constants of accumulation_merge.comp
+struct AccumulationMergeConstants
+{
+	glm::uvec2 Offset;
+	glm::uvec2 Extent;
+	uint32_t BaseIndex;
+};
+
+// Accumulated sums of the render extent in row order, alpha counts the samples of each pixel
+struct AccumulationData
+{
+	glm::uvec2 Extent = {};
+	std::vector<glm::vec4> Sums;
+};
+
+// Push constants of post_process.comp
+struct PostProcessConstants
+{
+	LutBlendConstants LutBlend;
+	float Exposure;
+	float BloomRadius;
+	uint32_t OutputImage;
+	glm::uvec2 RenderSize;
+};
+
+// Elements of OutputImages in post_process.comp
+enum PostProcessOutput : uint32_t
+{
+	POST_PROCESS_OUTPUT_DISPLAY = 0,
+	POST_PROCESS_OUTPUT_SCALED = 1
+};
+
+// Push constants of downsample.comp
+struct BloomDownsampleConstants
+{
+	uint32_t MipCount;
+	uint32_t WorkgroupCount;
+	glm::uvec2 SourceSize;
+};
+
+// Push constants of upsample.comp
+struct BloomUpsampleConstants
+{
+	glm::uvec2 DstSize;
+	glm::uvec2 SrcSize;
+	float Radius;
+};
+
+// Push constants of upscale.comp
+struct UpscaleConstants
+{
+	glm::uvec2 SourceSize;
+	glm::uvec2 OutputSize;
+};
+
+// Pipeline variant bits of post_process.comp, in constant_id order
+enum PostProcessVariant : uint32_t
+{
+	POST_PROCESS_BLOOM = 1 << 0,
+	POST_PROCESS_COLOR_GRADING = 1 << 1
+};
+
+// GPU time of each stage of the last finished frame, in milliseconds
+struct PassTimings
+{
+	float RayTracing = 0.f;
+	float Bloom = 0.f;
+	float PostProcess = 0.f;
+	float Upscale = 0.f;
+	// Pixel samples the ray tracing time was spent on
+	uint64_t TracedPixels = 0;
+};
+
 struct UniformBufferData
 {
 	alignas(16) glm::vec3 CameraPosition;
@@ -90,57 +256,31 @@ struct UniformBufferData
 	uint32_t Width;
 	uint32_t Height;
 	bool AccumulationEnabled;
-};
-
-struct SphereBufferData
-{
-	alignas(16) glm::vec3 Position;
-	float Radius;
-	uint32_t MaterialIndex;
-};
-
-struct MaterialBufferData
-{
-	alignas(16) glm::vec3 Color;
-	float Roughness;
-	float Metallic;
-	float Specular;
-	float EmissionPower;
+	// The scene buffers hold at least one sphere, the shader only traces this many
+	uint32_t SphereCount;
 };
 
 struct DescriptorBinding
 {
-	VkDescriptorType Type;
-
 	union
 	{
 		VkDescriptorImageInfo ImageInfo;
 		VkDescriptorBufferInfo BufferInfo;
 	};
 
-	explicit DescriptorBinding(const AllocatedImage& image, const VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-		: Type(type)
+	explicit DescriptorBinding(const AllocatedImage& image, VkSampler sampler = VK_NULL_HANDLE, const VkImageLayout layout = VK_IMAGE_LAYOUT_GENERAL)
 	{
 		ImageInfo.imageView = image.ImageView;
-		ImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-	}
-
-	explicit DescriptorBinding(const AllocatedImage& image, VkSampler sampler, const VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-		: Type(type)
-	{
-		ImageInfo.imageView = image.ImageView;
-		ImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		ImageInfo.imageLayout = layout;
 		ImageInfo.sampler = sampler;
 	}
 
-	explicit DescriptorBinding(VkDescriptorImageInfo info, const VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)
-		: Type(type)
+	explicit DescriptorBinding(const VkDescriptorImageInfo info)
 	{
 		ImageInfo = info;
 	}
 
-	explicit DescriptorBinding(const AllocatedBuffer& buffer, const VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, const VkDeviceSize size = VK_WHOLE_SIZE)
-		: Type(type)
+	explicit DescriptorBinding(const AllocatedBuffer& buffer, const VkDeviceSize size = VK_WHOLE_SIZE)
 	{
 		BufferInfo.buffer = buffer.Buffer;
 		BufferInfo.offset = 0;
@@ -151,18 +291,47 @@ struct DescriptorBinding
 struct Shader
 {
 	VkPipelineLayout PipelineLayout;
-	VkPipeline Pipeline;
+	// One pipeline per combination of the bool specialization constants, indexed by variant bits
+	std::vector<VkPipeline> Pipelines;
 	VkDescriptorSetLayout DescriptorLayout;
-	VkDescriptorPool DescriptorPool;
 	VkDescriptorSet DescriptorSet;
 
-	std::vector<DescriptorBinding> Bindings;
+	ShaderReflection Reflection;
+	std::map<uint32_t, DescriptorBinding> Bindings;
+	// Elements of descriptor arrays, null image views are left unwritten (the bindings are partially bound)
+	std::map<uint32_t, std::vector<VkDescriptorImageInfo>> ArrayBindings;
+
+	void Bind(const uint32_t binding, const DescriptorBinding& descriptor)
+	{
+		Bindings.insert_or_assign(binding, descriptor);
+	}
+
+	void BindArrayElement(const uint32_t binding, const uint32_t element, const DescriptorBinding& descriptor)
+	{
+		std::vector<VkDescriptorImageInfo>& elements = ArrayBindings[binding];
+
+		if (elements.size() <= element)
+			elements.resize(element + 1);
+
+		elements[element] = descriptor.ImageInfo;
+	}
+
+	[[nodiscard]] VkPipeline GetPipeline(const uint32_t variant = 0) const
+	{
+		return Pipelines[variant];
+	}
+
+	[[nodiscard]] glm::uvec3 GetGroupCount(const uint32_t width, const uint32_t height, const uint32_t depth = 1) const
+	{
+		const auto& [x, y, z] = Reflection.WorkgroupSize;
+		return { (width + x - 1) / x, (height + y - 1) / y, (depth + z - 1) / z };
+	}
 
 	void Destroy(const VkDevice& device) const
 	{
-		vkDestroyPipeline(device, Pipeline, nullptr);
+		for (const VkPipeline pipeline : Pipelines)
+			vkDestroyPipeline(device, pipeline, nullptr);
+
 		vkDestroyPipelineLayout(device, PipelineLayout, nullptr);
-		vkDestroyDescriptorPool(device, DescriptorPool, nullptr);
-		vkDestroyDescriptorSetLayout(device, DescriptorLayout, nullptr);
 	}
 };
\ No newline at end of file
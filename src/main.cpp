@@ -1,7 +1,18 @@
 #include "Application.h"
+#include "RenderFarm.h"
+#include "SceneTools.h"
 
-int main()
+int main(int argc, char** argv)
 {
+	if (int exitCode = 0; SceneTools::Run(argc, argv, exitCode))
+		return exitCode;
+
+	if (int exitCode = 0; RenderFarm::Run(argc, argv, exitCode))
+		return exitCode;
+
+	if (int exitCode = 0; Application::RunHeadless(argc, argv, exitCode))
+		return exitCode;
+
 	Application app(1920, 1080, "Ray Tracer", true, true);
 	app.Run();
-}
\ No newline at end of file
+}